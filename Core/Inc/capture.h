@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file           : capture.h
+  * @brief          : Header for capture.c file.
+  *                   Parallel camera capture through TIM2 input capture and
+  *                   DMA1, for devices without a DCMI.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "sensor_regs.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Capture statistics, updated from interrupt context
+  */
+typedef struct
+{
+  uint32_t Frames;      /*!< Frames completed with the configured line count */
+  uint32_t ShortFrames; /*!< Frames cut short by an early VSYNC              */
+  uint32_t Lines;       /*!< Lines completed since start                     */
+} Capture_StatsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Bytes kept per pixel: Y only, or the whole YUV422 or RGB565 pixel */
+#if SENSOR_FORMAT == SENSOR_FORMAT_LUMA
+#define CAPTURE_BYTES_PER_PIXEL 1U
+#else
+#define CAPTURE_BYTES_PER_PIXEL SENSOR_BYTES_PER_PIXEL
+#endif
+/* Largest line accepted by the engine, in bytes (one QVGA line) */
+#define CAPTURE_MAX_LINE_BYTES  (320U * CAPTURE_BYTES_PER_PIXEL)
+/* Largest frame height accepted by the engine, in lines */
+#define CAPTURE_MAX_LINES       240U
+/* Frames whose VSYNC timestamp is kept, a power of two */
+#define CAPTURE_TIMESTAMPS      4U
+
+/* Exported variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim2;
+extern DMA_HandleTypeDef hdma_tim2_ch1;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Capture_Init(uint16_t line_bytes, uint16_t lines);
+HAL_StatusTypeDef Capture_SetWindow(uint16_t line_bytes, uint16_t lines);
+HAL_StatusTypeDef Capture_Start(void);
+HAL_StatusTypeDef Capture_Stop(void);
+void Capture_GetStats(Capture_StatsTypeDef *stats);
+uint8_t Capture_GetFrameTime(uint32_t frame, uint32_t *time);
+uint32_t Capture_GetFramePeriod(void);
+
+void Capture_VsyncCallback(void);
+void Capture_HrefCallback(void);
+
+void Capture_LineCpltCallback(const uint8_t *line, uint16_t line_bytes, uint16_t y);
+void Capture_FrameCpltCallback(uint32_t frame, uint16_t lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_H */
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : ccm.h
+  * @brief          : Placement of code and data in the 16 KB CCM SRAM.
+  *
+  *                   CCM sits on the core I/D buses with no wait state at
+  *                   72 MHz and is not reachable by the DMA, so code and
+  *                   CPU-only data placed there neither stall on the flash
+  *                   nor compete with the capture DMA for the SRAM bus.
+  *                   DMA buffers must therefore never be placed there.
+  *
+  *                   CCM_FUNC and CCM_DATA are loaded from flash by the
+  *                   startup code, CCM_BSS is zero-filled. Calls between
+  *                   flash and CCM go through linker-generated veneers. On
+  *                   other targets the macros expand to nothing.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CCM_H
+#define __CCM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported macro ------------------------------------------------------------*/
+#if defined(__arm__)
+
+#define CCM_FUNC    __attribute__((section(".ccmram.text")))
+#define CCM_DATA    __attribute__((section(".ccmram.data")))
+#define CCM_BSS     __attribute__((section(".ccmbss")))
+
+#else /* !__arm__ */
+
+#define CCM_FUNC
+#define CCM_DATA
+#define CCM_BSS
+
+#endif /* __arm__ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CCM_H */
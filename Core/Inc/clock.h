@@ -0,0 +1,55 @@
+/**
+  ******************************************************************************
+  * @file           : clock.h
+  * @brief          : Header for clock.c file.
+  *                   System clock profiles and clock change notification.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f3xx_hal.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Selectable system clock profiles
+  */
+typedef enum
+{
+  CLOCK_PROFILE_PERFORMANCE = 0U, /*!< HSI/1 x9 PLL, 72 MHz core, 2 wait states */
+  CLOCK_PROFILE_LOW_POWER,        /*!< HSI direct, 8 MHz core, 0 wait state     */
+  CLOCK_PROFILE_COUNT
+} Clock_ProfileTypeDef;
+
+/**
+  * @brief Called after every profile switch, once SystemCoreClock is updated
+  */
+typedef void (*Clock_ChangedCallback)(void);
+
+/* Exported constants --------------------------------------------------------*/
+/* Profile applied by SystemClock_Config, overridable from the build system */
+#ifndef CLOCK_PROFILE_DEFAULT
+#define CLOCK_PROFILE_DEFAULT   CLOCK_PROFILE_PERFORMANCE
+#endif
+
+/* Maximum number of modules notified on a clock change */
+#define CLOCK_MAX_CALLBACKS     8U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Clock_SetProfile(Clock_ProfileTypeDef profile);
+HAL_StatusTypeDef Clock_RegisterCallback(Clock_ChangedCallback callback);
+uint32_t Clock_GetApb1TimerFreq(void);
+uint32_t Clock_GetApb2TimerFreq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCK_H */
@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file           : cobs.h
+  * @brief          : Header for cobs.c file.
+  *                   Consistent Overhead Byte Stuffing, shared by the firmware
+  *                   encoder and the host decoder.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __COBS_H
+#define __COBS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported macro ------------------------------------------------------------*/
+/* Worst-case encoded size of len bytes, delimiter excluded */
+#define COBS_ENCODED_MAX(len)   ((len) + (len) / 254U + 1U)
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t Cobs_Encode(const uint8_t *src, uint32_t len, uint8_t *dst);
+uint32_t Cobs_Decode(const uint8_t *src, uint32_t len, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COBS_H */
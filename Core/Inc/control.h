@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file           : control.h
+  * @brief          : Header for control.c file.
+  *                   Fixed-rate pan/tilt pointing loop on TIM6.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CONTROL_H
+#define __CONTROL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "servo.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Loop gains, shared by both axes
+  *
+  * The loop output is a mount slew rate, in rad/s, integrated into the
+  * servo command.
+  */
+typedef struct
+{
+  float Kp;         /*!< Rate per radian of error, 1/s                   */
+  float Ki;         /*!< Rate per radian-second of error, 1/s^2          */
+  float Kd;         /*!< Rate per rad/s of error change, dimensionless   */
+  float Kff;        /*!< Share of the target angular rate fed forward    */
+} Control_GainsTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Loop period, in microseconds: one command per servo pulse */
+#define CONTROL_PERIOD_US       SERVO_PERIOD_US
+/* Loop tick this long before the servo update that latches its command */
+#define CONTROL_LEAD_US         250U
+/* Angle seen by one sensor pixel, in radians (about 25 degrees over 320) */
+#define CONTROL_RAD_PER_PIXEL   1.36e-3f
+/* Servo direction per axis: 1.0f when a longer pulse turns the camera
+   towards increasing pixel coordinates, -1.0f otherwise */
+#define CONTROL_PAN_DIRECTION   1.0f
+#define CONTROL_TILT_DIRECTION  (-1.0f)
+/* Fastest commanded slew, in rad/s */
+#define CONTROL_MAX_RATE        6.0f
+/* Frames a track must have been seen in before the mount follows it */
+#define CONTROL_MIN_HITS        3U
+
+/* Default gains */
+#define CONTROL_KP              12.0f
+#define CONTROL_KI              20.0f
+#define CONTROL_KD              0.05f
+#define CONTROL_KFF             1.0f
+
+/* Exported variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim6;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Control_Init(void);
+HAL_StatusTypeDef Control_Start(void);
+HAL_StatusTypeDef Control_Stop(void);
+void Control_SetGains(const Control_GainsTypeDef *gains);
+void Control_GetGains(Control_GainsTypeDef *gains);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONTROL_H */
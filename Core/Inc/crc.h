@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file           : crc.h
+  * @brief          : Header for crc.c file.
+  *                   CRC-32/zlib on the CRC calculation unit.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CRC_H
+#define __CRC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Crc_Init(void);
+uint32_t Crc_Compute(const uint8_t *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRC_H */
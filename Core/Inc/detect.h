@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file           : detect.h
+  * @brief          : Header for detect.c file.
+  *                   Line-streaming dot detection.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DETECT_H
+#define __DETECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "kernel.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Runs taken from one line; further runs on the same line are ignored */
+#define DETECT_MAX_LINE_RUNS    48U
+/* Runs kept per frame for Detect_GetRuns, the first in capture order */
+#define DETECT_MAX_FRAME_RUNS   24U
+/* One line in this many is binned for the adaptive threshold */
+#define DETECT_HIST_LINE_STEP   8U
+/* Longest RGB565 line scored by Detect_ColorLine, in pixels */
+#define DETECT_MAX_COLOR_PIXELS 320U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Adaptive threshold, set once per frame from the sample histogram
+  *
+  * The threshold becomes the level below which Percentile per mille of the
+  * binned samples fall, plus Margin, clamped to [Min, Max].
+  */
+typedef struct
+{
+  uint16_t Percentile;  /*!< Share of samples below the level, per mille  */
+  uint8_t Margin;       /*!< Added to that level                          */
+  uint8_t Min;          /*!< Lowest threshold                             */
+  uint8_t Max;          /*!< Highest threshold                            */
+} Detect_AutoTypeDef;
+
+/**
+  * @brief Foreground run kept for the frame dump
+  */
+typedef struct
+{
+  uint16_t Y;       /*!< Line index in the frame        */
+  uint16_t Start;   /*!< First sample column            */
+  uint16_t Length;  /*!< Samples in the run             */
+  uint32_t Sum;     /*!< Sum of thresholded intensities */
+} Detect_RunTypeDef;
+
+/**
+  * @brief Foreground runs of one frame, in capture order
+  */
+typedef struct
+{
+  uint32_t Frame;     /*!< Capture frame sequence number                */
+  uint16_t Count;     /*!< Valid entries in Runs                        */
+  uint16_t Dropped;   /*!< Runs found past the end of Runs or of a line */
+  Detect_RunTypeDef Runs[DETECT_MAX_FRAME_RUNS];
+} Detect_RunsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Detect_Init(uint8_t threshold, uint8_t pixel_stride);
+uint8_t Detect_GetThreshold(void);
+void Detect_SetAuto(const Detect_AutoTypeDef *config);
+uint16_t Detect_Line(const uint8_t *line, uint16_t line_bytes, uint16_t y,
+                     const Kernel_RunTypeDef **runs);
+uint16_t Detect_ColorLine(const uint8_t *line, uint16_t line_bytes, uint16_t y,
+                          const Kernel_RunTypeDef **runs);
+const uint8_t *Detect_GetScores(void);
+void Detect_EndFrame(uint32_t frame);
+uint8_t Detect_GetRuns(Detect_RunsTypeDef *runs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DETECT_H */
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+  * @file           : hotpix.h
+  * @brief          : Header for hotpix.c file.
+  *                   Hot pixel map, calibrated on dark frames and kept in
+  *                   the parameter store.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOTPIX_H
+#define __HOTPIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "sensor_regs.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef HOTPIX_CALIBRATE
+#define HOTPIX_CALIBRATE        0
+#endif
+
+/* Hot pixels the map holds */
+#define HOTPIX_MAX_PIXELS       64U
+/* Dark frames captured by a calibration */
+#define HOTPIX_CAL_FRAMES       16U
+/* Frames out of HOTPIX_CAL_FRAMES a pixel must be bright in to be hot */
+#define HOTPIX_CAL_HITS         12U
+/* Level a dark sample must exceed to count as bright, on the detection
+   scale: luminance, or redness in RGB565 */
+#define HOTPIX_CAL_THRESHOLD    64U
+/* Longest bright run still taken for hot pixels; a longer one means light
+   reaches the sensor and fails the calibration */
+#define HOTPIX_CAL_MAX_RUN      2U
+/* Bright pixels followed at once while calibrating */
+#define HOTPIX_CAL_CANDIDATES   128U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Hot pixel, in output pixels of the full frame
+  */
+typedef struct
+{
+  uint16_t X;
+  uint16_t Y;
+} Hotpix_PixelTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Hotpix_Init(void);
+uint16_t Hotpix_GetPixels(const Hotpix_PixelTypeDef **pixels);
+void Hotpix_SetWindow(const Sensor_WindowTypeDef *window);
+const uint16_t *Hotpix_GetLine(uint16_t y, uint16_t *count);
+void Hotpix_StartCalibration(void);
+uint8_t Hotpix_IsCalibrating(void);
+void Hotpix_CalibrateLine(const uint8_t *line, uint16_t line_bytes, uint16_t stride, uint16_t y);
+void Hotpix_EndFrame(uint32_t frame);
+HAL_StatusTypeDef Hotpix_Store(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOTPIX_H */
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file           : kernel.h
+  * @brief          : Header for kernel.c file.
+  *                   Per-line pixel kernels.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __KERNEL_H
+#define __KERNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Run of consecutive foreground samples on one line,
+  *        w = p - threshold and d = x - Start
+  */
+typedef struct
+{
+  uint16_t Start;   /*!< First sample column      */
+  uint16_t Length;  /*!< Samples in the run       */
+  uint32_t Sum;     /*!< Sum of w                 */
+  uint32_t SumX;    /*!< Sum of w * d             */
+  uint32_t SumXX;   /*!< Sum of w * d * d         */
+} Kernel_RunTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* Histogram bins of Kernel_Histogram, four intensity levels each */
+#define KERNEL_HIST_BINS        64U
+#define KERNEL_HIST_SHIFT       2U
+
+/* Exported functions prototypes ---------------------------------------------*/
+uint32_t Kernel_ThresholdRuns(const uint8_t *line, uint32_t line_bytes,
+                              uint32_t stride, uint8_t threshold,
+                              Kernel_RunTypeDef *runs, uint32_t max_runs);
+uint32_t Kernel_ThresholdRuns_Ref(const uint8_t *line, uint32_t line_bytes,
+                                  uint32_t stride, uint8_t threshold,
+                                  Kernel_RunTypeDef *runs, uint32_t max_runs);
+uint32_t Kernel_MaskRuns(const uint8_t *line, uint32_t stride, uint8_t threshold,
+                         const uint16_t *columns, uint32_t column_count,
+                         Kernel_RunTypeDef *runs, uint32_t count);
+void Kernel_RednessScores(const uint8_t *line, uint32_t line_bytes, uint8_t *score);
+void Kernel_Histogram(const uint8_t *line, uint32_t line_bytes, uint32_t stride,
+                      uint32_t *hist);
+void Kernel_RednessScores_Ref(const uint8_t *line, uint32_t line_bytes, uint8_t *score);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __KERNEL_H */
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file           : label.h
+  * @brief          : Header for label.c file.
+  *                   Single-pass streaming connected-component labeling.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LABEL_H
+#define __LABEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "kernel.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Provisional labels alive at once (runs of the current and previous line) */
+#define LABEL_MAX_LABELS        64U
+/* Runs kept per line; further runs on the same line are ignored */
+#define LABEL_MAX_RUNS          48U
+/* Blobs reported per frame; the lightest are dropped first */
+#define LABEL_MAX_BLOBS         16U
+/* Fewest samples of a blob kept from a downsampled frame */
+#define LABEL_SCALE_MIN_SAMPLES 2U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief One 8-connected component, w = max(p - threshold, 0)
+  */
+typedef struct
+{
+  uint32_t Area;    /*!< Pixels above threshold                     */
+  uint32_t Weight;  /*!< Sum of w                                   */
+  uint16_t XMin;    /*!< Bounding box, inclusive                    */
+  uint16_t XMax;
+  uint16_t YMin;
+  uint16_t YMax;
+  int32_t X;        /*!< Weighted centroid column, Q16.16 pixels    */
+  int32_t Y;        /*!< Weighted centroid row, Q16.16 pixels       */
+  float Mxx;        /*!< Weighted central second moments, pixels^2  */
+  float Myy;
+  float Mxy;
+  uint8_t Refined;  /*!< 1 once X and Y come from the subpixel fit    */
+} Label_BlobTypeDef;
+
+/**
+  * @brief Blobs of one frame, heaviest first
+  */
+typedef struct
+{
+  uint32_t Frame;     /*!< Capture frame sequence number                  */
+  uint16_t Count;     /*!< Valid entries in Blobs                         */
+  uint16_t Dropped;   /*!< Blobs lost to a full blob, label or run table  */
+  Label_BlobTypeDef Blobs[LABEL_MAX_BLOBS];
+} Label_FrameTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Label_Init(void);
+void Label_Line(const Kernel_RunTypeDef *runs, uint16_t count, uint16_t y);
+void Label_EndFrame(uint32_t frame);
+uint8_t Label_GetFrame(Label_FrameTypeDef *frame);
+void Label_ScaleFrame(Label_FrameTypeDef *frame, uint16_t scale);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LABEL_H */
@@ -57,6 +57,30 @@ void Error_Handler(const char *func_name, HAL_StatusTypeDef err);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
+#define CAM_PCLK_Pin GPIO_PIN_0
+#define CAM_PCLK_GPIO_Port GPIOA
+#define CAM_HREF_Pin GPIO_PIN_0
+#define CAM_HREF_GPIO_Port GPIOB
+#define CAM_HREF_EXTI_IRQn EXTI0_IRQn
+#define CAM_VSYNC_Pin GPIO_PIN_1
+#define CAM_VSYNC_GPIO_Port GPIOB
+#define CAM_VSYNC_EXTI_IRQn EXTI1_IRQn
+#define CAM_DATA_Pins (GPIO_PIN_0|GPIO_PIN_1|GPIO_PIN_2|GPIO_PIN_3 \
+                      |GPIO_PIN_4|GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7)
+#define CAM_DATA_GPIO_Port GPIOC
+#define USART_TX_Pin GPIO_PIN_2
+#define USART_TX_GPIO_Port GPIOA
+#define USART_RX_Pin GPIO_PIN_3
+#define USART_RX_GPIO_Port GPIOA
+#define CAM_XCLK_Pin GPIO_PIN_8
+#define CAM_XCLK_GPIO_Port GPIOA
+#define CAM_SCL_Pin GPIO_PIN_8
+#define CAM_SCL_GPIO_Port GPIOB
+#define CAM_SDA_Pin GPIO_PIN_9
+#define CAM_SDA_GPIO_Port GPIOB
+#define SERVO_PAN_Pin GPIO_PIN_8
+#define SERVO_TILT_Pin GPIO_PIN_9
+#define SERVO_GPIO_Port GPIOC
 
 /* USER CODE BEGIN Private defines */
 
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file           : mask.h
+  * @brief          : Header for mask.c file.
+  *                   Streaming 1 bpp foreground mask with 3x3 opening.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MASK_H
+#define __MASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "kernel.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef MASK_ENABLED
+#define MASK_ENABLED            0
+#endif
+
+/* Largest mask, in samples per line and lines (QVGA) */
+#define MASK_MAX_WIDTH          320U
+#define MASK_MAX_LINES          240U
+/* 32-bit words per mask row */
+#define MASK_WORDS              (MASK_MAX_WIDTH / 32U)
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Cleaned mask of one frame
+  */
+typedef struct
+{
+  uint32_t Frame;   /*!< Capture frame sequence number                    */
+  uint16_t Width;   /*!< Samples per line                                 */
+  uint16_t Lines;   /*!< Lines in the mask                                */
+  uint16_t XMin;    /*!< Bounding box of the set pixels, inclusive; XMin  */
+  uint16_t XMax;    /*!<   greater than XMax when the mask is empty       */
+  uint16_t YMin;
+  uint16_t YMax;
+} Mask_ResultTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Mask_Init(void);
+void Mask_Line(const Kernel_RunTypeDef *runs, uint16_t count, uint16_t width, uint16_t y);
+void Mask_EndFrame(uint32_t frame);
+uint8_t Mask_GetResult(Mask_ResultTypeDef *result);
+const uint32_t *Mask_GetRow(uint16_t y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MASK_H */
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file           : param.h
+  * @brief          : Header for param.c file.
+  *                   Key/value parameter store in two flash pages.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PARAM_H
+#define __PARAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Stored parameters; numbers are kept in flash, never reuse one
+  */
+typedef enum
+{
+  PARAM_KEY_HOTPIX = 1U,    /*!< Hot pixel map, see hotpix.c              */
+  PARAM_KEY_THRESHOLD = 2U, /*!< Settled detection threshold, one byte    */
+  PARAM_KEY_GAINS = 3U,     /*!< Control_GainsTypeDef                     */
+  PARAM_KEY_COUNT
+} Param_KeyTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* The two pages of the store: the last 4 KB of the 512 KB bank, which the
+   linker script keeps out of the program */
+#define PARAM_PAGE_ADDRESS      (FLASH_BASE + 0x7F000U)
+/* Largest value */
+#define PARAM_MAX_VALUE         512U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Param_Init(void);
+uint16_t Param_Get(Param_KeyTypeDef key, void *value, uint16_t size);
+HAL_StatusTypeDef Param_Set(Param_KeyTypeDef key, const void *value, uint16_t length);
+void Param_Process(void);
+uint8_t Param_IsBusy(void);
+HAL_StatusTypeDef Param_Flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PARAM_H */
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : pool.h
+  * @brief          : Header for pool.c file.
+  *                   Fixed-block memory pools carved from a static arena.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __POOL_H
+#define __POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* The run dump pool exists only when runs are streamed */
+#ifndef RUN_DUMP_ENABLED
+#define RUN_DUMP_ENABLED        0
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Pools, one per kind of buffer; sizes are set in pool.c
+  */
+typedef enum
+{
+  POOL_CAPTURE = 0U,  /*!< Two-line capture DMA buffers                */
+  POOL_BLOBS,         /*!< Label_FrameTypeDef blob tables              */
+#if RUN_DUMP_ENABLED
+  POOL_RUNS,          /*!< Detect_RunsTypeDef run dumps                */
+#endif
+  POOL_PACKET,        /*!< Telemetry packet and COBS frame buffers     */
+  POOL_COUNT
+} Pool_IdTypeDef;
+
+/**
+  * @brief Occupancy of one pool
+  */
+typedef struct
+{
+  uint32_t BlockSize; /*!< Bytes per block, rounded up to 8            */
+  uint16_t Blocks;    /*!< Blocks in the pool                          */
+  uint16_t InUse;     /*!< Blocks currently allocated                  */
+  uint16_t HighWater; /*!< Most blocks ever allocated at once          */
+  uint16_t Failures;  /*!< Allocations refused on an empty pool        */
+} Pool_StatsTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Pool_Init(void);
+void *Pool_Alloc(Pool_IdTypeDef pool);
+HAL_StatusTypeDef Pool_Free(Pool_IdTypeDef pool, void *block);
+void Pool_GetStats(Pool_IdTypeDef pool, Pool_StatsTypeDef *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __POOL_H */
@@ -0,0 +1,168 @@
+/**
+  ******************************************************************************
+  * @file           : profile.h
+  * @brief          : Header for profile.c file.
+  *                   DWT cycle-counter profiling of the pipeline stages.
+  *
+  *                   PROFILE_SCOPE(stage) times the rest of the enclosing
+  *                   block and records it in the stage statistics. Recording
+  *                   is inline, with no call and no per-sample counter (the
+  *                   histogram sum is the count): two CYCCNT reads, a 64-bit
+  *                   add, min/max and a CLZ-indexed increment, about 18
+  *                   cycles per scope. With PROFILE_ENABLED at 0 every macro
+  *                   expands to nothing and the table is not linked.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED         0
+#endif
+
+/* Histogram bins: bin b counts durations in [2^b, 2^(b+1)) cycles */
+#define PROFILE_BINS            32U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Profiled pipeline stages
+  */
+typedef enum
+{
+  PROFILE_STAGE_CAPTURE_WAIT = 0U,  /*!< Thread mode idle until a frame is labeled */
+  PROFILE_STAGE_THRESHOLD,          /*!< Per-line threshold and moments kernel     */
+  PROFILE_STAGE_LABEL,              /*!< Per-line connected-component labeling     */
+  PROFILE_STAGE_MASK,               /*!< Per-line binary mask and opening          */
+  PROFILE_STAGE_REFINE,             /*!< Per-frame subpixel centroid fit           */
+  PROFILE_STAGE_FILTER,             /*!< Per-frame track filter                    */
+  PROFILE_STAGE_TELEMETRY,          /*!< Per-frame packet encoding                 */
+  PROFILE_STAGE_CONTROL,            /*!< Pointing loop interrupt                   */
+  PROFILE_STAGE_CONTROL_JITTER,     /*!< Pointing loop period error                */
+  PROFILE_STAGE_RUNS_KERNEL,        /*!< Line kernel, cycles per 256 samples       */
+  PROFILE_STAGE_RUNS_REF,           /*!< Its scalar reference, same lines and unit */
+  PROFILE_STAGE_COUNT
+} Profile_StageTypeDef;
+
+/**
+  * @brief Raw statistics of one stage; the sample count is the histogram sum
+  */
+typedef struct
+{
+  uint32_t Min;
+  uint32_t Max;
+  uint64_t Sum;
+  uint32_t Histogram[PROFILE_BINS];
+} Profile_StageStatsTypeDef;
+
+/**
+  * @brief Summary of one stage, as reported
+  */
+typedef struct
+{
+  uint32_t Count;
+  uint32_t Min;
+  uint32_t Max;
+  uint32_t Mean;
+  uint32_t Histogram[PROFILE_BINS];
+} Profile_StatsTypeDef;
+
+/**
+  * @brief Open scope, closed by Profile_ScopeEnd when it goes out of scope
+  */
+typedef struct
+{
+  Profile_StageTypeDef Stage;
+  uint32_t Start;
+} Profile_ScopeTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Profile_Init(void);
+void Profile_Reset(void);
+void Profile_GetStats(Profile_StageTypeDef stage, Profile_StatsTypeDef *stats);
+
+#if PROFILE_ENABLED
+
+/* Exported variables --------------------------------------------------------*/
+extern Profile_StageStatsTypeDef profile_stages[PROFILE_STAGE_COUNT];
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Current cycle count
+  * @retval DWT->CYCCNT
+  */
+static inline uint32_t Profile_Now(void)
+{
+  return DWT->CYCCNT;
+}
+
+/**
+  * @brief  Account one duration to a stage
+  * @note   A stage must only be recorded from one interrupt level.
+  * @param  stage: pipeline stage, ideally a constant
+  * @param  cycles: duration in CPU cycles
+  * @retval None
+  */
+static inline void Profile_Record(Profile_StageTypeDef stage, uint32_t cycles)
+{
+  Profile_StageStatsTypeDef *s = &profile_stages[stage];
+
+  s->Sum += cycles;
+  if (cycles < s->Min) {
+    s->Min = cycles;
+  }
+  if (cycles > s->Max) {
+    s->Max = cycles;
+  }
+  s->Histogram[31U - __CLZ(cycles | 1U)]++;
+}
+
+/**
+  * @brief  Cleanup handler of PROFILE_SCOPE
+  * @param  scope: scope being left
+  * @retval None
+  */
+static inline void Profile_ScopeEnd(const Profile_ScopeTypeDef *scope)
+{
+  Profile_Record(scope->Stage, DWT->CYCCNT - scope->Start);
+}
+
+/* Exported macro ------------------------------------------------------------*/
+#define PROFILE_CONCAT_(a, b)   a##b
+#define PROFILE_CONCAT(a, b)    PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(stage) \
+  const Profile_ScopeTypeDef PROFILE_CONCAT(profile_scope_, __LINE__) \
+    __attribute__((cleanup(Profile_ScopeEnd))) = { (stage), DWT->CYCCNT }
+
+#else
+
+static inline uint32_t Profile_Now(void)
+{
+  return 0U;
+}
+
+static inline void Profile_Record(Profile_StageTypeDef stage, uint32_t cycles)
+{
+  (void)stage;
+  (void)cycles;
+}
+
+#define PROFILE_SCOPE(stage)    do { } while (0)
+
+#endif /* PROFILE_ENABLED */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILE_H */
@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file           : refine.h
+  * @brief          : Header for refine.c file.
+  *                   Subpixel Gaussian fit of the dot centroid.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __REFINE_H
+#define __REFINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "label.h"
+#include "sensor_regs.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef REFINE_ENABLED
+#define REFINE_ENABLED          0
+#endif
+
+/* Side of the square patch of samples kept around the predicted dot */
+#define REFINE_PATCH            24U
+/* Half side of the fitted window, centered on the rounded moment centroid:
+   at least REFINE_RADIUS, widened up to REFINE_MAX_RADIUS to take in the
+   flanks of a large blob */
+#define REFINE_RADIUS           5U
+#define REFINE_MAX_RADIUS       9U
+/* Samples at or above this level are taken as clipped and left out. Red
+   clips at 248 on the redness scale, less the green and blue a saturated
+   core still carries. */
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+#define REFINE_CLIP             200U
+#else
+#define REFINE_CLIP             250U
+#endif
+/* Fewest samples a fit is made from */
+#define REFINE_MIN_SAMPLES      8U
+/* Largest distance from the moment centroid to the fitted center, pixels */
+#define REFINE_MAX_SHIFT        1.0f
+/* Fraction bits of a refined centroid: 1/64 pixel */
+#define REFINE_FRACTION_BITS    6U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Refine_Init(void);
+void Refine_Line(const uint8_t *line, uint16_t line_bytes, uint16_t stride, uint16_t y);
+void Refine_EndFrame(uint32_t frame);
+uint8_t Refine_Frame(Label_FrameTypeDef *frame);
+void Refine_Aim(uint32_t frame);
+uint32_t Refine_Radius(uint32_t extent);
+uint8_t Refine_Fit(const uint8_t *center, uint32_t pitch, uint32_t radius, uint8_t threshold,
+                   int32_t *dx, int32_t *dy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __REFINE_H */
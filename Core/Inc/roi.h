@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file           : roi.h
+  * @brief          : Header for roi.c file.
+  *                   Region-of-interest tracking: sensor window follows the
+  *                   locked dot.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __ROI_H
+#define __ROI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "label.h"
+#include "sensor.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  ROI_STATE_SEARCH = 0U,  /*!< Full frame at ROI_SEARCH_SCALE,
+                               waiting for a dot                  */
+  ROI_STATE_TRACK         /*!< Window locked around the dot       */
+} Roi_StateTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef ROI_COARSE_SEARCH
+#define ROI_COARSE_SEARCH       1
+#endif
+
+/* Output pixels per captured sample while searching */
+#if ROI_COARSE_SEARCH
+#define ROI_SEARCH_SCALE        SENSOR_SEARCH_SCALE
+#else
+#define ROI_SEARCH_SCALE        1U
+#endif
+/* Tracking window size, in output pixels */
+#define ROI_SIZE                64U
+/* Re-center when the dot drifts this far from the window center */
+#define ROI_MARGIN              12U
+/* Minimum blob weight counted as a dot */
+#define ROI_LOCK_WEIGHT         500U
+/* Consecutive search frames with a dot, each within ROI_MARGIN of the
+   previous one, before shrinking the window */
+#define ROI_LOCK_FRAMES         2U
+/* Consecutive frames without a dot before growing back to full frame */
+#define ROI_LOST_FRAMES         3U
+/* Frames between the one a window is decided on and the first read with it */
+#define ROI_LEAD_FRAMES         2U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Roi_Init(void);
+HAL_StatusTypeDef Roi_Update(const Label_FrameTypeDef *frame);
+Roi_StateTypeDef Roi_GetState(void);
+uint8_t Roi_GetWindow(uint32_t frame, Sensor_WindowTypeDef *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROI_H */
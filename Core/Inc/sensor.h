@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file           : sensor.h
+  * @brief          : Header for sensor.c file.
+  *                   OV7670 camera sensor control over SCCB (I2C1).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSOR_H
+#define __SENSOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "sensor_regs.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* 8-bit SCCB write address */
+#define SENSOR_ADDRESS          0x42U
+
+/* Read every register of the bring-up tables back after writing it */
+#ifndef SENSOR_VERIFY
+#define SENSOR_VERIFY           1U
+#endif
+
+/* Preset loaded at bring-up */
+#ifndef SENSOR_EXPOSURE_DEFAULT
+#define SENSOR_EXPOSURE_DEFAULT SENSOR_EXPOSURE_AUTO
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+extern I2C_HandleTypeDef hi2c1;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Sensor_Init(void);
+HAL_StatusTypeDef Sensor_Wait(void);
+uint8_t Sensor_IsBusy(void);
+HAL_StatusTypeDef Sensor_WriteReg(uint8_t reg, uint8_t value);
+HAL_StatusTypeDef Sensor_ReadReg(uint8_t reg, uint8_t *value);
+HAL_StatusTypeDef Sensor_SetWindow(const Sensor_WindowTypeDef *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENSOR_H */
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_regs.h
+  * @brief          : OV7670 register map, frame modes and register tables.
+  *                   Free of HAL dependencies, shared by sensor.c and
+  *                   sensor_tables.cpp.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSOR_REGS_H
+#define __SENSOR_REGS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Output frame sizes, selected at build time with SENSOR_MODE */
+#define SENSOR_MODE_QVGA        0   /*!< 320 x 240 */
+#define SENSOR_MODE_QQVGA       1   /*!< 160 x 120 */
+
+#ifndef SENSOR_MODE
+#define SENSOR_MODE             SENSOR_MODE_QVGA
+#endif
+
+/* Output frame size */
+#if SENSOR_MODE == SENSOR_MODE_QQVGA
+#define SENSOR_WIDTH            160U
+#define SENSOR_HEIGHT           120U
+#else
+#define SENSOR_WIDTH            320U
+#define SENSOR_HEIGHT           240U
+#endif
+/* Output pixels per captured sample in search frames: the 80 x 60 frame,
+   smallest the downsampler produces, that ROI acquisition scans */
+#if SENSOR_MODE == SENSOR_MODE_QQVGA
+#define SENSOR_SEARCH_SCALE     2U
+#else
+#define SENSOR_SEARCH_SCALE     4U
+#endif
+/* Bytes per output pixel (YUV422) */
+#define SENSOR_BYTES_PER_PIXEL  2U
+
+/* Pixel formats, selected at build time with SENSOR_FORMAT */
+#define SENSOR_FORMAT_LUMA      0   /*!< UYVY of which only Y is captured */
+#define SENSOR_FORMAT_YUV422    1   /*!< YUYV, captured whole             */
+#define SENSOR_FORMAT_RGB565    2   /*!< RGB565, high byte first          */
+
+#ifndef SENSOR_FORMAT
+#define SENSOR_FORMAT           SENSOR_FORMAT_LUMA
+#endif
+
+/* Registers programming a readout window and its scaling */
+#define SENSOR_WINDOW_REGS      10U
+
+/* Register addresses */
+#define SENSOR_REG_GAIN         0x00U
+#define SENSOR_REG_VREF         0x03U
+#define SENSOR_REG_COM1         0x04U
+#define SENSOR_REG_AECHH        0x07U
+#define SENSOR_REG_PID          0x0AU
+#define SENSOR_REG_VER          0x0BU
+#define SENSOR_REG_COM3         0x0CU
+#define SENSOR_REG_AECH         0x10U
+#define SENSOR_REG_CLKRC        0x11U
+#define SENSOR_REG_COM7         0x12U
+#define SENSOR_REG_COM8         0x13U
+#define SENSOR_REG_COM10        0x15U
+#define SENSOR_REG_HSTART       0x17U
+#define SENSOR_REG_HSTOP        0x18U
+#define SENSOR_REG_VSTART       0x19U
+#define SENSOR_REG_VSTOP        0x1AU
+#define SENSOR_REG_HREF         0x32U
+#define SENSOR_REG_TSLB         0x3AU
+#define SENSOR_REG_COM14        0x3EU
+#define SENSOR_REG_COM15        0x40U
+#define SENSOR_REG_SCALING_XSC  0x70U
+#define SENSOR_REG_SCALING_YSC  0x71U
+#define SENSOR_REG_SCALING_DCWCTR 0x72U
+#define SENSOR_REG_SCALING_PCLK_DIV 0x73U
+#define SENSOR_REG_RGB444       0x8CU
+#define SENSOR_REG_SCALING_PCLK_DELAY 0xA2U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Readout window, in output pixels
+  */
+typedef struct
+{
+  uint16_t X;
+  uint16_t Y;
+  uint16_t Width;
+  uint16_t Height;
+  uint16_t Scale;   /*!< Output pixels per captured sample: 1, or
+                         SENSOR_SEARCH_SCALE for the full-frame search   */
+} Sensor_WindowTypeDef;
+
+/**
+  * @brief One register write
+  */
+typedef struct
+{
+  uint8_t Reg;
+  uint8_t Value;
+  uint8_t Mask;     /*!< Bits compared on readback, 0 for none */
+} Sensor_RegTypeDef;
+
+/**
+  * @brief Register table, written in order
+  */
+typedef struct
+{
+  const Sensor_RegTypeDef *Regs;
+  uint32_t Count;
+} Sensor_TableTypeDef;
+
+/**
+  * @brief Exposure presets
+  */
+typedef enum
+{
+  SENSOR_EXPOSURE_AUTO = 0U,  /*!< Automatic exposure and gain         */
+  SENSOR_EXPOSURE_INDOOR,     /*!< Fixed, half a frame                 */
+  SENSOR_EXPOSURE_DOT,        /*!< Fixed, shortest: only the dot shows */
+  SENSOR_EXPOSURE_COUNT
+} Sensor_ExposureTypeDef;
+
+/* Exported variables --------------------------------------------------------*/
+extern const Sensor_TableTypeDef sensor_mode_table;
+extern const Sensor_TableTypeDef sensor_exposure_tables[SENSOR_EXPOSURE_COUNT];
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Sensor_WindowRegs(const Sensor_WindowTypeDef *window, Sensor_RegTypeDef *regs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SENSOR_REGS_H */
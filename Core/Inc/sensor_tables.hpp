@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_tables.hpp
+  * @brief          : Compile-time OV7670 register tables for sensor_tables.cpp.
+  *
+  *                   Each configuration is a constexpr std::array of
+  *                   Sensor_RegTypeDef built from the mode parameters, so
+  *                   the tables land in flash fully computed and the window
+  *                   arithmetic used at run time is the one that built them.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SENSOR_TABLES_HPP
+#define __SENSOR_TABLES_HPP
+
+/* Includes ------------------------------------------------------------------*/
+#include <array>
+#include <cstddef>
+#include "sensor_regs.h"
+
+namespace sensor_tables {
+
+/* Exported constants --------------------------------------------------------*/
+/* Array origin of the full window and line length, in VGA array pixels */
+inline constexpr uint32_t HStartOffset = 164U;
+inline constexpr uint32_t VStartOffset = 14U;
+inline constexpr uint32_t HTotal = 784U;
+
+/**
+  * @brief Output format and downscaling of one frame size
+  */
+struct Mode
+{
+  uint16_t Width;
+  uint16_t Height;
+  uint8_t Scale;        /*!< VGA array pixels per output pixel       */
+  uint8_t Clkrc;        /*!< Internal clock = XCLK / (Clkrc + 1)     */
+  uint8_t Com14;        /*!< Manual scaling enable and PCLK divider  */
+  uint8_t Dcwctr;       /*!< Horizontal and vertical downsampling    */
+  uint8_t PclkDiv;      /*!< DSP clock divider                       */
+};
+
+inline constexpr Mode Qvga = { 320U, 240U, 2U, 0x01U, 0x19U, 0x11U, 0xF1U };
+inline constexpr Mode Qqvga = { 160U, 120U, 4U, 0x01U, 0x1AU, 0x22U, 0xF2U };
+/* Search frames: rows and columns dropped, not averaged. The PCLK divider
+   leaves room to run the array from XCLK undivided, at twice the frame
+   rate of the modes above and half their PCLK. */
+inline constexpr Mode Qqqvga = { 80U, 60U, 8U, 0x00U, 0x1BU, 0x33U, 0xF3U };
+
+/**
+  * @brief Pixel format on the bus
+  */
+struct Pixel
+{
+  uint8_t Com7;         /*!< Output format: YUV or RGB               */
+  uint8_t Tslb;         /*!< With COM13[1] = 0, YUV byte order       */
+  uint8_t Com10;        /*!< Sync and PCLK behaviour                 */
+  uint8_t Com15;        /*!< RGB variant and output range            */
+};
+
+/* UYVY with PCLK held while HREF is low, for Y-only capture */
+inline constexpr Pixel Luma = { 0x00U, 0x0CU, 0x20U, 0xC0U };
+/* YUYV, luminance on even bytes */
+inline constexpr Pixel Yuv422 = { 0x00U, 0x04U, 0x00U, 0xC0U };
+/* RGB565, full range, high byte first */
+inline constexpr Pixel Rgb565 = { 0x04U, 0x04U, 0x00U, 0xD0U };
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  One register write, checked in full on readback
+  */
+constexpr Sensor_RegTypeDef Reg(uint8_t reg, uint32_t value, uint8_t mask = 0xFFU)
+{
+  return Sensor_RegTypeDef{ reg, static_cast<uint8_t>(value), mask };
+}
+
+/**
+  * @brief  Tables back to back
+  */
+template <std::size_t N, std::size_t... M>
+constexpr auto Concat(const std::array<Sensor_RegTypeDef, N> &first,
+                      const std::array<Sensor_RegTypeDef, M> &...rest)
+{
+  std::array<Sensor_RegTypeDef, (N + ... + M)> out{};
+  std::size_t n = 0U;
+
+  for (const Sensor_RegTypeDef &r : first) {
+    out[n++] = r;
+  }
+  ((void)[&] {
+    for (const Sensor_RegTypeDef &r : rest) {
+      out[n++] = r;
+    }
+  }(), ...);
+  return out;
+}
+
+/**
+  * @brief  Clock and downsampling of a mode
+  * @note   The window registers are in VGA array pixels and do not depend
+  *         on the downsampling: switching modes keeps the field of view.
+  */
+constexpr std::array<Sensor_RegTypeDef, 4U> Scaling(const Mode &mode)
+{
+  return {
+    Reg(SENSOR_REG_CLKRC, mode.Clkrc),
+    Reg(SENSOR_REG_COM14, mode.Com14),
+    Reg(SENSOR_REG_SCALING_DCWCTR, mode.Dcwctr),
+    Reg(SENSOR_REG_SCALING_PCLK_DIV, mode.PclkDiv),
+  };
+}
+
+/**
+  * @brief  Readout window of a mode
+  * @note   HSTART/HSTOP are 11-bit and VSTART/VSTOP 10-bit; their low bits
+  *         live in HREF and VREF, whose remaining bits keep their defaults.
+  */
+constexpr std::array<Sensor_RegTypeDef, 6U>
+Window(const Mode &mode, const Sensor_WindowTypeDef &window)
+{
+  const uint32_t hstart = (HStartOffset + mode.Scale * window.X) % HTotal;
+  const uint32_t hstop = (hstart + mode.Scale * window.Width) % HTotal;
+  const uint32_t vstart = VStartOffset + mode.Scale * window.Y;
+  const uint32_t vstop = vstart + mode.Scale * window.Height;
+
+  return {
+    Reg(SENSOR_REG_HSTART, hstart >> 3),
+    Reg(SENSOR_REG_HSTOP, hstop >> 3),
+    Reg(SENSOR_REG_HREF, 0x80U | (hstop & 7U) << 3 | (hstart & 7U)),
+    Reg(SENSOR_REG_VSTART, vstart >> 2),
+    Reg(SENSOR_REG_VSTOP, vstop >> 2),
+    Reg(SENSOR_REG_VREF, (vstop & 3U) << 2 | (vstart & 3U), 0x0FU),
+  };
+}
+
+/**
+  * @brief  Output at a mode's size and pixel format, full-frame window
+  */
+constexpr auto Format(const Mode &mode, const Pixel &pixel)
+{
+  const std::array<Sensor_RegTypeDef, 9U> format = {
+    Reg(SENSOR_REG_COM7, pixel.Com7),
+    Reg(SENSOR_REG_RGB444, 0x00U),              /* RGB444 off                 */
+    Reg(SENSOR_REG_COM15, pixel.Com15),
+    Reg(SENSOR_REG_TSLB, pixel.Tslb),
+    Reg(SENSOR_REG_COM3, 0x04U),                /* DCW enable                 */
+    Reg(SENSOR_REG_SCALING_XSC, 0x3AU),
+    Reg(SENSOR_REG_SCALING_YSC, 0x35U),
+    Reg(SENSOR_REG_SCALING_PCLK_DELAY, 0x02U),
+    Reg(SENSOR_REG_COM10, pixel.Com10),         /* VSYNC active high          */
+  };
+
+  return Concat(format, Scaling(mode),
+                Window(mode, Sensor_WindowTypeDef{ 0U, 0U, mode.Width, mode.Height, 1U }));
+}
+
+/**
+  * @brief  Automatic exposure and gain
+  * @note   Exposure and gain registers then move on their own and are not
+  *         written.
+  */
+constexpr std::array<Sensor_RegTypeDef, 1U> AutoExposure()
+{
+  return { Reg(SENSOR_REG_COM8, 0x8FU) };       /* Reset default: AGC, AWB, AEC */
+}
+
+/**
+  * @brief  Fixed exposure and gain, white balance left automatic
+  * @param  rows: exposure time, in line periods
+  * @param  gain: GAIN register, 0 for unity
+  */
+constexpr std::array<Sensor_RegTypeDef, 5U> ManualExposure(uint16_t rows, uint8_t gain)
+{
+  return {
+    Reg(SENSOR_REG_COM8, 0x8AU),                /* AWB only                   */
+    Reg(SENSOR_REG_AECHH, rows >> 10, 0x3FU),
+    Reg(SENSOR_REG_AECH, rows >> 2),
+    Reg(SENSOR_REG_COM1, rows & 3U, 0x03U),
+    Reg(SENSOR_REG_GAIN, gain),
+  };
+}
+
+}  // namespace sensor_tables
+
+#endif /* __SENSOR_TABLES_HPP */
@@ -0,0 +1,42 @@
+/**
+  ******************************************************************************
+  * @file           : serial.h
+  * @brief          : Header for serial.c file.
+  *                   Non-blocking USART2 output (NUCLEO virtual COM port)
+  *                   through a ring buffer drained by DMA.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SERIAL_H
+#define __SERIAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Line rate, within 1 % from both clock profiles: the 8 MHz PCLK1 of the
+   low-power profile needs oversampling by 8 (see serial.c) */
+#define SERIAL_BAUDRATE         460800U
+/* Transmit ring size in bytes, a power of two */
+#define SERIAL_RING_SIZE        1024U
+
+/* Exported variables --------------------------------------------------------*/
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Serial_Init(void);
+uint32_t Serial_Write(const void *data, uint32_t len);
+void Serial_Flush(void);
+uint32_t Serial_GetDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SERIAL_H */
@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+  * @file           : servo.h
+  * @brief          : Header for servo.c file.
+  *                   Pan/tilt servo PWM on TIM8, refreshed by DMA burst.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SERVO_H
+#define __SERVO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  SERVO_PAN = 0U,   /*!< TIM8_CH3 */
+  SERVO_TILT,       /*!< TIM8_CH4 */
+  SERVO_COUNT
+} Servo_AxisTypeDef;
+
+/* Exported constants --------------------------------------------------------*/
+/* PWM period, in microseconds (333 Hz, digital servos; analog ones need 20000) */
+#define SERVO_PERIOD_US         3000U
+/* Pulse width limits and center, in microseconds */
+#define SERVO_PULSE_MIN_US      500U
+#define SERVO_PULSE_MAX_US      2500U
+#define SERVO_PULSE_CENTER_US   1500U
+/* Pulse width change per radian of travel (2000 us over 180 degrees) */
+#define SERVO_US_PER_RAD        636.62f
+
+/* Exported variables --------------------------------------------------------*/
+extern TIM_HandleTypeDef htim8;
+extern DMA_HandleTypeDef hdma_tim8_up;
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Servo_Init(void);
+HAL_StatusTypeDef Servo_Start(void);
+HAL_StatusTypeDef Servo_Stop(void);
+void Servo_SetPulses(uint16_t pan_us, uint16_t tilt_us);
+uint16_t Servo_GetPulse(Servo_AxisTypeDef axis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SERVO_H */
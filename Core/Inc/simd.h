@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file           : simd.h
+  * @brief          : Cortex-M4 packed SIMD intrinsics.
+  *                   On the target these are the CMSIS intrinsics; elsewhere
+  *                   they are bit-exact C models, so the pixel kernels build
+  *                   and give the same results on a workstation.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIMD_H
+#define __SIMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+
+#include "cmsis_compiler.h"
+
+#else /* !__ARM_FEATURE_DSP */
+
+/* APSR.GE[3:0] as left by the last __USUB8 or __USUB16, one bit per byte
+   lane */
+static uint32_t simd_ge __attribute__((unused));
+
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2)
+{
+  op2 %= 32U;
+  return op2 ? (op1 >> op2) | (op1 << (32U - op2)) : op1;
+}
+
+static inline uint32_t __UQSUB8(uint32_t op1, uint32_t op2)
+{
+  uint32_t result = 0U;
+
+  for (uint32_t i = 0U; i < 32U; i += 8U) {
+    uint32_t a = (op1 >> i) & 0xFFU;
+    uint32_t b = (op2 >> i) & 0xFFU;
+    result |= (a > b ? a - b : 0U) << i;
+  }
+  return result;
+}
+
+static inline uint32_t __USUB8(uint32_t op1, uint32_t op2)
+{
+  uint32_t result = 0U;
+
+  simd_ge = 0U;
+  for (uint32_t i = 0U; i < 4U; i++) {
+    uint32_t a = (op1 >> (8U * i)) & 0xFFU;
+    uint32_t b = (op2 >> (8U * i)) & 0xFFU;
+    result |= ((a - b) & 0xFFU) << (8U * i);
+    simd_ge |= (a >= b ? 1U : 0U) << i;
+  }
+  return result;
+}
+
+static inline uint32_t __USUB16(uint32_t op1, uint32_t op2)
+{
+  uint32_t result = 0U;
+
+  simd_ge = 0U;
+  for (uint32_t i = 0U; i < 2U; i++) {
+    uint32_t a = (op1 >> (16U * i)) & 0xFFFFU;
+    uint32_t b = (op2 >> (16U * i)) & 0xFFFFU;
+    result |= ((a - b) & 0xFFFFU) << (16U * i);
+    simd_ge |= (a >= b ? 3U : 0U) << (2U * i);
+  }
+  return result;
+}
+
+static inline uint32_t __UQSUB16(uint32_t op1, uint32_t op2)
+{
+  uint32_t result = 0U;
+
+  for (uint32_t i = 0U; i < 32U; i += 16U) {
+    uint32_t a = (op1 >> i) & 0xFFFFU;
+    uint32_t b = (op2 >> i) & 0xFFFFU;
+    result |= (a > b ? a - b : 0U) << i;
+  }
+  return result;
+}
+
+static inline uint32_t __SEL(uint32_t op1, uint32_t op2)
+{
+  uint32_t result = 0U;
+
+  for (uint32_t i = 0U; i < 4U; i++) {
+    uint32_t lane = 0xFFU << (8U * i);
+    result |= (((simd_ge >> i) & 1U) ? op1 : op2) & lane;
+  }
+  return result;
+}
+
+static inline uint32_t __USADA8(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+  for (uint32_t i = 0U; i < 32U; i += 8U) {
+    uint32_t a = (op1 >> i) & 0xFFU;
+    uint32_t b = (op2 >> i) & 0xFFU;
+    op3 += a > b ? a - b : b - a;
+  }
+  return op3;
+}
+
+#ifndef __CLZ
+static inline uint8_t __CLZ(uint32_t op1)
+{
+  return (uint8_t)(op1 == 0U ? 32U : (uint32_t)__builtin_clz(op1));
+}
+#endif
+
+static inline uint32_t __RBIT(uint32_t op1)
+{
+  uint32_t result = 0U;
+
+  for (uint32_t i = 0U; i < 32U; i++) {
+    result = result << 1 | (op1 >> i & 1U);
+  }
+  return result;
+}
+
+static inline uint32_t __UXTB16(uint32_t op1)
+{
+  return op1 & 0x00FF00FFU;
+}
+
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3)
+{
+  int32_t lo = (int32_t)(int16_t)(op1 & 0xFFFFU) * (int16_t)(op2 & 0xFFFFU);
+  int32_t hi = (int32_t)(int16_t)(op1 >> 16) * (int16_t)(op2 >> 16);
+  return op3 + (uint32_t)lo + (uint32_t)hi;
+}
+
+#endif /* __ARM_FEATURE_DSP */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SIMD_H */
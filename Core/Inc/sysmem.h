@@ -0,0 +1,24 @@
+/**
+  ******************************************************************************
+  * @file           : sysmem.h
+  * @brief          : Header for sysmem.c file.
+  *                   Newlib heap growth, allowed during initialization only.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SYSMEM_H
+#define __SYSMEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Sysmem_Lock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SYSMEM_H */
@@ -0,0 +1,47 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.h
+  * @brief          : Header for telemetry.c file.
+  *                   Binary blob telemetry over the serial port.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "detect.h"
+#include "label.h"
+#include "sensor.h"
+#include "telemetry_protocol.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Stream the foreground runs of each frame, for debugging */
+#ifndef RUN_DUMP_ENABLED
+#define RUN_DUMP_ENABLED        0
+#endif
+/* Frames between two stats packets */
+#define TELEMETRY_STATS_PERIOD  32U
+
+/* Exported functions prototypes ---------------------------------------------*/
+HAL_StatusTypeDef Telemetry_Init(void);
+HAL_StatusTypeDef Telemetry_SendBlobs(const Label_FrameTypeDef *frame,
+                                      const Sensor_WindowTypeDef *window,
+                                      uint32_t timestamp);
+HAL_StatusTypeDef Telemetry_SendRuns(const Detect_RunsTypeDef *runs,
+                                     const Sensor_WindowTypeDef *window,
+                                     uint32_t timestamp);
+HAL_StatusTypeDef Telemetry_SendProfile(uint32_t frame, uint32_t timestamp);
+HAL_StatusTypeDef Telemetry_SendStats(uint32_t frame, uint32_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,143 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry_protocol.h
+  * @brief          : Binary telemetry wire format, shared by the firmware and
+  *                   the host decoder.
+  *
+  *                   A packet is a header, Count records and a CRC-32,
+  *                   all little-endian, COBS-encoded and terminated by 0x00.
+  *                   The CRC is the IEEE 802.3 / zlib CRC-32 (reflected
+  *                   polynomial 0x04C11DB7, initial value and final XOR
+  *                   0xFFFFFFFF) of the header and records.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_PROTOCOL_H
+#define __TELEMETRY_PROTOCOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Exported constants --------------------------------------------------------*/
+/* Bumped on any incompatible change of the records below */
+#define TELEMETRY_VERSION       1U
+
+/* Packet types */
+#define TELEMETRY_TYPE_BLOBS    0x01U  /*!< Count blob records            */
+#define TELEMETRY_TYPE_PROFILE  0x02U  /*!< One profile record, Count = 1 */
+#define TELEMETRY_TYPE_RUNS     0x03U  /*!< Count run records             */
+#define TELEMETRY_TYPE_STATS    0x04U  /*!< One stats record, Count = 1   */
+
+/* Header flags */
+#define TELEMETRY_FLAG_TRUNCATED 0x01U  /*!< Blobs or runs were dropped on target */
+#define TELEMETRY_FLAG_SCALE_Pos 1U
+#define TELEMETRY_FLAG_SCALE    0x06U  /*!< Runs: log2 of the output pixels per
+                                            sample, 0 at full resolution */
+
+/* Blob record flags */
+#define TELEMETRY_BLOB_REFINED  0x01U  /*!< Centroid from the subpixel fit,
+                                            1/64 pixel; moments otherwise */
+
+/* Largest number of blob records in a packet */
+#define TELEMETRY_MAX_BLOBS     16U
+/* Largest number of run records in a packet */
+#define TELEMETRY_MAX_RUNS      24U
+/* Pools reported in a stats record */
+#define TELEMETRY_MAX_POOLS     4U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Packet header, 16 bytes; profile packets leave the origin at 0
+  */
+typedef struct __attribute__((packed))
+{
+  uint8_t Version;      /*!< TELEMETRY_VERSION                              */
+  uint8_t Type;         /*!< TELEMETRY_TYPE_xxx                             */
+  uint8_t Count;        /*!< Records following the header                   */
+  uint8_t Flags;        /*!< TELEMETRY_FLAG_xxx                             */
+  uint32_t Frame;       /*!< Capture frame sequence number                  */
+  uint32_t Timestamp;   /*!< DWT cycle counter when the frame was processed */
+  uint16_t OriginX;     /*!< Window origin the coordinates refer to,        */
+  uint16_t OriginY;     /*!< in sensor output pixels                        */
+} Telemetry_HeaderTypeDef;
+
+/**
+  * @brief Blob record, 12 bytes
+  */
+typedef struct __attribute__((packed))
+{
+  int32_t X;            /*!< Centroid column, Q16.16 pixels from OriginX    */
+  int32_t Y;            /*!< Centroid row, Q16.16 pixels from OriginY       */
+  uint16_t Area;        /*!< Pixels above threshold, saturated              */
+  uint8_t Confidence;   /*!< Share of the frame weight, 255 = sole blob     */
+  uint8_t Flags;        /*!< TELEMETRY_BLOB_xxx                             */
+} Telemetry_BlobTypeDef;
+
+/**
+  * @brief Run record, 8 bytes: consecutive samples of one line above the
+  *        threshold, in capture order. Positions count samples, each
+  *        standing for 2^TELEMETRY_FLAG_SCALE output pixels.
+  */
+typedef struct __attribute__((packed))
+{
+  uint16_t Y;           /*!< Line, from OriginY                             */
+  uint16_t Start;       /*!< First column, from OriginX                     */
+  uint16_t Length;      /*!< Samples in the run                             */
+  uint16_t Sum;         /*!< Sum of thresholded intensities, saturated      */
+} Telemetry_RunTypeDef;
+
+/**
+  * @brief Profile record of one pipeline stage, 84 bytes
+  */
+typedef struct __attribute__((packed))
+{
+  uint8_t Stage;        /*!< Profile_StageTypeDef on target                 */
+  uint8_t Reserved[3];
+  uint32_t Count;       /*!< Samples since reset                            */
+  uint32_t Min;         /*!< Cycles                                         */
+  uint32_t Max;
+  uint32_t Mean;
+  uint16_t Histogram[32]; /*!< Bin b: [2^b, 2^(b+1)) cycles, saturated      */
+} Telemetry_ProfileTypeDef;
+
+/**
+  * @brief Occupancy of one memory pool, 8 bytes
+  */
+typedef struct __attribute__((packed))
+{
+  uint16_t BlockSize;   /*!< Bytes per block, 0 for an unused entry         */
+  uint8_t Blocks;       /*!< Blocks in the pool                             */
+  uint8_t InUse;        /*!< Blocks allocated when the record was built     */
+  uint8_t HighWater;    /*!< Most blocks ever allocated at once             */
+  uint8_t Reserved;
+  uint16_t Failures;    /*!< Allocations refused on an empty pool           */
+} Telemetry_PoolTypeDef;
+
+/**
+  * @brief Resource statistics record, 40 bytes
+  */
+typedef struct __attribute__((packed))
+{
+  uint8_t Pools;        /*!< Valid entries in Pool, Pool_IdTypeDef order    */
+  uint8_t Reserved[3];
+  uint32_t SerialDropped; /*!< Bytes the serial ring refused since reset    */
+  Telemetry_PoolTypeDef Pool[TELEMETRY_MAX_POOLS];
+} Telemetry_StatsTypeDef;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Largest decoded packet, CRC included: a full blob packet, which a full
+   run packet matches */
+#define TELEMETRY_PACKET_MAX    (sizeof(Telemetry_HeaderTypeDef) \
+                                 + TELEMETRY_MAX_BLOBS * sizeof(Telemetry_BlobTypeDef) \
+                                 + sizeof(uint32_t))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_PROTOCOL_H */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : track.h
+  * @brief          : Header for track.cpp file.
+  *                   Multi-dot tracking and latency-compensating prediction.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACK_H
+#define __TRACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "label.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Per-axis motion filters, selected at build time with TRACK_FILTER */
+#define TRACK_FILTER_KALMAN_CV  0   /*!< Kalman, constant velocity     */
+#define TRACK_FILTER_KALMAN_CA  1   /*!< Kalman, constant acceleration */
+#define TRACK_FILTER_ALPHA_BETA 2   /*!< Fixed-gain alpha-beta         */
+
+#ifndef TRACK_FILTER
+#define TRACK_FILTER            TRACK_FILTER_KALMAN_CV
+#endif
+
+/* Dots tracked at once */
+#define TRACK_MAX_DOTS          4U
+/* Minimum blob weight that can start or update a track */
+#define TRACK_MIN_WEIGHT        500U
+/* Largest distance between a prediction and its blob, in pixels */
+#define TRACK_GATE              24.0f
+/* Consecutive frames without a blob before a track is dropped */
+#define TRACK_LOST_FRAMES       3U
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Predicted state of the primary dot, sensor pixels
+  */
+typedef struct
+{
+  float X;          /*!< Position, pixels                 */
+  float Y;
+  float VX;         /*!< Velocity, pixels/s               */
+  float VY;
+  uint32_t Time;    /*!< DWT time of the last measurement */
+  uint16_t Hits;    /*!< Frames the track was updated in  */
+} Track_PredictionTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Track_Init(void);
+void Track_Update(const Label_FrameTypeDef *frame, uint16_t origin_x, uint16_t origin_y,
+                  uint32_t time);
+uint8_t Track_Predict(uint32_t time, Track_PredictionTypeDef *prediction);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACK_H */
@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file           : track_filter.hpp
+  * @brief          : Per-axis dot motion filters for track.cpp.
+  *
+  *                   Each filter follows one coordinate of one dot, in
+  *                   pixels, with time in seconds, on the single-precision
+  *                   FPU. They are policies of the tracker and must satisfy
+  *                   TrackFilter; the choice is made at compile time, so the
+  *                   tracker carries no virtual calls and only the selected
+  *                   filter is linked.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACK_FILTER_HPP
+#define __TRACK_FILTER_HPP
+
+/* Includes ------------------------------------------------------------------*/
+#include <concepts>
+#include <cstddef>
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Interface of a per-axis filter
+  *
+  * Reset starts over at a measured position, Predict propagates the state
+  * by dt seconds, Correct folds in a measured position at the current state
+  * time. Position, Velocity and Acceleration read the state, in pixels,
+  * pixels/s and pixels/s^2.
+  */
+template <typename F>
+concept TrackFilter = std::default_initializable<F>
+  && requires(F f, const F cf, float z, float dt) {
+    f.Reset(z);
+    f.Predict(dt);
+    f.Correct(z);
+    { cf.Position() } -> std::same_as<float>;
+    { cf.Velocity() } -> std::same_as<float>;
+    { cf.Acceleration() } -> std::same_as<float>;
+  };
+
+/**
+  * @brief Kalman filter of a constant-velocity (Order 2) or constant-
+  *        acceleration (Order 3) motion, observed in position
+  * @tparam ProcessNoise: spectral density of the white acceleration (Order 2,
+  *         pixels^2/s^3) or jerk (Order 3, pixels^2/s^5) driving the model
+  * @tparam MeasurementNoise: centroid variance, pixels^2
+  */
+template <std::size_t Order, float ProcessNoise, float MeasurementNoise>
+class KalmanFilter
+{
+  static_assert(Order == 2U || Order == 3U, "constant velocity or acceleration");
+
+public:
+  void Reset(float z)
+  {
+    for (std::size_t i = 0U; i < Order; i++) {
+      x[i] = 0.0f;
+      for (std::size_t j = 0U; j < Order; j++) {
+        P[i][j] = 0.0f;
+      }
+    }
+    x[0] = z;
+    P[0][0] = MeasurementNoise;
+    P[1][1] = InitialVelocityVariance;
+    if constexpr (Order == 3U) {
+      P[2][2] = InitialAccelerationVariance;
+    }
+  }
+
+  void Predict(float dt)
+  {
+    float F[Order][Order] = {};
+    float FP[Order][Order] = {};
+    float Q[Order][Order];
+    float next[Order] = {};
+
+    if (dt <= 0.0f) {
+      return;
+    }
+
+    /* Transition and discretized process noise */
+    for (std::size_t i = 0U; i < Order; i++) {
+      F[i][i] = 1.0f;
+    }
+    F[0][1] = dt;
+    if constexpr (Order == 2U) {
+      const float dt2 = dt * dt;
+
+      Q[0][0] = ProcessNoise * dt2 * dt / 3.0f;
+      Q[0][1] = ProcessNoise * dt2 / 2.0f;
+      Q[1][1] = ProcessNoise * dt;
+    } else {
+      const float dt2 = dt * dt;
+      const float dt3 = dt2 * dt;
+
+      F[0][2] = dt2 / 2.0f;
+      F[1][2] = dt;
+      Q[0][0] = ProcessNoise * dt3 * dt2 / 20.0f;
+      Q[0][1] = ProcessNoise * dt2 * dt2 / 8.0f;
+      Q[0][2] = ProcessNoise * dt3 / 6.0f;
+      Q[1][1] = ProcessNoise * dt3 / 3.0f;
+      Q[1][2] = ProcessNoise * dt2 / 2.0f;
+      Q[2][2] = ProcessNoise * dt;
+    }
+
+    /* x = F x, P = F P F' + Q; F is upper triangular */
+    for (std::size_t i = 0U; i < Order; i++) {
+      for (std::size_t k = i; k < Order; k++) {
+        next[i] += F[i][k] * x[k];
+        for (std::size_t j = 0U; j < Order; j++) {
+          FP[i][j] += F[i][k] * P[k][j];
+        }
+      }
+    }
+    for (std::size_t i = 0U; i < Order; i++) {
+      x[i] = next[i];
+      for (std::size_t j = i; j < Order; j++) {
+        float s = Q[i][j];
+
+        for (std::size_t k = j; k < Order; k++) {
+          s += FP[i][k] * F[j][k];
+        }
+        P[i][j] = s;
+        P[j][i] = s;
+      }
+    }
+  }
+
+  void Correct(float z)
+  {
+    /* H = [1 0 ...]: the innovation variance is P00 + R */
+    const float s = P[0][0] + MeasurementNoise;
+    const float innovation = z - x[0];
+    float gain[Order];
+    float row[Order];
+
+    for (std::size_t i = 0U; i < Order; i++) {
+      gain[i] = P[i][0] / s;
+      row[i] = P[0][i];
+    }
+    for (std::size_t i = 0U; i < Order; i++) {
+      x[i] += gain[i] * innovation;
+      for (std::size_t j = 0U; j < Order; j++) {
+        P[i][j] -= gain[i] * row[j];
+      }
+    }
+  }
+
+  float Position() const
+  {
+    return x[0];
+  }
+
+  float Velocity() const
+  {
+    return x[1];
+  }
+
+  float Acceleration() const
+  {
+    if constexpr (Order == 3U) {
+      return x[2];
+    } else {
+      return 0.0f;
+    }
+  }
+
+private:
+  /* Prior spread of a new track: +-300 pixels/s, +-3000 pixels/s^2 */
+  static constexpr float InitialVelocityVariance = 300.0f * 300.0f;
+  static constexpr float InitialAccelerationVariance = 3000.0f * 3000.0f;
+
+  float x[Order] = {};
+  float P[Order][Order] = {};
+};
+
+/**
+  * @brief Fixed-gain alpha-beta filter: a constant-velocity predictor at a
+  *        fraction of the Kalman cost
+  * @tparam Alpha: position gain, 0 to 1
+  * @tparam Beta: velocity gain, 0 to 2
+  */
+template <float Alpha, float Beta>
+class AlphaBetaFilter
+{
+  static_assert(Alpha > 0.0f && Alpha <= 1.0f && Beta >= 0.0f && Beta < 2.0f,
+                "unstable gains");
+
+public:
+  void Reset(float z)
+  {
+    p = z;
+    v = 0.0f;
+    dt = 0.0f;
+  }
+
+  void Predict(float step)
+  {
+    if (step <= 0.0f) {
+      return;
+    }
+    p += v * step;
+    dt = step;
+  }
+
+  void Correct(float z)
+  {
+    const float r = z - p;
+
+    p += Alpha * r;
+    if (dt > 0.0f) {
+      v += Beta * r / dt;
+    }
+  }
+
+  float Position() const
+  {
+    return p;
+  }
+
+  float Velocity() const
+  {
+    return v;
+  }
+
+  float Acceleration() const
+  {
+    return 0.0f;
+  }
+
+private:
+  float p = 0.0f;
+  float v = 0.0f;
+  float dt = 0.0f;  /*!< Step of the last prediction, seconds */
+};
+
+#endif /* __TRACK_FILTER_HPP */
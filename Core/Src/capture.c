@@ -0,0 +1,430 @@
+/**
+  ******************************************************************************
+  * @file           : capture.c
+  * @brief          : Parallel camera capture engine
+  *
+  *                   The 8-bit camera bus sits on CAM_DATA_GPIO_Port[7:0]. Each
+  *                   PCLK rising edge is an input capture on TIM2_CH1, whose
+  *                   DMA request makes DMA1_Channel5 copy the port IDR into
+  *                   the line buffer: the CPU never touches a pixel.
+  *
+  *                   With SENSOR_FORMAT_LUMA the capture prescaler divides
+  *                   by two and the sensor outputs UYVY, so only the Y byte
+  *                   of each pixel is transferred: line buffers and DMA
+  *                   service load are halved, and the detector reads
+  *                   contiguous luminance.
+  *
+  *                   HREF (EXTI0, both edges) gates the capture DMA request so
+  *                   that only active pixels are transferred; VSYNC (EXTI1,
+  *                   rising) re-synchronizes the DMA at frame start. The DMA
+  *                   runs in circular mode over two lines: its half-transfer
+  *                   and transfer-complete interrupts hand line N to the
+  *                   application the moment its last byte lands, while line
+  *                   N+1 fills the other half.
+  *
+  *                   DMA service latency bounds captured bytes to about
+  *                   HCLK/12, i.e. a 6 MHz PCLK at 72 MHz, or 12 MHz with
+  *                   SENSOR_FORMAT_LUMA. HREF interrupt entry costs a couple of
+  *                   pixels at that rate, which the sensor HSTART absorbs.
+  *                   The line buffers are DMA targets and stay in SRAM; the
+  *                   line completion path runs from CCM SRAM.
+  *
+  *                   Each VSYNC edge is stamped with DWT->CYCCNT, which times
+  *                   the frame it opens for the tracker.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "capture.h"
+#include "ccm.h"
+#include "pool.h"
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim2;
+DMA_HandleTypeDef hdma_tim2_ch1;
+
+static uint8_t *capture_buffer;
+
+static uint16_t capture_line_bytes;
+static uint16_t capture_lines;
+static volatile uint16_t capture_pending_line_bytes;
+static volatile uint16_t capture_pending_lines;
+
+static volatile uint8_t capture_running;
+static volatile uint16_t capture_y;
+static volatile uint32_t capture_frame;
+static volatile uint32_t capture_vsync_time[CAPTURE_TIMESTAMPS];
+static volatile uint32_t capture_period;
+static uint32_t capture_last_vsync;
+static uint8_t capture_vsync_seen;
+static Capture_StatsTypeDef capture_stats;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Capture_GPIO_Init(void);
+static void Capture_Resync(void);
+static void Capture_LineDone(void);
+static void Capture_DMA_HalfCplt(DMA_HandleTypeDef *hdma);
+static void Capture_DMA_Cplt(DMA_HandleTypeDef *hdma);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Configure capture pins, TIM2 input capture and DMA1 channel 5
+  * @note   The two-line buffer is taken from POOL_CAPTURE on the first call.
+  * @param  line_bytes: bytes per line, even and at most CAPTURE_MAX_LINE_BYTES
+  * @param  lines: lines per frame, at most CAPTURE_MAX_LINES
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Capture_Init(uint16_t line_bytes, uint16_t lines)
+{
+  HAL_StatusTypeDef err;
+  TIM_IC_InitTypeDef sConfigIC = {0};
+
+  err = Capture_SetWindow(line_bytes, lines);
+  if (err != HAL_OK) {
+    return err;
+  }
+  capture_line_bytes = line_bytes;
+  capture_lines = lines;
+
+  if (capture_buffer == NULL) {
+    capture_buffer = Pool_Alloc(POOL_CAPTURE);
+    if (capture_buffer == NULL) {
+      return HAL_ERROR;
+    }
+  }
+
+  Capture_GPIO_Init();
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_tim2_ch1.Instance = DMA1_Channel5;
+  hdma_tim2_ch1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_tim2_ch1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim2_ch1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim2_ch1.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_tim2_ch1.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_tim2_ch1.Init.Mode = DMA_CIRCULAR;
+  hdma_tim2_ch1.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+  err = HAL_DMA_Init(&hdma_tim2_ch1);
+  if (err != HAL_OK) {
+    return err;
+  }
+  hdma_tim2_ch1.XferHalfCpltCallback = Capture_DMA_HalfCplt;
+  hdma_tim2_ch1.XferCpltCallback = Capture_DMA_Cplt;
+
+  /* DMA interrupt init, at the same level as the synchronization lines */
+  HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
+
+  /* Free-running timer, used only for its capture DMA request on PCLK */
+  htim2.Instance = TIM2;
+  htim2.Init.Prescaler = 0;
+  htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim2.Init.Period = 0xFFFFFFFFU;
+  htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  err = HAL_TIM_IC_Init(&htim2);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  sConfigIC.ICPolarity = TIM_ICPOLARITY_RISING;
+  sConfigIC.ICSelection = TIM_ICSELECTION_DIRECTTI;
+#if SENSOR_FORMAT == SENSOR_FORMAT_LUMA
+  /* One capture, hence one DMA byte, every second PCLK: the Y of UYVY */
+  sConfigIC.ICPrescaler = TIM_ICPSC_DIV2;
+#else
+  sConfigIC.ICPrescaler = TIM_ICPSC_DIV1;
+#endif
+  sConfigIC.ICFilter = 0;
+  return HAL_TIM_IC_ConfigChannel(&htim2, &sConfigIC, TIM_CHANNEL_1);
+}
+
+/**
+  * @brief  Request a new capture window, applied at the next VSYNC
+  * @param  line_bytes: bytes per line, even and at most CAPTURE_MAX_LINE_BYTES
+  * @param  lines: lines per frame, at most CAPTURE_MAX_LINES
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Capture_SetWindow(uint16_t line_bytes, uint16_t lines)
+{
+  if (line_bytes == 0U || line_bytes > CAPTURE_MAX_LINE_BYTES
+      || (line_bytes & 1U) != 0U || lines == 0U || lines > CAPTURE_MAX_LINES) {
+    return HAL_ERROR;
+  }
+  __disable_irq();
+  capture_pending_line_bytes = line_bytes;
+  capture_pending_lines = lines;
+  __enable_irq();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start acquisition; the first frame begins at the next VSYNC
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Capture_Start(void)
+{
+  HAL_StatusTypeDef err;
+
+  err = HAL_DMA_Start_IT(&hdma_tim2_ch1, (uint32_t)&CAM_DATA_GPIO_Port->IDR,
+                         (uint32_t)capture_buffer, 2U * capture_line_bytes);
+  if (err != HAL_OK) {
+    return err;
+  }
+  err = HAL_TIM_IC_Start(&htim2, TIM_CHANNEL_1);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  capture_running = 0U;
+  __HAL_GPIO_EXTI_CLEAR_IT(CAM_HREF_Pin | CAM_VSYNC_Pin);
+  HAL_NVIC_EnableIRQ(CAM_VSYNC_EXTI_IRQn);
+  HAL_NVIC_EnableIRQ(CAM_HREF_EXTI_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Stop acquisition
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Capture_Stop(void)
+{
+  HAL_StatusTypeDef err;
+
+  HAL_NVIC_DisableIRQ(CAM_HREF_EXTI_IRQn);
+  HAL_NVIC_DisableIRQ(CAM_VSYNC_EXTI_IRQn);
+  __HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1);
+  capture_running = 0U;
+
+  err = HAL_TIM_IC_Stop(&htim2, TIM_CHANNEL_1);
+  if (err != HAL_OK) {
+    return err;
+  }
+  return HAL_DMA_Abort(&hdma_tim2_ch1);
+}
+
+/**
+  * @brief  Copy the capture statistics
+  * @param  stats: destination
+  * @retval None
+  */
+void Capture_GetStats(Capture_StatsTypeDef *stats)
+{
+  __disable_irq();
+  *stats = capture_stats;
+  __enable_irq();
+}
+
+/**
+  * @brief  DWT timestamp of the VSYNC that opened a frame
+  * @param  frame: frame sequence number
+  * @param  time: destination, DWT->CYCCNT at the VSYNC edge
+  * @retval 1 if the frame is one of the last CAPTURE_TIMESTAMPS, 0 otherwise
+  */
+uint8_t Capture_GetFrameTime(uint32_t frame, uint32_t *time)
+{
+  uint8_t valid;
+
+  __disable_irq();
+  valid = capture_frame - frame < CAPTURE_TIMESTAMPS;
+  *time = capture_vsync_time[frame & (CAPTURE_TIMESTAMPS - 1U)];
+  __enable_irq();
+  return valid;
+}
+
+/**
+  * @brief  Interval between the last two VSYNC edges
+  * @retval Frame period in CPU cycles, 0 before the second VSYNC
+  */
+uint32_t Capture_GetFramePeriod(void)
+{
+  return capture_period;
+}
+
+/**
+  * @brief  Frame start: apply any pending window and re-arm the DMA
+  * @note   Called from the VSYNC EXTI interrupt.
+  * @retval None
+  */
+void Capture_VsyncCallback(void)
+{
+  const uint32_t now = DWT->CYCCNT;
+
+  __HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1);
+  if (capture_vsync_seen) {
+    capture_period = now - capture_last_vsync;
+  }
+  capture_last_vsync = now;
+  capture_vsync_seen = 1U;
+  capture_vsync_time[capture_frame & (CAPTURE_TIMESTAMPS - 1U)] = now;
+  if (capture_running && capture_y != 0U) {
+    capture_stats.ShortFrames++;
+  }
+
+  capture_line_bytes = capture_pending_line_bytes;
+  capture_lines = capture_pending_lines;
+  Capture_Resync();
+
+  capture_y = 0U;
+  capture_running = 1U;
+}
+
+/**
+  * @brief  Line gating: open the capture DMA request while HREF is high
+  * @note   Called from the HREF EXTI interrupt.
+  * @retval None
+  */
+void Capture_HrefCallback(void)
+{
+  if (capture_running
+      && HAL_GPIO_ReadPin(CAM_HREF_GPIO_Port, CAM_HREF_Pin) == GPIO_PIN_SET) {
+    __HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_CC1);
+  } else {
+    __HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1);
+  }
+}
+
+/**
+  * @brief  EXTI line detection callback
+  * @param  GPIO_Pin: Specifies the pins connected EXTI line
+  * @retval None
+  */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (GPIO_Pin == CAM_HREF_Pin) {
+    Capture_HrefCallback();
+  } else if (GPIO_Pin == CAM_VSYNC_Pin) {
+    Capture_VsyncCallback();
+  }
+}
+
+/**
+  * @brief  Line complete callback
+  * @note   The line stays valid until the line after next starts filling.
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  y: line index in the frame
+  * @retval None
+  */
+__weak void Capture_LineCpltCallback(const uint8_t *line, uint16_t line_bytes, uint16_t y)
+{
+  UNUSED(line);
+  UNUSED(line_bytes);
+  UNUSED(y);
+}
+
+/**
+  * @brief  Frame complete callback
+  * @param  frame: frame sequence number
+  * @param  lines: number of lines delivered
+  * @retval None
+  */
+__weak void Capture_FrameCpltCallback(uint32_t frame, uint16_t lines)
+{
+  UNUSED(frame);
+  UNUSED(lines);
+}
+
+/**
+  * @brief  Publish the line whose last byte just landed
+  * @note   Even lines complete on half transfer, odd lines on transfer
+  *         complete, since the DMA is re-armed on the first buffer at VSYNC.
+  * @retval None
+  */
+CCM_FUNC static void Capture_LineDone(void)
+{
+  uint16_t y = capture_y;
+
+  if (!capture_running) {
+    return;
+  }
+  capture_stats.Lines++;
+  Capture_LineCpltCallback(&capture_buffer[(y & 1U) * capture_line_bytes],
+                           capture_line_bytes, y);
+
+  capture_y = ++y;
+  if (y == capture_lines) {
+    capture_running = 0U;
+    __HAL_TIM_DISABLE_DMA(&htim2, TIM_DMA_CC1);
+    capture_stats.Frames++;
+    Capture_FrameCpltCallback(capture_frame++, y);
+  }
+}
+
+/**
+  * @brief  DMA half transfer: first line buffer is full
+  * @param  hdma: capture DMA handle
+  * @retval None
+  */
+CCM_FUNC static void Capture_DMA_HalfCplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  Capture_LineDone();
+}
+
+/**
+  * @brief  DMA transfer complete: second line buffer is full
+  * @param  hdma: capture DMA handle
+  * @retval None
+  */
+CCM_FUNC static void Capture_DMA_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+  Capture_LineDone();
+}
+
+/**
+  * @brief  Restart the circular DMA at the first line buffer
+  * @note   Clearing CC1E also resets the input capture prescaler, so that
+  *         with SENSOR_FORMAT_LUMA the first capture of the frame falls on
+  *         the second PCLK of the first line. PCLK is held while HREF is
+  *         low and every line is an even number of bus bytes, so the
+  *         phase holds for the whole frame.
+  * @retval None
+  */
+static void Capture_Resync(void)
+{
+  __HAL_DMA_DISABLE(&hdma_tim2_ch1);
+  htim2.Instance->CCER &= ~TIM_CCER_CC1E;
+  hdma_tim2_ch1.Instance->CNDTR = 2U * capture_line_bytes;
+  htim2.Instance->CCER |= TIM_CCER_CC1E;
+  __HAL_DMA_ENABLE(&hdma_tim2_ch1);
+}
+
+/**
+  * @brief  Configure the camera data, HREF and VSYNC pins
+  * @retval None
+  */
+static void Capture_GPIO_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  /* GPIO Ports Clock Enable */
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+
+  /*Configure GPIO pins : CAM_DATA_Pins */
+  GPIO_InitStruct.Pin = CAM_DATA_Pins;
+  GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(CAM_DATA_GPIO_Port, &GPIO_InitStruct);
+
+  /*Configure GPIO pin : CAM_HREF_Pin */
+  GPIO_InitStruct.Pin = CAM_HREF_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING_FALLING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(CAM_HREF_GPIO_Port, &GPIO_InitStruct);
+
+  /*Configure GPIO pin : CAM_VSYNC_Pin */
+  GPIO_InitStruct.Pin = CAM_VSYNC_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(CAM_VSYNC_GPIO_Port, &GPIO_InitStruct);
+
+  /* EXTI interrupt init, enabled by Capture_Start */
+  HAL_NVIC_SetPriority(CAM_VSYNC_EXTI_IRQn, 0, 0);
+  HAL_NVIC_SetPriority(CAM_HREF_EXTI_IRQn, 0, 0);
+}
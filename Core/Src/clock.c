@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file           : clock.c
+  * @brief          : System clock profiles
+  *
+  *                   Each profile sets SYSCLK, the AHB/APB dividers, the flash
+  *                   wait states and the prefetch buffer. HAL_RCC_ClockConfig
+  *                   updates SystemCoreClock and re-arms SysTick; modules whose
+  *                   timing derives from a bus clock register a callback to be
+  *                   reprogrammed after a runtime switch.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "clock.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t PLLState;      /*!< RCC_PLL_ON or RCC_PLL_OFF          */
+  uint32_t PLLMUL;        /*!< PLL multiplier on HSI/PREDIV       */
+  uint32_t SYSCLKSource;  /*!< System clock source                */
+  uint32_t APB1CLKDivider;/*!< APB1 is limited to 36 MHz          */
+  uint32_t APB2CLKDivider;/*!< APB2 is limited to 72 MHz          */
+  uint32_t FlashLatency;  /*!< 0 WS <= 24 MHz, 1 WS <= 48 MHz, 2 WS <= 72 MHz */
+  uint8_t Prefetch;       /*!< Flash prefetch buffer enable       */
+} Clock_ConfigTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+static const Clock_ConfigTypeDef clock_profiles[CLOCK_PROFILE_COUNT] = {
+  [CLOCK_PROFILE_PERFORMANCE] = {
+    .PLLState = RCC_PLL_ON,
+    .PLLMUL = RCC_PLL_MUL9,
+    .SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK,
+    .APB1CLKDivider = RCC_HCLK_DIV2,
+    .APB2CLKDivider = RCC_HCLK_DIV1,
+    .FlashLatency = FLASH_LATENCY_2,
+    .Prefetch = 1U,
+  },
+  [CLOCK_PROFILE_LOW_POWER] = {
+    .PLLState = RCC_PLL_OFF,
+    .PLLMUL = RCC_PLL_MUL2,
+    .SYSCLKSource = RCC_SYSCLKSOURCE_HSI,
+    .APB1CLKDivider = RCC_HCLK_DIV1,
+    .APB2CLKDivider = RCC_HCLK_DIV1,
+    .FlashLatency = FLASH_LATENCY_0,
+    .Prefetch = 0U,
+  },
+};
+
+static Clock_ChangedCallback clock_callbacks[CLOCK_MAX_CALLBACKS];
+static uint32_t clock_callback_count = 0U;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Switch the system clock to one of the predefined profiles
+  * @note   The core is parked on HSI while the PLL is reconfigured, which is
+  *         also the only window where the prefetch buffer may be toggled
+  *         (SYSCLK < 24 MHz, AHB undivided).
+  * @param  profile: profile to apply
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Clock_SetProfile(Clock_ProfileTypeDef profile)
+{
+  HAL_StatusTypeDef err;
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  const Clock_ConfigTypeDef *config;
+
+  if (profile >= CLOCK_PROFILE_COUNT) {
+    return HAL_ERROR;
+  }
+  config = &clock_profiles[profile];
+
+  /* Leave the PLL before touching it, keeping the current wait states */
+  if (__HAL_RCC_GET_SYSCLK_SOURCE() == RCC_SYSCLKSOURCE_STATUS_PLLCLK) {
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_SYSCLK;
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    err = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, __HAL_FLASH_GET_LATENCY());
+    if (err != HAL_OK) {
+      return err;
+    }
+  }
+
+  if (config->Prefetch) {
+    __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+  } else {
+    __HAL_FLASH_PREFETCH_BUFFER_DISABLE();
+  }
+
+  /** Initializes the RCC Oscillators according to the specified parameters
+  * in the RCC_OscInitTypeDef structure.
+  */
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  RCC_OscInitStruct.PLL.PLLState = config->PLLState;
+  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+  RCC_OscInitStruct.PLL.PREDIV = RCC_PREDIV_DIV1;
+  RCC_OscInitStruct.PLL.PLLMUL = config->PLLMUL;
+
+  err = HAL_RCC_OscConfig(&RCC_OscInitStruct);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  /** Initializes the CPU, AHB and APB buses clocks
+  */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = config->SYSCLKSource;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = config->APB1CLKDivider;
+  RCC_ClkInitStruct.APB2CLKDivider = config->APB2CLKDivider;
+
+  err = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, config->FlashLatency);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  for (uint32_t i = 0U; i < clock_callback_count; i++) {
+    clock_callbacks[i]();
+  }
+
+  return HAL_OK;
+}
+
+/**
+  * @brief  Register a function called after each profile switch
+  * @param  callback: function reprogramming clock-derived peripheral settings
+  * @retval HAL_ERROR if the callback table is full, HAL_OK otherwise
+  */
+HAL_StatusTypeDef Clock_RegisterCallback(Clock_ChangedCallback callback)
+{
+  if (callback == NULL || clock_callback_count >= CLOCK_MAX_CALLBACKS) {
+    return HAL_ERROR;
+  }
+  clock_callbacks[clock_callback_count++] = callback;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Return the kernel clock of timers on APB1 (TIM2/3/4/6/7)
+  * @note   Timer clocks are doubled whenever their APB prescaler is not 1.
+  * @retval Frequency in Hz
+  */
+uint32_t Clock_GetApb1TimerFreq(void)
+{
+  uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+    return 2U * pclk1;
+  }
+  return pclk1;
+}
+
+/**
+  * @brief  Return the kernel clock of timers on APB2 (TIM1/8/15/16/17/20)
+  * @retval Frequency in Hz
+  */
+uint32_t Clock_GetApb2TimerFreq(void)
+{
+  uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+
+  if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+    return 2U * pclk2;
+  }
+  return pclk2;
+}
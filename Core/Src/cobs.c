@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file           : cobs.c
+  * @brief          : Consistent Overhead Byte Stuffing
+  *
+  *                   Encoding removes every zero byte from a packet at a cost
+  *                   of one byte per 254, so a single 0x00 can delimit frames
+  *                   on the wire and a receiver resynchronizes at the next
+  *                   delimiter after any loss.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "cobs.h"
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Encode a packet, without the trailing delimiter
+  * @param  src: packet bytes
+  * @param  len: packet length
+  * @param  dst: destination, at least COBS_ENCODED_MAX(len) bytes
+  * @retval Encoded length
+  */
+uint32_t Cobs_Encode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+  uint32_t code_index = 0U;
+  uint32_t out = 1U;
+  uint8_t code = 1U;
+
+  for (uint32_t i = 0U; i < len; i++) {
+    if (src[i] != 0U) {
+      dst[out++] = src[i];
+      code++;
+    }
+    if (src[i] == 0U || code == 0xFFU) {
+      dst[code_index] = code;
+      code_index = out++;
+      code = 1U;
+    }
+  }
+  dst[code_index] = code;
+  return out;
+}
+
+/**
+  * @brief  Decode one frame, delimiter excluded
+  * @param  src: encoded bytes
+  * @param  len: encoded length
+  * @param  dst: destination, at least len bytes
+  * @retval Decoded length, 0 if the frame is malformed
+  */
+uint32_t Cobs_Decode(const uint8_t *src, uint32_t len, uint8_t *dst)
+{
+  uint32_t in = 0U;
+  uint32_t out = 0U;
+
+  while (in < len) {
+    uint8_t code = src[in++];
+
+    if (code == 0U || in + code - 1U > len) {
+      return 0U;
+    }
+    for (uint8_t i = 1U; i < code; i++) {
+      if (src[in] == 0U) {
+        return 0U;
+      }
+      dst[out++] = src[in++];
+    }
+    if (code != 0xFFU && in < len) {
+      dst[out++] = 0U;
+    }
+  }
+  return out;
+}
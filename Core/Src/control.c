@@ -0,0 +1,340 @@
+/**
+  ******************************************************************************
+  * @file           : control.c
+  * @brief          : Pan/tilt pointing loop
+  *
+  *                   The camera rides the pan/tilt mount and the loop keeps
+  *                   the tracked dot on its boresight. TIM6 ticks once per
+  *                   servo period, CONTROL_LEAD_US before the TIM8 update
+  *                   that latches the command, about ten times per frame.
+  *
+  *                   Camera frames arrive late and at a lower rate, so each
+  *                   tick asks the tracker where the dot will be when the
+  *                   command takes effect, one servo period after the next
+  *                   update. The prediction is in pixels of a frame shot
+  *                   from where the mount pointed at that frame's VSYNC: a
+  *                   history of the commands gives that mount angle, and
+  *                   their sum is the dot bearing. The error is the bearing
+  *                   minus the current command; a PID on it, plus the
+  *                   bearing rate as feed-forward, gives a slew rate that is
+  *                   integrated into the servo pulses. Without a confirmed
+  *                   track the mount holds still and the integrators clear.
+  *
+  *                   Preemption levels: capture 0, this loop 1, everything
+  *                   else below. Tick jitter is then bounded by the longest
+  *                   capture interrupt (the per-line kernels, profiled).
+  *                   Each tick records its own cost and its deviation from
+  *                   the nominal period, in cycles, as profile stages.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "control.h"
+#include "ccm.h"
+#include "clock.h"
+#include "profile.h"
+#include "sensor.h"
+#include "track.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief Loop state of one axis; angles are in camera sense, rad
+  */
+typedef struct
+{
+  float Angle;      /*!< Commanded mount angle from center   */
+  float Integral;   /*!< Error integral, rad.s               */
+  float Error;      /*!< Error of the previous tick          */
+  float Derivative; /*!< Low-passed error rate, rad/s        */
+} Control_AxisTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* Counter clock, one tick per microsecond */
+#define CONTROL_TICK_HZ         1000000U
+#define CONTROL_RATE_HZ         (1000000.0f / CONTROL_PERIOD_US)
+#define CONTROL_DT              (CONTROL_PERIOD_US / 1000000.0f)
+
+/* Derivative low-pass cutoff, in Hz, and its one-pole coefficient */
+#define CONTROL_D_CUTOFF_HZ     30.0f
+#define CONTROL_D_ALPHA \
+  (CONTROL_DT / (CONTROL_DT + 1.0f / (2.0f * 3.14159265f * CONTROL_D_CUTOFF_HZ)))
+
+/* Mount travel either side of center, rad */
+#define CONTROL_MAX_ANGLE \
+  ((float)(SERVO_PULSE_MAX_US - SERVO_PULSE_CENTER_US) / SERVO_US_PER_RAD)
+
+/* Commanded angles kept, in ticks (192 ms), a power of two */
+#define CONTROL_HISTORY         64U
+/* Ticks from a command to the pulses it shapes: latched at the next
+   update, output over the period after it */
+#define CONTROL_LATENCY_TICKS   2U
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim6;
+
+static Control_GainsTypeDef control_gains = {
+  CONTROL_KP, CONTROL_KI, CONTROL_KD, CONTROL_KFF
+};
+
+static Control_AxisTypeDef control_axes[SERVO_COUNT] CCM_BSS;
+static float control_history[CONTROL_HISTORY][SERVO_COUNT] CCM_BSS;
+static uint32_t control_head CCM_BSS;
+static uint32_t control_last_tick CCM_BSS;
+static uint8_t control_ticked CCM_BSS;
+static uint8_t control_locked CCM_BSS;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Control_Tick(void);
+static float Control_Axis(Control_AxisTypeDef *axis, float bearing, float rate);
+static uint16_t Control_Pulse(float angle, float direction);
+static void Control_ClockChanged(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Configure TIM6 for the loop tick; the mount starts centered
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Control_Init(void)
+{
+  HAL_StatusTypeDef err;
+
+  for (uint32_t i = 0U; i < SERVO_COUNT; i++) {
+    control_axes[i] = (Control_AxisTypeDef){ 0.0f, 0.0f, 0.0f, 0.0f };
+    for (uint32_t k = 0U; k < CONTROL_HISTORY; k++) {
+      control_history[k][i] = 0.0f;
+    }
+  }
+  control_head = 0U;
+  control_ticked = 0U;
+  control_locked = 0U;
+
+  htim6.Instance = TIM6;
+  htim6.Init.Prescaler = Clock_GetApb1TimerFreq() / CONTROL_TICK_HZ - 1U;
+  htim6.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim6.Init.Period = CONTROL_PERIOD_US - 1U;
+  htim6.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  err = HAL_TIM_Base_Init(&htim6);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  /* Above everything but the capture path, which must not be delayed */
+  HAL_NVIC_SetPriority(TIM6_DAC_IRQn, 1, 0);
+  HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+
+  return Clock_RegisterCallback(Control_ClockChanged);
+}
+
+/**
+  * @brief  Start ticking, phased CONTROL_LEAD_US ahead of the servo updates
+  * @note   Servo_Start must have been called.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Control_Start(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  HAL_StatusTypeDef err;
+
+  /* Both counters run at 1 MHz over the same period from the same PLL:
+     the phase set here holds */
+  __disable_irq();
+  __HAL_TIM_SET_COUNTER(&htim6,
+                        (__HAL_TIM_GET_COUNTER(&htim8) + CONTROL_LEAD_US) % CONTROL_PERIOD_US);
+  err = HAL_TIM_Base_Start_IT(&htim6);
+  __set_PRIMASK(primask);
+
+  return err;
+}
+
+/**
+  * @brief  Stop ticking; the mount holds its last command
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Control_Stop(void)
+{
+  HAL_StatusTypeDef err;
+
+  err = HAL_TIM_Base_Stop_IT(&htim6);
+  control_ticked = 0U;
+  control_locked = 0U;
+  return err;
+}
+
+/**
+  * @brief  Replace the loop gains
+  * @param  gains: new gains
+  * @retval None
+  */
+void Control_SetGains(const Control_GainsTypeDef *gains)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  control_gains = *gains;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Read the loop gains
+  * @param  gains: destination
+  * @retval None
+  */
+void Control_GetGains(Control_GainsTypeDef *gains)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *gains = control_gains;
+  __set_PRIMASK(primask);
+}
+
+/**
+  * @brief  Period elapsed callback
+  * @param  htim: TIM handle
+  * @retval None
+  */
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  if (htim->Instance == TIM6) {
+    Control_Tick();
+  }
+}
+
+/**
+  * @brief  One loop iteration
+  * @note   Called from the TIM6 interrupt.
+  * @retval None
+  */
+CCM_FUNC static void Control_Tick(void)
+{
+  PROFILE_SCOPE(PROFILE_STAGE_CONTROL);
+  const uint32_t now = DWT->CYCCNT;
+  const uint32_t cycles_per_us = SystemCoreClock / CONTROL_TICK_HZ;
+  const uint32_t period = CONTROL_PERIOD_US * cycles_per_us;
+  const float *previous = control_history[control_head];
+  float *next;
+  Track_PredictionTypeDef target;
+
+  if (control_ticked) {
+    const int32_t late = (int32_t)(now - control_last_tick - period);
+
+    Profile_Record(PROFILE_STAGE_CONTROL_JITTER, (uint32_t)(late < 0 ? -late : late));
+  }
+  control_last_tick = now;
+  control_ticked = 1U;
+
+  control_head = (control_head + 1U) & (CONTROL_HISTORY - 1U);
+  next = control_history[control_head];
+
+  if (!Track_Predict(now + (CONTROL_LEAD_US + CONTROL_PERIOD_US) * cycles_per_us, &target)
+      || target.Hits < CONTROL_MIN_HITS) {
+    /* Hold still, and start afresh on the next lock */
+    control_locked = 0U;
+    for (uint32_t i = 0U; i < SERVO_COUNT; i++) {
+      control_axes[i].Integral = 0.0f;
+      control_axes[i].Derivative = 0.0f;
+      next[i] = previous[i];
+    }
+    return;
+  }
+
+  {
+    /* Mount angle and rate at the VSYNC of the last measured frame */
+    uint32_t back = (now - target.Time) / period + CONTROL_LATENCY_TICKS;
+    const float *then;
+    const float *before;
+    float bearing[SERVO_COUNT];
+    float rate[SERVO_COUNT];
+
+    if (back > CONTROL_HISTORY - 2U) {
+      back = CONTROL_HISTORY - 2U;
+    }
+    then = control_history[(control_head - back) & (CONTROL_HISTORY - 1U)];
+    before = control_history[(control_head - back - 1U) & (CONTROL_HISTORY - 1U)];
+
+    bearing[SERVO_PAN] = then[SERVO_PAN]
+      + (target.X - SENSOR_WIDTH / 2.0f) * CONTROL_RAD_PER_PIXEL;
+    bearing[SERVO_TILT] = then[SERVO_TILT]
+      + (target.Y - SENSOR_HEIGHT / 2.0f) * CONTROL_RAD_PER_PIXEL;
+    rate[SERVO_PAN] = (then[SERVO_PAN] - before[SERVO_PAN]) * CONTROL_RATE_HZ
+      + target.VX * CONTROL_RAD_PER_PIXEL;
+    rate[SERVO_TILT] = (then[SERVO_TILT] - before[SERVO_TILT]) * CONTROL_RATE_HZ
+      + target.VY * CONTROL_RAD_PER_PIXEL;
+
+    if (!control_locked) {
+      /* No derivative kick on acquisition */
+      for (uint32_t i = 0U; i < SERVO_COUNT; i++) {
+        control_axes[i].Error = bearing[i] - control_axes[i].Angle;
+      }
+      control_locked = 1U;
+    }
+    for (uint32_t i = 0U; i < SERVO_COUNT; i++) {
+      next[i] = Control_Axis(&control_axes[i], bearing[i], rate[i]);
+    }
+  }
+
+  Servo_SetPulses(Control_Pulse(next[SERVO_PAN], CONTROL_PAN_DIRECTION),
+                  Control_Pulse(next[SERVO_TILT], CONTROL_TILT_DIRECTION));
+}
+
+/**
+  * @brief  PID with feed-forward on one axis, integrated into its angle
+  * @param  axis: axis state
+  * @param  bearing: dot bearing at actuation time, rad
+  * @param  rate: dot bearing rate, rad/s
+  * @retval New commanded angle, rad
+  */
+CCM_FUNC static float Control_Axis(Control_AxisTypeDef *axis, float bearing, float rate)
+{
+  const float error = bearing - axis->Angle;
+  float slew;
+  float angle;
+
+  axis->Derivative += CONTROL_D_ALPHA
+    * ((error - axis->Error) * CONTROL_RATE_HZ - axis->Derivative);
+  axis->Error = error;
+
+  slew = control_gains.Kp * error + control_gains.Ki * axis->Integral
+    + control_gains.Kd * axis->Derivative + control_gains.Kff * rate;
+  if (slew > CONTROL_MAX_RATE) {
+    slew = CONTROL_MAX_RATE;
+  } else if (slew < -CONTROL_MAX_RATE) {
+    slew = -CONTROL_MAX_RATE;
+  }
+
+  /* At a travel stop, stop integrating too */
+  angle = axis->Angle + slew * CONTROL_DT;
+  if (angle > CONTROL_MAX_ANGLE) {
+    angle = CONTROL_MAX_ANGLE;
+  } else if (angle < -CONTROL_MAX_ANGLE) {
+    angle = -CONTROL_MAX_ANGLE;
+  } else {
+    axis->Integral += error * CONTROL_DT;
+  }
+  axis->Angle = angle;
+  return angle;
+}
+
+/**
+  * @brief  Servo pulse width for a mount angle
+  * @param  angle: angle from center, rad, camera sense
+  * @param  direction: CONTROL_PAN_DIRECTION or CONTROL_TILT_DIRECTION
+  * @retval Pulse width, microseconds
+  */
+CCM_FUNC static uint16_t Control_Pulse(float angle, float direction)
+{
+  return (uint16_t)((float)SERVO_PULSE_CENTER_US + direction * angle * SERVO_US_PER_RAD + 0.5f);
+}
+
+/**
+  * @brief  Keep the counter at 1 MHz after a clock profile switch
+  * @note   The prescaler is preloaded: the current period finishes at the
+  *         old rate.
+  * @retval None
+  */
+static void Control_ClockChanged(void)
+{
+  __HAL_TIM_SET_PRESCALER(&htim6, Clock_GetApb1TimerFreq() / CONTROL_TICK_HZ - 1U);
+  control_ticked = 0U;
+}
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file           : crc.c
+  * @brief          : CRC-32/zlib on the CRC calculation unit
+  *
+  *                   The unit is set up for the IEEE 802.3 / zlib variant
+  *                   (byte-reflected input, reflected output, final XOR in
+  *                   software) so that any standard implementation on the
+  *                   host agrees with it. The HAL CRC driver is not part of
+  *                   this tree: the unit is programmed through its registers.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crc.h"
+#include "main.h"
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Enable the CRC unit and configure it for CRC-32/zlib
+  * @retval None
+  */
+void Crc_Init(void)
+{
+  __HAL_RCC_CRC_CLK_ENABLE();
+
+  /* Default polynomial, 32-bit; input reflected per byte, output reflected */
+  CRC->POL = 0x04C11DB7U;
+  CRC->INIT = 0xFFFFFFFFU;
+  CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT;
+}
+
+/**
+  * @brief  CRC-32/zlib of a buffer
+  * @param  data: bytes, word aligned for the fast path
+  * @param  len: number of bytes
+  * @retval CRC
+  */
+uint32_t Crc_Compute(const uint8_t *data, uint32_t len)
+{
+  uint32_t i = 0U;
+
+  CRC->CR |= CRC_CR_RESET;
+
+  /* With per-byte reflection the unit consumes a word MSB first: swap so
+     that bytes enter in memory order */
+  if (((uintptr_t)data & 3U) == 0U) {
+    for (; i + 4U <= len; i += 4U) {
+      CRC->DR = __REV(*(const uint32_t *)(const void *)&data[i]);
+    }
+  }
+  for (; i < len; i++) {
+    *(__IO uint8_t *)(__IO void *)&CRC->DR = data[i];
+  }
+  return ~CRC->DR;
+}
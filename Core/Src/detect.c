@@ -0,0 +1,356 @@
+/**
+  ******************************************************************************
+  * @file           : detect.c
+  * @brief          : Line-streaming dot detection
+  *
+  *                   Each captured line is thresholded into runs of
+  *                   foreground samples as soon as its DMA half completes,
+  *                   and the runs are handed on to the labeler and the
+  *                   mask: this is the only pass over the pixels, and the
+  *                   stages after it cost in proportion to the dot area
+  *                   rather than to the line length. RGB565 lines are
+  *                   weighed by redness instead of luminance, which picks a
+  *                   red laser out of bright backgrounds; the runs are cut
+  *                   from the redness line.
+  *
+  *                   Known hot pixels are taken out of the runs of the
+  *                   lines that hold one, before anything else sees them,
+  *                   with Kernel_MaskRuns and the line map of hotpix.c.
+  *
+  *                   The first DETECT_MAX_FRAME_RUNS runs of each frame are
+  *                   also kept with their line index. For a dot frame that
+  *                   is the whole foreground, a compact dump of what the
+  *                   pipeline saw.
+  *
+  *                   For the adaptive threshold, one line in
+  *                   DETECT_HIST_LINE_STEP is also binned into a histogram
+  *                   right after its runs; at frame end a single walk over
+  *                   the 64 bins yields the next frame's threshold, without
+  *                   another pass over the pixels. Nothing here depends on
+  *                   the HAL; the runs are published to thread mode through
+  *                   a sequence counter rather than by masking interrupts.
+  *
+  *                   With PROFILE_ENABLED the binned lines are also cut by
+  *                   the scalar reference kernel, and both kernels timed on
+  *                   them in cycles per 256 samples, which gives the cycles
+  *                   per pixel of each on live frames.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "ccm.h"
+#include "detect.h"
+#include "hotpix.h"
+#include "kernel.h"
+#include "profile.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Largest share of binned samples above the threshold, per mille, still
+   taken for the dot and left out of the scene percentile */
+#define DETECT_FOREGROUND_MAX   100U
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t detect_threshold;
+static uint8_t detect_stride;
+/* Redness of the last RGB565 line */
+static uint8_t detect_score[DETECT_MAX_COLOR_PIXELS] CCM_BSS;
+/* Runs of the last line, valid until the next one */
+static Kernel_RunTypeDef detect_line_runs[DETECT_MAX_LINE_RUNS] CCM_BSS;
+
+/* Adaptive threshold, inactive while Percentile is 0 */
+static Detect_AutoTypeDef detect_auto;
+static uint32_t detect_hist[KERNEL_HIST_BINS] CCM_BSS;
+
+static Detect_RunsTypeDef detect_runs_build CCM_BSS;
+static volatile uint32_t detect_runs_seq;
+static Detect_RunsTypeDef detect_runs_published;
+static uint32_t detect_runs_read_seq;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t Detect_Runs(const uint8_t *line, uint32_t line_bytes, uint32_t stride,
+                            uint16_t y);
+#if PROFILE_ENABLED
+static void Detect_TimeKernels(const uint8_t *line, uint32_t line_bytes, uint32_t stride);
+#endif
+static void Detect_UpdateThreshold(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the detector
+  * @param  threshold: intensities at or below this value weigh nothing
+  * @param  pixel_stride: bytes between two luminance samples (2 for YUV422)
+  * @retval None
+  */
+void Detect_Init(uint8_t threshold, uint8_t pixel_stride)
+{
+  detect_threshold = threshold;
+  detect_stride = pixel_stride;
+  detect_auto = (Detect_AutoTypeDef){0};
+  memset(detect_hist, 0, sizeof(detect_hist));
+  detect_runs_build.Count = 0U;
+  detect_runs_build.Dropped = 0U;
+}
+
+/**
+  * @brief  Return the threshold in use
+  * @retval Threshold; the adaptive one changes at each frame end
+  */
+uint8_t Detect_GetThreshold(void)
+{
+  return detect_threshold;
+}
+
+/**
+  * @brief  Turn the adaptive threshold on or off, effective from the next
+  *         frame
+  * @param  config: adaptive threshold settings, NULL to keep the current
+  *         threshold fixed
+  * @retval None
+  */
+void Detect_SetAuto(const Detect_AutoTypeDef *config)
+{
+  Detect_AutoTypeDef a = {0};
+
+  if (config != NULL && config->Percentile != 0U && config->Percentile <= 1000U
+      && config->Min <= config->Max) {
+    a = *config;
+  }
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  detect_auto.Percentile = 0U;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  detect_auto.Margin = a.Margin;
+  detect_auto.Min = a.Min;
+  detect_auto.Max = a.Max;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  detect_auto.Percentile = a.Percentile;
+}
+
+/**
+  * @brief  Cut one line into runs
+  * @note   Runs from the capture DMA interrupt; w = max(p - threshold, 0).
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  y: line index in the frame
+  * @param  runs: set to the runs of the line, valid until the next call
+  * @retval Number of runs
+  */
+CCM_FUNC uint16_t Detect_Line(const uint8_t *line, uint16_t line_bytes, uint16_t y,
+                              const Kernel_RunTypeDef **runs)
+{
+  const uint16_t count = Detect_Runs(line, line_bytes, detect_stride, y);
+
+  if (detect_auto.Percentile != 0U && y % DETECT_HIST_LINE_STEP == 0U) {
+    Kernel_Histogram(line, line_bytes, detect_stride, detect_hist);
+  }
+  *runs = detect_line_runs;
+  return count;
+}
+
+/**
+  * @brief  Score one RGB565 line by redness and cut the scores into runs
+  * @note   Runs from the capture DMA interrupt; the score is
+  *         max(R - max(G, B), 0) on an 8-bit scale and is thresholded like a
+  *         luminance sample. Pixels past DETECT_MAX_COLOR_PIXELS are ignored.
+  * @param  line: captured bytes, two per pixel
+  * @param  line_bytes: number of bytes in the line
+  * @param  y: line index in the frame
+  * @param  runs: set to the runs of the line, valid until the next call
+  * @retval Number of runs
+  */
+CCM_FUNC uint16_t Detect_ColorLine(const uint8_t *line, uint16_t line_bytes, uint16_t y,
+                                   const Kernel_RunTypeDef **runs)
+{
+  uint16_t count;
+
+  if (line_bytes > 2U * DETECT_MAX_COLOR_PIXELS) {
+    line_bytes = 2U * DETECT_MAX_COLOR_PIXELS;
+  }
+  Kernel_RednessScores(line, line_bytes, detect_score);
+  count = Detect_Runs(detect_score, line_bytes / 2U, 1U, y);
+  if (detect_auto.Percentile != 0U && y % DETECT_HIST_LINE_STEP == 0U) {
+    Kernel_Histogram(detect_score, line_bytes / 2U, 1U, detect_hist);
+  }
+  *runs = detect_line_runs;
+  return count;
+}
+
+/**
+  * @brief  Redness scores of the last line passed to Detect_ColorLine
+  * @note   Valid until the next call; one byte per pixel.
+  * @retval Scores
+  */
+CCM_FUNC const uint8_t *Detect_GetScores(void)
+{
+  return detect_score;
+}
+
+/**
+  * @brief  Cut a line into runs, take the hot pixels out of them and keep
+  *         the first runs of the frame
+  * @param  line: samples
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples
+  * @param  y: line index in the frame
+  * @retval Number of runs in detect_line_runs
+  */
+CCM_FUNC static uint16_t Detect_Runs(const uint8_t *line, uint32_t line_bytes, uint32_t stride,
+                                     uint16_t y)
+{
+  Detect_RunsTypeDef *f = &detect_runs_build;
+  uint16_t hot_count;
+  const uint16_t *hot = Hotpix_GetLine(y, &hot_count);
+  uint32_t found;
+  uint16_t count;
+
+#if PROFILE_ENABLED
+  if (y % DETECT_HIST_LINE_STEP == 0U) {
+    Detect_TimeKernels(line, line_bytes, stride);
+  }
+#endif
+  found = Kernel_ThresholdRuns(line, line_bytes, stride, detect_threshold,
+                               detect_line_runs, DETECT_MAX_LINE_RUNS);
+  count = (uint16_t)(found < DETECT_MAX_LINE_RUNS ? found : DETECT_MAX_LINE_RUNS);
+
+  f->Dropped += (uint16_t)(found - count);
+  if (hot_count != 0U && count != 0U) {
+    count = (uint16_t)Kernel_MaskRuns(line, stride, detect_threshold, hot, hot_count,
+                                      detect_line_runs, count);
+  }
+
+  for (uint16_t k = 0U; k < count; k++) {
+    if (f->Count == DETECT_MAX_FRAME_RUNS) {
+      f->Dropped += count - k;
+      break;
+    }
+    f->Runs[f->Count].Y = y;
+    f->Runs[f->Count].Start = detect_line_runs[k].Start;
+    f->Runs[f->Count].Length = detect_line_runs[k].Length;
+    f->Runs[f->Count].Sum = detect_line_runs[k].Sum;
+    f->Count++;
+  }
+  return count;
+}
+
+#if PROFILE_ENABLED
+/**
+  * @brief  Time the packed kernel and its reference on one line
+  * @note   Both write detect_line_runs, which the caller fills again right
+  *         after. Recorded in cycles per 256 samples.
+  * @param  line: samples
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples
+  * @retval None
+  */
+CCM_FUNC static void Detect_TimeKernels(const uint8_t *line, uint32_t line_bytes, uint32_t stride)
+{
+  const uint32_t samples = (line_bytes + stride - 1U) / stride;
+  uint32_t start;
+  uint32_t cycles;
+
+  if (samples == 0U) {
+    return;
+  }
+  start = Profile_Now();
+  (void)Kernel_ThresholdRuns_Ref(line, line_bytes, stride, detect_threshold,
+                                 detect_line_runs, DETECT_MAX_LINE_RUNS);
+  cycles = Profile_Now() - start;
+  Profile_Record(PROFILE_STAGE_RUNS_REF, cycles * 256U / samples);
+
+  start = Profile_Now();
+  (void)Kernel_ThresholdRuns(line, line_bytes, stride, detect_threshold,
+                             detect_line_runs, DETECT_MAX_LINE_RUNS);
+  cycles = Profile_Now() - start;
+  Profile_Record(PROFILE_STAGE_RUNS_KERNEL, cycles * 256U / samples);
+}
+#endif
+
+/**
+  * @brief  Publish the runs kept from the frame and set the next frame's
+  *         threshold
+  * @param  frame: capture frame sequence number
+  * @retval None
+  */
+void Detect_EndFrame(uint32_t frame)
+{
+  Detect_UpdateThreshold();
+
+  detect_runs_build.Frame = frame;
+  detect_runs_seq++;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  detect_runs_published = detect_runs_build;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  detect_runs_seq++;
+  detect_runs_build.Count = 0U;
+  detect_runs_build.Dropped = 0U;
+}
+
+/**
+  * @brief  Derive the next frame's threshold from the histogram, then clear
+  *         it
+  * @note   The level is the upper edge of the bin where the cumulative
+  *         count crosses the percentile. Bins wholly above the threshold
+  *         are the dot rather than the scene and are left out, unless they
+  *         hold more than DETECT_FOREGROUND_MAX of the samples: in a
+  *         tracking window the dot is large enough to move a percentile,
+  *         while a whole scene getting brighter must still raise it. The
+  *         threshold moves halfway towards its new value each frame, so
+  *         one odd frame does not make it jump.
+  * @retval None
+  */
+static void Detect_UpdateThreshold(void)
+{
+  const Detect_AutoTypeDef a = detect_auto;
+  const uint32_t scene_bins = ((uint32_t)detect_threshold >> KERNEL_HIST_SHIFT) + 1U;
+  uint32_t total = 0U;
+  uint32_t scene = 0U;
+  uint32_t target;
+  uint32_t level;
+  uint32_t b;
+
+  if (a.Percentile == 0U) {
+    return;
+  }
+  for (b = 0U; b < KERNEL_HIST_BINS; b++) {
+    total += detect_hist[b];
+    scene += b < scene_bins ? detect_hist[b] : 0U;
+  }
+  if ((total - scene) * 1000U <= total * DETECT_FOREGROUND_MAX) {
+    total = scene;
+  }
+  if (total != 0U) {
+    target = (uint32_t)(((uint64_t)total * a.Percentile) / 1000U);
+    for (b = 0U; b < KERNEL_HIST_BINS - 1U && target >= detect_hist[b]; b++) {
+      target -= detect_hist[b];
+    }
+    level = ((b + 1U) << KERNEL_HIST_SHIFT) - 1U + a.Margin;
+    level = level < a.Min ? a.Min : level > a.Max ? a.Max : level;
+    detect_threshold = (uint8_t)((detect_threshold + level + 1U) / 2U);
+  }
+  memset(detect_hist, 0, sizeof(detect_hist));
+}
+
+/**
+  * @brief  Fetch the runs kept from the latest frame
+  * @param  runs: destination
+  * @retval 1 if the frame is newer than the previous call, 0 otherwise
+  */
+uint8_t Detect_GetRuns(Detect_RunsTypeDef *runs)
+{
+  uint32_t seq;
+
+  do {
+    seq = detect_runs_seq;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    *runs = detect_runs_published;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  } while ((seq & 1U) != 0U || seq != detect_runs_seq);
+
+  if (seq == detect_runs_read_seq) {
+    return 0U;
+  }
+  detect_runs_read_seq = seq;
+  return 1U;
+}
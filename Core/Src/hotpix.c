@@ -0,0 +1,383 @@
+/**
+  ******************************************************************************
+  * @file           : hotpix.c
+  * @brief          : Hot pixel map
+  *
+  *                   A stuck-bright pixel clears the detection threshold on
+  *                   every frame: it shows up as a one-pixel dot that the
+  *                   labeler, the ROI search and the tracker all have to
+  *                   see through. Such pixels are found once, on dark
+  *                   frames taken with the lens covered, and kept in the
+  *                   parameter store as a sorted list of output pixel
+  *                   coordinates with the frame size they were found at,
+  *                   which param.c guards with a CRC. A calibration
+  *                   follows the bright samples of HOTPIX_CAL_FRAMES
+  *                   frames, thresholded with the run kernel, and keeps
+  *                   those bright in at least HOTPIX_CAL_HITS of them;
+  *                   anything wider than HOTPIX_CAL_MAX_RUN is light, not a
+  *                   defect, and fails it.
+  *
+  *                   The detector does not look the pixels up one by one.
+  *                   Each readout window gets its own map, built in thread
+  *                   mode when the window is programmed: the hot pixels
+  *                   that the window reads out, as window samples, sorted
+  *                   by line. A cursor walks the map as the lines stream,
+  *                   so a line without a hot pixel costs one compare, and
+  *                   on the others Kernel_MaskRuns takes the listed
+  *                   columns out of the runs after thresholding: the pixel
+  *                   loop itself is unchanged. The map in use is latched at
+  *                   the first line of each frame; one built while another
+  *                   waits to be latched reuses its buffer, which only
+  *                   happens on a frame straddling a window change, which
+  *                   is discarded anyway.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "ccm.h"
+#include "hotpix.h"
+#include "kernel.h"
+#include "param.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief Stored map, PARAM_KEY_HOTPIX; the value length gives the count
+  */
+typedef struct
+{
+  uint16_t Width;     /*!< Output frame size the map was calibrated at  */
+  uint16_t Height;
+  Hotpix_PixelTypeDef Pixels[HOTPIX_MAX_PIXELS];
+} Hotpix_RecordTypeDef;
+
+/**
+  * @brief Hot pixels of one readout window, sorted by line then column
+  */
+typedef struct
+{
+  uint16_t Count;
+  uint16_t Lines[HOTPIX_MAX_PIXELS];    /*!< Window line of each pixel    */
+  uint16_t Columns[HOTPIX_MAX_PIXELS];  /*!< Window sample of each pixel  */
+} Hotpix_MapTypeDef;
+
+/**
+  * @brief Bright pixel followed by a calibration
+  */
+typedef struct
+{
+  uint16_t X;
+  uint16_t Y;
+  uint16_t Hits;    /*!< Frames it was bright in, 0 for a free entry */
+} Hotpix_CandidateTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* Runs taken from one dark line; more means light reaches the sensor */
+#define HOTPIX_CAL_RUNS         16U
+
+/* Private variables ---------------------------------------------------------*/
+static Hotpix_PixelTypeDef hotpix_pixels[HOTPIX_MAX_PIXELS];
+static uint16_t hotpix_count;
+static Sensor_WindowTypeDef hotpix_window;
+
+static Hotpix_MapTypeDef hotpix_maps[2];
+static volatile uint8_t hotpix_published;
+static uint8_t hotpix_active;
+static uint16_t hotpix_cursor;
+
+static Hotpix_CandidateTypeDef hotpix_candidates[HOTPIX_CAL_CANDIDATES];
+static Kernel_RunTypeDef hotpix_cal_runs[HOTPIX_CAL_RUNS];
+static volatile uint8_t hotpix_calibrating;
+static uint8_t hotpix_cal_failed;
+static uint32_t hotpix_cal_frames;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Hotpix_Load(void);
+static void Hotpix_Build(void);
+static void Hotpix_Hit(uint16_t x, uint16_t y);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Load the map from the parameter store
+  * @note   A missing or foreign map leaves the map empty. Call after
+  *         Param_Init and before Roi_Init, which programs the first window.
+  * @retval None
+  */
+void Hotpix_Init(void)
+{
+  hotpix_maps[0].Count = 0U;
+  hotpix_maps[1].Count = 0U;
+  hotpix_published = 0U;
+  hotpix_window = (Sensor_WindowTypeDef){ 0U, 0U, 0U, 0U, 1U };
+  Hotpix_Load();
+}
+
+/**
+  * @brief  Return the hot pixels of the map
+  * @param  pixels: set to the list, sorted by row then column
+  * @retval Number of pixels
+  */
+uint16_t Hotpix_GetPixels(const Hotpix_PixelTypeDef **pixels)
+{
+  *pixels = hotpix_pixels;
+  return hotpix_count;
+}
+
+/**
+  * @brief  Build the map of a new readout window, effective from the next
+  *         frame
+  * @note   Call from thread mode whenever the window is programmed. At
+  *         search scale only the pixels on the rows and columns the sensor
+  *         keeps are read out.
+  * @param  window: readout window
+  * @retval None
+  */
+void Hotpix_SetWindow(const Sensor_WindowTypeDef *window)
+{
+  hotpix_window = *window;
+  Hotpix_Build();
+}
+
+/**
+  * @brief  Return the hot columns of a window line
+  * @note   Runs from the capture DMA interrupt, for every line in order:
+  *         line 0 latches the map of the frame.
+  * @param  y: line index in the frame
+  * @param  count: set to the number of columns
+  * @retval Columns, ascending, valid until the next call
+  */
+CCM_FUNC const uint16_t *Hotpix_GetLine(uint16_t y, uint16_t *count)
+{
+  const Hotpix_MapTypeDef *map;
+  uint16_t first;
+
+  if (y == 0U) {
+    hotpix_active = hotpix_published;
+    hotpix_cursor = 0U;
+  }
+  map = &hotpix_maps[hotpix_active];
+  while (hotpix_cursor < map->Count && map->Lines[hotpix_cursor] < y) {
+    hotpix_cursor++;
+  }
+  first = hotpix_cursor;
+  while (hotpix_cursor < map->Count && map->Lines[hotpix_cursor] == y) {
+    hotpix_cursor++;
+  }
+  *count = hotpix_cursor - first;
+  return &map->Columns[first];
+}
+
+/**
+  * @brief  Start a calibration at the next frame
+  * @note   The lens must be covered and the window the full frame at
+  *         scale 1, as programmed by the sensor mode table.
+  * @retval None
+  */
+void Hotpix_StartCalibration(void)
+{
+  memset(hotpix_candidates, 0, sizeof(hotpix_candidates));
+  hotpix_cal_failed = 0U;
+  hotpix_cal_frames = 0U;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  hotpix_calibrating = 1U;
+}
+
+/**
+  * @brief  Tell whether a calibration is still capturing
+  * @retval 1 until HOTPIX_CAL_FRAMES frames have been seen
+  */
+uint8_t Hotpix_IsCalibrating(void)
+{
+  return hotpix_calibrating;
+}
+
+/**
+  * @brief  Follow the bright samples of one dark line
+  * @note   Runs from the capture DMA interrupt; returns at once outside a
+  *         calibration. Each bright sample searches the candidate table, up
+  *         to HOTPIX_CAL_RUNS * HOTPIX_CAL_MAX_RUN * HOTPIX_CAL_CANDIDATES
+  *         compares on a line before the calibration fails, so it and
+  *         Hotpix_Hit run from CCM like the rest of the line path.
+  * @param  line: samples
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples
+  * @param  y: line index in the frame
+  * @retval None
+  */
+CCM_FUNC void Hotpix_CalibrateLine(const uint8_t *line, uint16_t line_bytes, uint16_t stride,
+                                   uint16_t y)
+{
+  uint32_t found;
+
+  if (!hotpix_calibrating || hotpix_cal_failed) {
+    return;
+  }
+  found = Kernel_ThresholdRuns(line, line_bytes, stride, HOTPIX_CAL_THRESHOLD, hotpix_cal_runs,
+                               HOTPIX_CAL_RUNS);
+  if (found > HOTPIX_CAL_RUNS) {
+    hotpix_cal_failed = 1U;
+    return;
+  }
+  for (uint32_t k = 0U; k < found; k++) {
+    const Kernel_RunTypeDef *r = &hotpix_cal_runs[k];
+
+    if (r->Length > HOTPIX_CAL_MAX_RUN) {
+      hotpix_cal_failed = 1U;
+      return;
+    }
+    for (uint16_t x = r->Start; x < r->Start + r->Length; x++) {
+      Hotpix_Hit(x, y);
+    }
+  }
+}
+
+/**
+  * @brief  Count a calibration frame
+  * @note   Runs from the capture frame-complete interrupt.
+  * @param  frame: capture frame sequence number
+  * @retval None
+  */
+void Hotpix_EndFrame(uint32_t frame)
+{
+  UNUSED(frame);
+  if (hotpix_calibrating && ++hotpix_cal_frames == HOTPIX_CAL_FRAMES) {
+    hotpix_calibrating = 0U;
+  }
+}
+
+/**
+  * @brief  Write the map of the last calibration to flash and use it
+  * @note   Call from thread mode once Hotpix_IsCalibrating returns 0, with
+  *         the capture stopped: the write is flushed at once, and the CPU
+  *         stalls on flash fetches for up to 80 ms if it compacts the
+  *         parameter store.
+  * @retval HAL status; HAL_ERROR if the calibration saw light or found more
+  *         than HOTPIX_MAX_PIXELS hot pixels
+  */
+HAL_StatusTypeDef Hotpix_Store(void)
+{
+  Hotpix_RecordTypeDef record = { SENSOR_WIDTH, SENSOR_HEIGHT, { { 0U, 0U } } };
+  Hotpix_PixelTypeDef *pixels = record.Pixels;
+  uint16_t count = 0U;
+  HAL_StatusTypeDef err;
+
+  if (hotpix_calibrating || hotpix_cal_failed) {
+    return HAL_ERROR;
+  }
+
+  /* Insertion sort by row then column */
+  for (uint32_t i = 0U; i < HOTPIX_CAL_CANDIDATES; i++) {
+    const Hotpix_CandidateTypeDef *c = &hotpix_candidates[i];
+    uint32_t k;
+
+    if (c->Hits < HOTPIX_CAL_HITS) {
+      continue;
+    }
+    if (count == HOTPIX_MAX_PIXELS) {
+      return HAL_ERROR;
+    }
+    for (k = count; k > 0U && (pixels[k - 1U].Y > c->Y
+                                      || (pixels[k - 1U].Y == c->Y && pixels[k - 1U].X > c->X));
+         k--) {
+      pixels[k] = pixels[k - 1U];
+    }
+    pixels[k] = (Hotpix_PixelTypeDef){ c->X, c->Y };
+    count++;
+  }
+
+  err = Param_Set(PARAM_KEY_HOTPIX, &record,
+                  (uint16_t)(offsetof(Hotpix_RecordTypeDef, Pixels) + count * sizeof(pixels[0])));
+  if (err == HAL_OK) {
+    err = Param_Flush();
+  }
+  if (err != HAL_OK) {
+    return err;
+  }
+  Hotpix_Load();
+  Hotpix_Build();
+  return hotpix_count == count ? HAL_OK : HAL_ERROR;
+}
+
+/**
+  * @brief  Copy the stored map, if it fits this frame size, to the pixel
+  *         list
+  * @retval None
+  */
+static void Hotpix_Load(void)
+{
+  Hotpix_RecordTypeDef record;
+  const uint16_t length = Param_Get(PARAM_KEY_HOTPIX, &record, sizeof(record));
+  const size_t bytes = length - offsetof(Hotpix_RecordTypeDef, Pixels);
+
+  hotpix_count = 0U;
+  if (length < offsetof(Hotpix_RecordTypeDef, Pixels) || length > sizeof(record)
+      || bytes % sizeof(record.Pixels[0]) != 0U
+      || record.Width != SENSOR_WIDTH || record.Height != SENSOR_HEIGHT) {
+    return;
+  }
+  memcpy(hotpix_pixels, record.Pixels, bytes);
+  hotpix_count = (uint16_t)(bytes / sizeof(record.Pixels[0]));
+}
+
+/**
+  * @brief  Build the map of hotpix_window into the buffer not latched by
+  *         the capture, then publish it
+  * @retval None
+  */
+static void Hotpix_Build(void)
+{
+  const Sensor_WindowTypeDef *w = &hotpix_window;
+  Hotpix_MapTypeDef *map = &hotpix_maps[hotpix_active ^ 1U];
+  uint16_t count = 0U;
+
+  map->Count = 0U;
+  for (uint32_t i = 0U; i < hotpix_count; i++) {
+    const uint32_t dx = (uint32_t)hotpix_pixels[i].X - w->X;
+    const uint32_t dy = (uint32_t)hotpix_pixels[i].Y - w->Y;
+
+    /* Left of or above the window wraps around to a large offset */
+    if (dx >= w->Width || dy >= w->Height || dx % w->Scale != 0U || dy % w->Scale != 0U) {
+      continue;
+    }
+    map->Lines[count] = (uint16_t)(dy / w->Scale);
+    map->Columns[count] = (uint16_t)(dx / w->Scale);
+    count++;
+  }
+  map->Count = count;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  hotpix_published = hotpix_active ^ 1U;
+}
+
+/**
+  * @brief  Count a bright sample of the frame being calibrated
+  * @note   Pixels that can no longer reach HOTPIX_CAL_HITS free their entry
+  *         for new ones, so that isolated flashes from noise do not fill
+  *         the table.
+  * @param  x: column
+  * @param  y: row
+  * @retval None
+  */
+CCM_FUNC static void Hotpix_Hit(uint16_t x, uint16_t y)
+{
+  const uint32_t remaining = HOTPIX_CAL_FRAMES - hotpix_cal_frames;
+  Hotpix_CandidateTypeDef *free_entry = NULL;
+
+  for (uint32_t i = 0U; i < HOTPIX_CAL_CANDIDATES; i++) {
+    Hotpix_CandidateTypeDef *c = &hotpix_candidates[i];
+
+    if (c->Hits != 0U && c->X == x && c->Y == y) {
+      c->Hits++;
+      return;
+    }
+    if (free_entry == NULL && (c->Hits == 0U || c->Hits + remaining < HOTPIX_CAL_HITS)) {
+      free_entry = c;
+    }
+  }
+  if (free_entry == NULL) {
+    hotpix_cal_failed = 1U;
+    return;
+  }
+  *free_entry = (Hotpix_CandidateTypeDef){ x, y, 1U };
+}
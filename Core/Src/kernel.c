@@ -0,0 +1,440 @@
+/**
+  ******************************************************************************
+  * @file           : kernel.c
+  * @brief          : Per-line pixel kernels
+  *
+  *                   Kernel_ThresholdRuns cuts a line into runs of samples
+  *                   above the threshold and sums each run as it goes, with
+  *                   the moments taken about the first column of the run so
+  *                   they fit 32 bits. It handles a word per iteration, four
+  *                   samples at stride 1 and two at stride 2:
+  *                     UQSUB8  w = max(p - t, 0) on every lane at once
+  *                     USUB8   GE flags set on lanes with w >= 1,
+  *                     SEL     turned into the foreground mask of the word
+  *                   A word of background costs a load, a UQSUB8 and a
+  *                   branch. A word of foreground inside a run is summed
+  *                   packed, with d = d0 + k on lane k:
+  *                     USADA8  sum of w
+  *                     SMLAD   sum of w * d, the d ramp against the w lanes
+  *                             widened by UXTB16
+  *                     SMLAD   sum of w * k^2, so that
+  *                             sum of w * d^2 = 2 d0 S(wd) - d0^2 S(w)
+  *                                              + S(wk^2)
+  *                   Only the words where a run starts or ends are taken a
+  *                   sample at a time. Every later stage works from the
+  *                   runs instead of the pixels. With PROFILE_ENABLED the
+  *                   detector times this kernel and the reference on the
+  *                   same lines with the DWT (see detect.c).
+  *                   Kernel_MaskRuns then takes listed columns, the hot
+  *                   pixels of the line, back out of the runs, at a cost
+  *                   per column rather than per sample.
+  *
+  *                   Kernel_RednessScores scores RGB565 pixels by how much
+  *                   red exceeds the stronger of green and blue, two pixels
+  *                   per word:
+  *                     USUB16  GE flags set on lanes where G >= B,
+  *                     SEL     max(G, B) on both lanes
+  *                     UQSUB16 score = max(R - max(G, B), 0)
+  *                   and the score line is then cut into runs like a
+  *                   luminance line. Channels are taken to an 8-bit scale,
+  *                   so white and grey score 0 and pure red 248. A word
+  *                   costs about a dozen cycles, against the 48 the DMA
+  *                   needs to bring it in at the fastest PCLK, so the
+  *                   kernel keeps up with the line rate.
+  *
+  *                   Kernel_Histogram bins samples in groups of four levels.
+  *                   It has no packed form: the M4 has no scatter, so it
+  *                   loads a word and increments four bins from it, about
+  *                   five cycles per sample. Callers keep the cost down by
+  *                   binning only a subset of the lines.
+  *
+  *                   The _Ref functions are the scalar definitions the
+  *                   packed kernels must agree with.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ccm.h"
+#include "kernel.h"
+#include "simd.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief Run being cut from a line
+  */
+typedef struct
+{
+  uint32_t Acc[3];  /*!< Sums of w, w * d and w * d * d of the open run */
+  uint32_t Start;   /*!< First sample column of the open run            */
+  uint32_t Count;   /*!< Runs found so far on the line                  */
+  uint8_t Open;     /*!< A run is open                                  */
+} Kernel_RunStateTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define KERNEL_ONES   0x01010101U
+/* RGB565 lanes as loaded from the bus, high byte first: R in bits 7:3, B
+   in bits 12:8, G split over bits 2:0 and 15:13 */
+#define KERNEL_RB_MASK 0x00F800F8U
+#define KERNEL_GH_MASK 0x00E000E0U
+#define KERNEL_GL_MASK 0x001C001CU
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Redness of one RGB565 pixel
+  * @param  hi: first byte on the bus, R and the high bits of G
+  * @param  lo: second byte on the bus, the low bits of G and B
+  * @retval max(R - max(G, B), 0), channels on an 8-bit scale
+  */
+static inline uint32_t Kernel_Redness(uint32_t hi, uint32_t lo)
+{
+  const uint32_t r = hi & 0xF8U;
+  const uint32_t g = (hi & 0x07U) << 5 | (lo & 0xE0U) >> 3;
+  const uint32_t b = (lo & 0x1FU) << 3;
+  const uint32_t gb = g > b ? g : b;
+
+  return r > gb ? r - gb : 0U;
+}
+
+/**
+  * @brief  Record a finished run
+  * @param  runs: run table
+  * @param  count: runs found so far on the line
+  * @param  max_runs: entries in the run table
+  * @param  start: first sample column
+  * @param  end: one past the last sample column
+  * @param  acc: sums of w, w * d and w * d * d, d = x - start
+  * @retval None
+  */
+static inline void Kernel_StoreRun(Kernel_RunTypeDef *runs, uint32_t count, uint32_t max_runs,
+                                   uint32_t start, uint32_t end, const uint32_t acc[3])
+{
+  if (count < max_runs) {
+    runs[count].Start = (uint16_t)start;
+    runs[count].Length = (uint16_t)(end - start);
+    runs[count].Sum = acc[0];
+    runs[count].SumX = acc[1];
+    runs[count].SumXX = acc[2];
+  }
+}
+
+/**
+  * @brief  Add one sample to the runs of a line
+  * @param  state: run being cut
+  * @param  w: sample less the threshold, 0 for background
+  * @param  x: sample column
+  * @param  runs: run table
+  * @param  max_runs: entries in the run table
+  * @retval None
+  */
+static inline void Kernel_RunSample(Kernel_RunStateTypeDef *state, uint32_t w, uint32_t x,
+                                    Kernel_RunTypeDef *runs, uint32_t max_runs)
+{
+  if (w != 0U) {
+    uint32_t d;
+
+    if (state->Open == 0U) {
+      state->Open = 1U;
+      state->Start = x;
+      state->Acc[0] = state->Acc[1] = state->Acc[2] = 0U;
+    }
+    d = x - state->Start;
+    state->Acc[0] += w;
+    state->Acc[1] += w * d;
+    state->Acc[2] += w * d * d;
+  } else if (state->Open != 0U) {
+    Kernel_StoreRun(runs, state->Count++, max_runs, state->Start, x, state->Acc);
+    state->Open = 0U;
+  }
+}
+
+/**
+  * @brief  Cut a thresholded line into runs of foreground samples, scalar
+  *         reference
+  * @note   Runs from CCM SRAM like the packed kernel, so that the two are
+  *         timed against each other from the same memory.
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples (1 for Y-only, 2 for YUV422)
+  * @param  threshold: samples above this value are foreground
+  * @param  runs: runs found, left to right, first max_runs kept
+  * @param  max_runs: entries in runs
+  * @retval Number of runs found, possibly more than max_runs
+  */
+CCM_FUNC uint32_t Kernel_ThresholdRuns_Ref(const uint8_t *line, uint32_t line_bytes,
+                                           uint32_t stride, uint8_t threshold,
+                                           Kernel_RunTypeDef *runs, uint32_t max_runs)
+{
+  uint32_t acc[3] = {0U, 0U, 0U};
+  uint32_t count = 0U;
+  uint32_t start = 0U;
+  uint8_t open = 0U;
+  uint32_t x = 0U;
+
+  for (uint32_t i = 0U; i < line_bytes; i += stride, x++) {
+    if (line[i] > threshold) {
+      uint32_t w = (uint32_t)line[i] - threshold;
+
+      if (open == 0U) {
+        open = 1U;
+        start = x;
+        acc[0] = acc[1] = acc[2] = 0U;
+      }
+      acc[0] += w;
+      acc[1] += w * (x - start);
+      acc[2] += w * (x - start) * (x - start);
+    } else if (open != 0U) {
+      Kernel_StoreRun(runs, count++, max_runs, start, x, acc);
+      open = 0U;
+    }
+  }
+  if (open != 0U) {
+    Kernel_StoreRun(runs, count++, max_runs, start, x, acc);
+  }
+  return count;
+}
+
+/**
+  * @brief  Cut a thresholded line into runs of foreground samples
+  * @note   Strides 1 and 2 are thresholded a word at a time, and words
+  *         wholly inside a run summed packed; other strides, and the bytes
+  *         past the last whole word, go a sample at a time. Lines up to 320
+  *         samples keep SumXX within 32 bits. Runs from CCM SRAM.
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples (1 for Y-only, 2 for YUV422)
+  * @param  threshold: samples above this value are foreground
+  * @param  runs: runs found, left to right, first max_runs kept
+  * @param  max_runs: entries in runs
+  * @retval Number of runs found, possibly more than max_runs
+  */
+CCM_FUNC uint32_t Kernel_ThresholdRuns(const uint8_t *line, uint32_t line_bytes,
+                                       uint32_t stride, uint8_t threshold,
+                                       Kernel_RunTypeDef *runs, uint32_t max_runs)
+{
+  /* Luminance in bytes 0 and 2 for YUV422, chroma masked out */
+  const uint32_t mask = stride == 2U ? 0x00FF00FFU : 0xFFFFFFFFU;
+  const uint32_t t4 = threshold * KERNEL_ONES & mask;
+  const uint32_t words = stride == 1U || stride == 2U ? line_bytes / 4U : 0U;
+  const uint32_t lanes = stride == 2U ? 2U : 4U;
+  Kernel_RunStateTypeDef state = { {0U, 0U, 0U}, 0U, 0U, 0U };
+  uint32_t x = 0U;
+  uint32_t i;
+
+  for (i = 0U; i < words; i++, x += lanes) {
+    uint32_t p;
+    uint32_t w;
+
+    memcpy(&p, &line[4U * i], sizeof(p));
+    w = __UQSUB8(p & mask, t4);
+    if (w == 0U) {
+      if (state.Open != 0U) {
+        Kernel_StoreRun(runs, state.Count++, max_runs, state.Start, x, state.Acc);
+        state.Open = 0U;
+      }
+      continue;
+    }
+
+    (void)__USUB8(w, KERNEL_ONES);
+    if (__SEL(mask, 0U) == mask) {
+      /* d ramp of the word: lane k holds d0 + k, two lanes per halfword */
+      uint32_t ramp;
+      uint32_t d0;
+      uint32_t sw;
+      uint32_t swd;
+      uint32_t swk2;
+
+      if (state.Open == 0U) {
+        state.Open = 1U;
+        state.Start = x;
+        state.Acc[0] = state.Acc[1] = state.Acc[2] = 0U;
+      }
+      d0 = x - state.Start;
+      ramp = d0 * 0x00010001U;
+      sw = __USADA8(w, 0U, 0U);
+      if (stride == 1U) {
+        const uint32_t even = __UXTB16(w);
+        const uint32_t odd = __UXTB16(__ROR(w, 8U));
+
+        swd = __SMLAD(even, ramp + 0x00020000U, __SMLAD(odd, ramp + 0x00030001U, 0U));
+        swk2 = __SMLAD(even, 0x00040000U, __SMLAD(odd, 0x00090001U, 0U));
+      } else {
+        swd = __SMLAD(w, ramp + 0x00010000U, 0U);
+        swk2 = w >> 16;
+      }
+      state.Acc[0] += sw;
+      state.Acc[1] += swd;
+      state.Acc[2] += 2U * d0 * swd - d0 * d0 * sw + swk2;
+      continue;
+    }
+
+    /* A run starts or ends in the word */
+    for (uint32_t k = 0U; k < lanes; k++) {
+      Kernel_RunSample(&state, w >> (8U * k * stride) & 0xFFU, x + k, runs, max_runs);
+    }
+  }
+
+  /* Bytes past the last whole word */
+  for (i = 4U * words; i < line_bytes; i += stride, x++) {
+    Kernel_RunSample(&state, line[i] > threshold ? (uint32_t)line[i] - threshold : 0U, x,
+                     runs, max_runs);
+  }
+  if (state.Open != 0U) {
+    Kernel_StoreRun(runs, state.Count++, max_runs, state.Start, x, state.Acc);
+  }
+  return state.Count;
+}
+
+/**
+  * @brief  Take listed columns out of the runs of a line
+  * @note   Listed columns at either end of a run shorten it, moving the
+  *         moments to the new first column at the start, and a run of
+  *         listed columns only is dropped; a listed column inside a run
+  *         only loses its weight. Costs nothing per sample: the work is per
+  *         listed column. Runs from CCM SRAM.
+  * @param  line: captured bytes the runs were cut from
+  * @param  stride: bytes between two samples
+  * @param  threshold: threshold the runs were cut at
+  * @param  columns: sample columns to take out, ascending
+  * @param  column_count: entries in columns
+  * @param  runs: runs of the line, left to right, updated in place
+  * @param  count: entries in runs
+  * @retval Number of runs left
+  */
+CCM_FUNC uint32_t Kernel_MaskRuns(const uint8_t *line, uint32_t stride, uint8_t threshold,
+                                  const uint16_t *columns, uint32_t column_count,
+                                  Kernel_RunTypeDef *runs, uint32_t count)
+{
+  uint32_t kept = 0U;
+  uint32_t c = 0U;
+
+  for (uint32_t k = 0U; k < count; k++) {
+    Kernel_RunTypeDef r = runs[k];
+    uint32_t first;
+    uint32_t last;
+
+    while (c < column_count && columns[c] < r.Start) {
+      c++;
+    }
+    first = c;
+    while (c < column_count && columns[c] < r.Start + r.Length) {
+      c++;
+    }
+    last = c;
+
+    /* End, then start, then what is left inside */
+    while (last > first && columns[last - 1U] == r.Start + r.Length - 1U) {
+      const uint32_t d = r.Length - 1U;
+      const uint32_t w = (uint32_t)line[columns[--last] * stride] - threshold;
+
+      r.Sum -= w;
+      r.SumX -= w * d;
+      r.SumXX -= w * d * d;
+      r.Length--;
+    }
+    while (first < last && columns[first] == r.Start) {
+      const uint32_t w = (uint32_t)line[columns[first++] * stride] - threshold;
+
+      /* sum(w (d - 1)) and sum(w (d - 1)^2) over the samples left */
+      r.Sum -= w;
+      r.SumXX = r.SumXX - 2U * r.SumX + r.Sum;
+      r.SumX -= r.Sum;
+      r.Start++;
+      r.Length--;
+    }
+    for (; first < last; first++) {
+      const uint32_t d = columns[first] - r.Start;
+      const uint32_t w = (uint32_t)line[columns[first] * stride] - threshold;
+
+      r.Sum -= w;
+      r.SumX -= w * d;
+      r.SumXX -= w * d * d;
+    }
+    if (r.Length != 0U) {
+      runs[kept++] = r;
+    }
+  }
+  return kept;
+}
+
+/**
+  * @brief  Add the samples of a line to a histogram
+  * @note   Strides other than 1 and 2 are binned one byte at a time. Runs
+  *         from CCM SRAM.
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples (1 for Y-only, 2 for YUV422)
+  * @param  hist: KERNEL_HIST_BINS counters, incremented
+  * @retval None
+  */
+CCM_FUNC void Kernel_Histogram(const uint8_t *line, uint32_t line_bytes, uint32_t stride,
+                               uint32_t *hist)
+{
+  const uint32_t words = stride <= 2U ? line_bytes / 4U : 0U;
+  uint32_t i;
+
+  for (i = 0U; i < words; i++) {
+    uint32_t p;
+
+    memcpy(&p, &line[4U * i], sizeof(p));
+    hist[(p & 0xFFU) >> KERNEL_HIST_SHIFT]++;
+    hist[(p >> 16 & 0xFFU) >> KERNEL_HIST_SHIFT]++;
+    if (stride == 1U) {
+      hist[(p >> 8 & 0xFFU) >> KERNEL_HIST_SHIFT]++;
+      hist[(p >> 24) >> KERNEL_HIST_SHIFT]++;
+    }
+  }
+
+  /* Bytes past the last whole word */
+  for (i = 4U * words; i < line_bytes; i += stride) {
+    hist[line[i] >> KERNEL_HIST_SHIFT]++;
+  }
+}
+
+/**
+  * @brief  Score an RGB565 line by redness, scalar reference
+  * @param  line: captured bytes, two per pixel, high byte first
+  * @param  line_bytes: number of bytes in the line
+  * @param  score: line_bytes / 2 bytes, redness of each pixel
+  * @retval None
+  */
+void Kernel_RednessScores_Ref(const uint8_t *line, uint32_t line_bytes, uint8_t *score)
+{
+  for (uint32_t x = 0U; x < line_bytes / 2U; x++) {
+    score[x] = (uint8_t)Kernel_Redness(line[2U * x], line[2U * x + 1U]);
+  }
+}
+
+/**
+  * @brief  Score an RGB565 line by redness, packed SIMD
+  * @note   Runs from CCM SRAM.
+  * @param  line: captured bytes, two per pixel, high byte first
+  * @param  line_bytes: number of bytes in the line
+  * @param  score: line_bytes / 2 bytes, redness of each pixel
+  * @retval None
+  */
+CCM_FUNC void Kernel_RednessScores(const uint8_t *line, uint32_t line_bytes, uint8_t *score)
+{
+  const uint32_t words = line_bytes / 4U;
+
+  for (uint32_t i = 0U; i < words; i++) {
+    uint32_t p;
+    uint32_t g;
+    uint32_t red;
+    uint16_t s;
+
+    memcpy(&p, &line[4U * i], sizeof(p));
+    g = (p << 5 & KERNEL_GH_MASK) | (p >> 11 & KERNEL_GL_MASK);
+    (void)__USUB16(g, p >> 5 & KERNEL_RB_MASK);
+    red = __UQSUB16(p & KERNEL_RB_MASK, __SEL(g, p >> 5 & KERNEL_RB_MASK));
+
+    s = (uint16_t)(red | red >> 8);
+    memcpy(&score[2U * i], &s, sizeof(s));
+  }
+
+  /* Pixel past the last whole word */
+  if ((line_bytes & 2U) != 0U) {
+    score[2U * words] = (uint8_t)Kernel_Redness(line[4U * words], line[4U * words + 1U]);
+  }
+}
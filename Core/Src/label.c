@@ -0,0 +1,450 @@
+/**
+  ******************************************************************************
+  * @file           : label.c
+  * @brief          : Single-pass streaming connected-component labeling
+  *
+  *                   The runs of each line come from the threshold kernel
+  *                   with their moments already summed, so the labeler never
+  *                   reads a pixel and its cost follows the number of runs,
+  *                   not the line length. A run takes the label of the
+  *                   previous-line runs it touches (8-connectivity) and
+  *                   merges their labels in a bounded union-find table, whose
+  *                   roots carry the blob moments. After every line the runs
+  *                   are re-pointed at their roots, so any label not
+  *                   reachable from the current line is either a finished
+  *                   blob, reported at once, or a merged alias, freed at
+  *                   once. Labels are therefore recycled within the frame and
+  *                   all storage is static: nothing here ever reaches the
+  *                   heap. The per-line path and its tables live in CCM SRAM.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ccm.h"
+#include "label.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint16_t Start;   /*!< First sample column, inclusive */
+  uint16_t End;     /*!< Last sample column, inclusive  */
+  uint8_t Label;
+} Label_RunTypeDef;
+
+typedef struct
+{
+  uint32_t Area;
+  uint32_t Weight;
+  uint64_t SumX;
+  uint64_t SumY;
+  uint64_t SumXX;
+  uint64_t SumYY;
+  uint64_t SumXY;
+  uint16_t XMin;
+  uint16_t XMax;
+  uint16_t YMin;
+  uint16_t YMax;
+} Label_AccTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define LABEL_NONE    0xFFU
+
+_Static_assert(LABEL_MAX_LABELS <= 64U, "label_used is a 64-bit mask");
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t label_parent[LABEL_MAX_LABELS] CCM_BSS;
+static Label_AccTypeDef label_acc[LABEL_MAX_LABELS] CCM_BSS;
+static uint64_t label_used CCM_BSS;
+
+static Label_RunTypeDef label_runs[2][LABEL_MAX_RUNS] CCM_BSS;
+static uint16_t label_run_count[2] CCM_BSS;
+static uint8_t label_cur;
+static int32_t label_last_y;
+
+static Label_FrameTypeDef label_build CCM_BSS;
+static volatile uint32_t label_seq;
+static Label_FrameTypeDef label_published;
+static uint32_t label_read_seq;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Label_Reset(void);
+static uint8_t Label_Find(uint8_t label);
+static uint8_t Label_Alloc(void);
+static void Label_Union(uint8_t a, uint8_t b);
+static void Label_Run(const Kernel_RunTypeDef *r, uint16_t y);
+static void Label_Sweep(void);
+static void Label_Emit(const Label_AccTypeDef *acc);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the labeler
+  * @retval None
+  */
+void Label_Init(void)
+{
+  Label_Reset();
+}
+
+/**
+  * @brief  Label the runs of one line
+  * @note   Runs from the capture DMA interrupt.
+  * @param  runs: runs of the line, left to right
+  * @param  count: number of runs
+  * @param  y: line index in the frame
+  * @retval None
+  */
+CCM_FUNC void Label_Line(const Kernel_RunTypeDef *runs, uint16_t count, uint16_t y)
+{
+  /* A missing line breaks vertical connectivity */
+  if ((int32_t)y != label_last_y + 1) {
+    label_cur ^= 1U;
+    label_run_count[label_cur] = 0U;
+    Label_Sweep();
+  }
+  label_cur ^= 1U;
+  label_run_count[label_cur] = 0U;
+
+  for (uint16_t k = 0U; k < count; k++) {
+    Label_Run(&runs[k], y);
+  }
+
+  Label_Sweep();
+  label_last_y = y;
+}
+
+/**
+  * @brief  Report the blobs still open, publish the frame and start over
+  * @param  frame: capture frame sequence number
+  * @retval None
+  */
+void Label_EndFrame(uint32_t frame)
+{
+  label_cur ^= 1U;
+  label_run_count[label_cur] = 0U;
+  Label_Sweep();
+
+  /* Heaviest first; the table is small enough for an insertion sort */
+  for (uint16_t i = 1U; i < label_build.Count; i++) {
+    Label_BlobTypeDef blob = label_build.Blobs[i];
+    uint16_t j = i;
+
+    for (; j > 0U && label_build.Blobs[j - 1U].Weight < blob.Weight; j--) {
+      label_build.Blobs[j] = label_build.Blobs[j - 1U];
+    }
+    label_build.Blobs[j] = blob;
+  }
+
+  label_build.Frame = frame;
+  label_seq++;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  label_published = label_build;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  label_seq++;
+
+  Label_Reset();
+}
+
+/**
+  * @brief  Fetch the blobs of the latest frame
+  * @param  frame: destination
+  * @retval 1 if the frame is newer than the previous call, 0 otherwise
+  */
+uint8_t Label_GetFrame(Label_FrameTypeDef *frame)
+{
+  uint32_t seq;
+
+  do {
+    seq = label_seq;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    *frame = label_published;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  } while ((seq & 1U) != 0U || seq != label_seq);
+
+  if (seq == label_read_seq) {
+    return 0U;
+  }
+  label_read_seq = seq;
+  return 1U;
+}
+
+/**
+  * @brief  Bring the blobs of a downsampled frame to output pixels
+  * @note   Sample i stands for output pixel s * i, the first of the s it
+  *         was picked from: the sensor drops the others, it does not
+  *         average them. Area and weight count the pixels each sample
+  *         stands for, so that weight thresholds hold at any scale; a lone
+  *         hot sample would then weigh as much as a dot, so blobs of fewer
+  *         than LABEL_SCALE_MIN_SAMPLES samples are discarded.
+  * @param  frame: blobs, converted in place
+  * @param  scale: output pixels per sample s
+  * @retval None
+  */
+void Label_ScaleFrame(Label_FrameTypeDef *frame, uint16_t scale)
+{
+  const float s = (float)scale;
+  uint32_t count = 0U;
+
+  for (uint32_t i = 0U; i < frame->Count; i++) {
+    Label_BlobTypeDef blob = frame->Blobs[i];
+
+    if (blob.Area < LABEL_SCALE_MIN_SAMPLES) {
+      continue;
+    }
+    blob.Area *= (uint32_t)scale * scale;
+    blob.Weight *= (uint32_t)scale * scale;
+    blob.XMin = (uint16_t)(blob.XMin * scale);
+    blob.XMax = (uint16_t)(blob.XMax * scale + scale - 1U);
+    blob.YMin = (uint16_t)(blob.YMin * scale);
+    blob.YMax = (uint16_t)(blob.YMax * scale + scale - 1U);
+    blob.X *= (int32_t)scale;
+    blob.Y *= (int32_t)scale;
+    blob.Mxx *= s * s;
+    blob.Myy *= s * s;
+    blob.Mxy *= s * s;
+    frame->Blobs[count++] = blob;
+  }
+  frame->Count = (uint16_t)count;
+}
+
+/**
+  * @brief  Clear every label, run and blob of the frame being built
+  * @retval None
+  */
+static void Label_Reset(void)
+{
+  label_used = 0U;
+  label_run_count[0] = 0U;
+  label_run_count[1] = 0U;
+  label_last_y = -2;
+  label_build.Count = 0U;
+  label_build.Dropped = 0U;
+}
+
+/**
+  * @brief  Root of a label, with path halving
+  * @param  label: provisional label
+  * @retval Root label
+  */
+CCM_FUNC static uint8_t Label_Find(uint8_t label)
+{
+  while (label_parent[label] != label) {
+    label_parent[label] = label_parent[label_parent[label]];
+    label = label_parent[label];
+  }
+  return label;
+}
+
+/**
+  * @brief  Take a free label as a new empty root
+  * @retval Label, or LABEL_NONE if the table is full
+  */
+CCM_FUNC static uint8_t Label_Alloc(void)
+{
+  uint8_t label;
+  Label_AccTypeDef *acc;
+
+  if (label_used == ~(uint64_t)0 >> (64U - LABEL_MAX_LABELS)) {
+    return LABEL_NONE;
+  }
+  label = (uint8_t)__builtin_ctzll(~label_used);
+  label_used |= (uint64_t)1 << label;
+  label_parent[label] = label;
+
+  acc = &label_acc[label];
+  memset(acc, 0, sizeof(*acc));
+  acc->XMin = UINT16_MAX;
+  acc->YMin = UINT16_MAX;
+  return label;
+}
+
+/**
+  * @brief  Merge the components of two labels
+  * @param  a: label kept as root
+  * @param  b: label merged into a
+  * @retval None
+  */
+CCM_FUNC static void Label_Union(uint8_t a, uint8_t b)
+{
+  Label_AccTypeDef *dst;
+  const Label_AccTypeDef *src;
+
+  a = Label_Find(a);
+  b = Label_Find(b);
+  if (a == b) {
+    return;
+  }
+  dst = &label_acc[a];
+  src = &label_acc[b];
+  dst->Area += src->Area;
+  dst->Weight += src->Weight;
+  dst->SumX += src->SumX;
+  dst->SumY += src->SumY;
+  dst->SumXX += src->SumXX;
+  dst->SumYY += src->SumYY;
+  dst->SumXY += src->SumXY;
+  dst->XMin = src->XMin < dst->XMin ? src->XMin : dst->XMin;
+  dst->XMax = src->XMax > dst->XMax ? src->XMax : dst->XMax;
+  dst->YMin = src->YMin < dst->YMin ? src->YMin : dst->YMin;
+  dst->YMax = src->YMax > dst->YMax ? src->YMax : dst->YMax;
+  label_parent[b] = a;
+}
+
+/**
+  * @brief  Label a run against the previous line and add its moments
+  * @param  r: run, moments about its first column
+  * @param  y: line index in the frame
+  * @retval None
+  */
+CCM_FUNC static void Label_Run(const Kernel_RunTypeDef *r, uint16_t y)
+{
+  const Label_RunTypeDef *prev = label_runs[label_cur ^ 1U];
+  const uint16_t prev_count = label_run_count[label_cur ^ 1U];
+  const uint16_t start = r->Start;
+  const uint16_t end = (uint16_t)(r->Start + r->Length - 1U);
+  const uint32_t sum = r->Sum;
+  Label_RunTypeDef *run;
+  Label_AccTypeDef *acc;
+  uint8_t label = LABEL_NONE;
+  uint32_t sum_x;
+  uint64_t sum_xx;
+
+  if (label_run_count[label_cur] == LABEL_MAX_RUNS) {
+    label_build.Dropped++;
+    return;
+  }
+
+  for (uint16_t k = 0U; k < prev_count && prev[k].Start <= end + 1U; k++) {
+    if (prev[k].End + 1U < start || prev[k].Label == LABEL_NONE) {
+      continue;
+    }
+    if (label == LABEL_NONE) {
+      label = Label_Find(prev[k].Label);
+    } else {
+      Label_Union(label, prev[k].Label);
+    }
+  }
+  if (label == LABEL_NONE) {
+    label = Label_Alloc();
+    if (label == LABEL_NONE) {
+      label_build.Dropped++;
+      return;
+    }
+  }
+
+  run = &label_runs[label_cur][label_run_count[label_cur]++];
+  run->Start = start;
+  run->End = end;
+  run->Label = label;
+
+  /* Moments about column 0 from those about the run start s:
+     sum(w x) = s S + S1, sum(w x^2) = s^2 S + 2 s S1 + S2 */
+  sum_x = start * sum + r->SumX;
+  sum_xx = (uint64_t)start * start * sum + 2U * (uint64_t)start * r->SumX + r->SumXX;
+
+  acc = &label_acc[Label_Find(label)];
+  acc->Area += (uint32_t)(end - start) + 1U;
+  acc->Weight += sum;
+  acc->SumX += sum_x;
+  acc->SumY += (uint64_t)sum * y;
+  acc->SumXX += sum_xx;
+  acc->SumYY += (uint64_t)sum * y * y;
+  acc->SumXY += (uint64_t)sum_x * y;
+  acc->XMin = start < acc->XMin ? start : acc->XMin;
+  acc->XMax = end > acc->XMax ? end : acc->XMax;
+  acc->YMin = y < acc->YMin ? y : acc->YMin;
+  acc->YMax = y > acc->YMax ? y : acc->YMax;
+}
+
+/**
+  * @brief  Re-point current runs at their roots, then report the roots that
+  *         no longer reach the current line and free every unreachable label
+  * @retval None
+  */
+CCM_FUNC static void Label_Sweep(void)
+{
+  Label_RunTypeDef *runs = label_runs[label_cur];
+  uint64_t live = 0U;
+  uint64_t dead;
+
+  for (uint16_t k = 0U; k < label_run_count[label_cur]; k++) {
+    runs[k].Label = Label_Find(runs[k].Label);
+    live |= (uint64_t)1 << runs[k].Label;
+  }
+
+  dead = label_used & ~live;
+  while (dead != 0U) {
+    uint8_t label = (uint8_t)__builtin_ctzll(dead);
+
+    dead &= dead - 1U;
+    if (label_parent[label] == label) {
+      Label_Emit(&label_acc[label]);
+    }
+  }
+  label_used = live;
+}
+
+/**
+  * @brief  Turn a finished component into a blob record
+  * @note   When the table is full the lightest blob is the one dropped.
+  * @param  acc: component moments
+  * @retval None
+  */
+static void Label_Emit(const Label_AccTypeDef *acc)
+{
+  Label_BlobTypeDef *blob;
+  int64_t cx;
+  int64_t cy;
+  int64_t sxx;
+  int64_t syy;
+  int64_t sxy;
+  float fx;
+  float fy;
+  float w;
+
+  if (acc->Weight == 0U) {
+    return;
+  }
+  if (label_build.Count < LABEL_MAX_BLOBS) {
+    blob = &label_build.Blobs[label_build.Count++];
+  } else {
+    uint16_t lightest = 0U;
+
+    for (uint16_t i = 1U; i < LABEL_MAX_BLOBS; i++) {
+      if (label_build.Blobs[i].Weight < label_build.Blobs[lightest].Weight) {
+        lightest = i;
+      }
+    }
+    label_build.Dropped++;
+    if (label_build.Blobs[lightest].Weight >= acc->Weight) {
+      return;
+    }
+    blob = &label_build.Blobs[lightest];
+  }
+
+  blob->Area = acc->Area;
+  blob->Weight = acc->Weight;
+  blob->XMin = acc->XMin;
+  blob->XMax = acc->XMax;
+  blob->YMin = acc->YMin;
+  blob->YMax = acc->YMax;
+  blob->X = (int32_t)((acc->SumX << 16) / acc->Weight);
+  blob->Y = (int32_t)((acc->SumY << 16) / acc->Weight);
+  blob->Refined = 0U;
+
+  /* Second moments about the integer centroid are exact in 64 bits; only
+   * the sub-pixel remainder is corrected in floating point. */
+  cx = (int64_t)(acc->SumX / acc->Weight);
+  cy = (int64_t)(acc->SumY / acc->Weight);
+  sxx = (int64_t)acc->SumXX - 2 * cx * (int64_t)acc->SumX + cx * cx * acc->Weight;
+  syy = (int64_t)acc->SumYY - 2 * cy * (int64_t)acc->SumY + cy * cy * acc->Weight;
+  sxy = (int64_t)acc->SumXY - cx * (int64_t)acc->SumY - cy * (int64_t)acc->SumX
+        + cx * cy * acc->Weight;
+  w = (float)acc->Weight;
+  fx = (float)(blob->X - (int32_t)(cx << 16)) / (float)(1L << 16);
+  fy = (float)(blob->Y - (int32_t)(cy << 16)) / (float)(1L << 16);
+  blob->Mxx = (float)sxx / w - fx * fx;
+  blob->Myy = (float)syy / w - fy * fy;
+  blob->Mxy = (float)sxy / w - fx * fy;
+}
@@ -19,22 +19,69 @@
 #include "main.h"
 
 /* Private includes ----------------------------------------------------------*/
+#include "capture.h"
+#include "ccm.h"
+#include "clock.h"
+#include "control.h"
+#include "detect.h"
+#include "hotpix.h"
+#include "label.h"
+#include "mask.h"
+#include "param.h"
+#include "pool.h"
+#include "profile.h"
+#include "refine.h"
+#include "roi.h"
+#include "sensor.h"
+#include "serial.h"
+#include "servo.h"
+#include "sysmem.h"
+#include "telemetry.h"
+#include "track.h"
+#include <stdio.h>
 
 
 /* Private typedef -----------------------------------------------------------*/
 
 
 /* Private define ------------------------------------------------------------*/
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+/* Redness threshold of the dot detector, R - max(G, B) on an 8-bit scale */
+#define DETECT_THRESHOLD 64U
+/* Labeling reads the one-byte redness line */
+#define DETECT_STRIDE 1U
+#else
+/* Luminance threshold of the dot detector */
+#define DETECT_THRESHOLD 200U
+/* Bytes between two Y samples in the captured lines */
+#define DETECT_STRIDE CAPTURE_BYTES_PER_PIXEL
+#endif
+/* Adaptive threshold: a margin above the 99th percentile of the scene,
+   which a dot of a few hundred pixels does not reach, starting from
+   DETECT_THRESHOLD */
+#define DETECT_AUTO_PERCENTILE 990U
+#define DETECT_AUTO_MARGIN 48U
+#define DETECT_AUTO_MIN 32U
+#define DETECT_AUTO_MAX 250U
+/* The settled threshold is kept in the parameter store for the next boot,
+   checked once a minute and written when it moved by the margin: at most
+   one record a minute, a page compaction every few hours */
+#define DETECT_SAVE_PERIOD_MS 60000U
+#define DETECT_SAVE_MARGIN 8U
 
 
 /* Private macro -------------------------------------------------------------*/
 
 
 /* Private variables ---------------------------------------------------------*/
+static Label_FrameTypeDef *blobs;
+static uint8_t saved_threshold;
+static uint32_t save_tick;
 
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
+static void SaveThreshold(void);
 
 
 /* Private user code ---------------------------------------------------------*/
@@ -46,6 +93,9 @@ void SystemClock_Config(void);
   */
 int main(void)
 {
+  HAL_StatusTypeDef err;
+  Control_GainsTypeDef gains;
+  uint32_t idle_start;
 
   /* MCU Configuration--------------------------------------------------------*/
 
@@ -56,47 +106,271 @@ int main(void)
   SystemClock_Config();
 
   /* Initialize all configured peripherals */
+  Pool_Init();
+  Profile_Init();
+  err = Serial_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Telemetry_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Param_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  blobs = Pool_Alloc(POOL_BLOBS);
+  if (blobs == NULL) {
+    Error_Handler(__func__, HAL_ERROR);
+  }
+  err = Sensor_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Servo_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Servo_Start();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Control_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  if (Param_Get(PARAM_KEY_GAINS, &gains, sizeof(gains)) == sizeof(gains)) {
+    Control_SetGains(&gains);
+  }
+  Track_Init();
+  /* Start from the threshold the last run settled on */
+  saved_threshold = DETECT_THRESHOLD;
+  (void)Param_Get(PARAM_KEY_THRESHOLD, &saved_threshold, sizeof(saved_threshold));
+  Detect_Init(saved_threshold, DETECT_STRIDE);
+  Detect_SetAuto(&(const Detect_AutoTypeDef){
+    DETECT_AUTO_PERCENTILE, DETECT_AUTO_MARGIN, DETECT_AUTO_MIN, DETECT_AUTO_MAX });
+  Label_Init();
+#if MASK_ENABLED
+  Mask_Init();
+#endif
+#if REFINE_ENABLED
+  Refine_Init();
+#endif
+  Hotpix_Init();
+  err = Capture_Init(SENSOR_WIDTH * CAPTURE_BYTES_PER_PIXEL, SENSOR_HEIGHT);
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  /* The sensor registers were loading meanwhile */
+  err = Sensor_Wait();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+#if HOTPIX_CALIBRATE
+  /* Lens covered: map the pixels that stay bright in the dark, on full
+     frames, before the first window is programmed */
+  Hotpix_StartCalibration();
+  err = Capture_Start();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  while (Hotpix_IsCalibrating()) {
+  }
+  err = Capture_Stop();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Hotpix_Store();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+#endif
+  err = Roi_Init();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Capture_Start();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
+  err = Control_Start();
+  if (err != HAL_OK) {
+    Error_Handler(__func__, err);
+  }
 
+  /* From here on, buffers only come from the pools */
+  Sysmem_Lock();
 
   /* Infinite loop */
+  save_tick = HAL_GetTick();
+  idle_start = Profile_Now();
   while (1) {
+    Sensor_WindowTypeDef window;
+    uint32_t vsync_time;
+
+    if (!Label_GetFrame(blobs)) {
+      /* Parameter writes advance while waiting for a frame */
+      Param_Process();
+      continue;
+    }
+    Profile_Record(PROFILE_STAGE_CAPTURE_WAIT, Profile_Now() - idle_start);
+
+    /* Frames straddling a window change are neither tracked nor reported,
+       search frames are brought to output pixels first and full-resolution
+       ones get the fitted centroid; a full serial ring drops the packet,
+       accounted in Serial_GetDropped */
+    if (Roi_GetWindow(blobs->Frame, &window)) {
+      if (window.Scale != 1U) {
+        Label_ScaleFrame(blobs, window.Scale);
+      }
+#if REFINE_ENABLED
+      else {
+        PROFILE_SCOPE(PROFILE_STAGE_REFINE);
+
+        (void)Refine_Frame(blobs);
+      }
+#endif
+      if (Capture_GetFrameTime(blobs->Frame, &vsync_time)) {
+        PROFILE_SCOPE(PROFILE_STAGE_FILTER);
+
+        Track_Update(blobs, window.X, window.Y, vsync_time);
+      }
+      {
+        PROFILE_SCOPE(PROFILE_STAGE_TELEMETRY);
+
+        (void)Telemetry_SendBlobs(blobs, &window, DWT->CYCCNT);
+#if RUN_DUMP_ENABLED
+        Detect_RunsTypeDef *runs = Pool_Alloc(POOL_RUNS);
 
+        if (runs != NULL) {
+          if (Detect_GetRuns(runs) && runs->Frame == blobs->Frame) {
+            (void)Telemetry_SendRuns(runs, &window, DWT->CYCCNT);
+          }
+          (void)Pool_Free(POOL_RUNS, runs);
+        }
+#endif
+        if (blobs->Frame % TELEMETRY_STATS_PERIOD == 0U) {
+          (void)Telemetry_SendStats(blobs->Frame, DWT->CYCCNT);
+        }
+      }
+    }
+    /* A window the sensor bus did not take is retried on the next frame:
+       a glitch on SCCB must not stop the servo loop */
+    (void)Roi_Update(blobs);
+#if REFINE_ENABLED
+    Refine_Aim(blobs->Frame);
+#endif
+    (void)Telemetry_SendProfile(blobs->Frame, DWT->CYCCNT);
+    SaveThreshold();
+
+    idle_start = Profile_Now();
   }
 }
 
 /**
-  * @brief System Clock Configuration
+  * @brief  Hand each captured line to the detector while the next one fills
+  * @param  line: captured bytes
+  * @param  line_bytes: number of bytes in the line
+  * @param  y: line index in the frame
   * @retval None
   */
-void SystemClock_Config(void)
+CCM_FUNC void Capture_LineCpltCallback(const uint8_t *line, uint16_t line_bytes, uint16_t y)
 {
-  HAL_StatusTypeDef err;
-  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
-  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+  const Kernel_RunTypeDef *runs;
+  uint16_t count;
+
+  /* The detector is the only stage that reads the pixels; the others take
+     its runs, apart from the few samples kept around the dot for the fit */
+  {
+    PROFILE_SCOPE(PROFILE_STAGE_THRESHOLD);
 
-  /** Initializes the RCC Oscillators according to the specified parameters
-  * in the RCC_OscInitTypeDef structure.
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+    count = Detect_ColorLine(line, line_bytes, y, &runs);
+#if REFINE_ENABLED
+    Refine_Line(Detect_GetScores(), line_bytes / 2U, 1U, y);
+#endif
+#if HOTPIX_CALIBRATE
+    Hotpix_CalibrateLine(Detect_GetScores(), line_bytes / 2U, 1U, y);
+#endif
+#else
+    count = Detect_Line(line, line_bytes, y, &runs);
+#if REFINE_ENABLED
+    Refine_Line(line, line_bytes, DETECT_STRIDE, y);
+#endif
+#if HOTPIX_CALIBRATE
+    Hotpix_CalibrateLine(line, line_bytes, DETECT_STRIDE, y);
+#endif
+#endif
+  }
+  {
+    PROFILE_SCOPE(PROFILE_STAGE_LABEL);
+
+    Label_Line(runs, count, y);
+  }
+#if MASK_ENABLED
+  {
+    PROFILE_SCOPE(PROFILE_STAGE_MASK);
+
+    Mask_Line(runs, count, line_bytes / CAPTURE_BYTES_PER_PIXEL, y);
+  }
+#endif
+}
+
+/**
+  * @brief  Close the frame as soon as its last line has been processed
+  * @param  frame: frame sequence number
+  * @param  lines: number of lines delivered
+  * @retval None
   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+void Capture_FrameCpltCallback(uint32_t frame, uint16_t lines)
+{
+  UNUSED(lines);
+  Detect_EndFrame(frame);
+  Label_EndFrame(frame);
+#if MASK_ENABLED
+  Mask_EndFrame(frame);
+#endif
+#if REFINE_ENABLED
+  Refine_EndFrame(frame);
+#endif
+#if HOTPIX_CALIBRATE
+  Hotpix_EndFrame(frame);
+#endif
+}
 
-  err = HAL_RCC_OscConfig(&RCC_OscInitStruct);
-  if (err != HAL_OK) {
-    Error_Handler(__func__, err);
+/**
+  * @brief  Store the adaptive threshold once it has moved away from the
+  *         stored one
+  * @retval None
+  */
+static void SaveThreshold(void)
+{
+  const uint8_t threshold = Detect_GetThreshold();
+  const uint8_t drift = threshold > saved_threshold ? threshold - saved_threshold
+                                                    : saved_threshold - threshold;
+
+  if (HAL_GetTick() - save_tick < DETECT_SAVE_PERIOD_MS) {
+    return;
+  }
+  save_tick = HAL_GetTick();
+  if (drift >= DETECT_SAVE_MARGIN
+      && Param_Set(PARAM_KEY_THRESHOLD, &threshold, sizeof(threshold)) == HAL_OK) {
+    saved_threshold = threshold;
   }
+}
 
-  /** Initializes the CPU, AHB and APB buses clocks
+/**
+  * @brief System Clock Configuration
+  * @retval None
   */
-  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
-                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
-  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+void SystemClock_Config(void)
+{
+  HAL_StatusTypeDef err;
 
-  err = HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0);
+  /** Select the build-time clock profile (72 MHz PLL unless overridden)
+  */
+  err = Clock_SetProfile(CLOCK_PROFILE_DEFAULT);
   if (err != HAL_OK) {
     Error_Handler(__func__, err);
   }
@@ -111,6 +385,7 @@ void Error_Handler(const char *func_name, HAL_StatusTypeDef err)
 {
   __disable_irq();
   printf("%i in %s: Program aborted\n", err, func_name);
+  Serial_Flush();
   while (1);
 }
 
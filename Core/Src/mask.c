@@ -0,0 +1,335 @@
+/**
+  ******************************************************************************
+  * @file           : mask.c
+  * @brief          : Streaming 1 bpp foreground mask with 3x3 opening
+  *
+  *                   The runs of each line are set into a packed bit row,
+  *                   most significant bit first, a word at a time, and the
+  *                   frame is cleaned by a 3x3 opening (erosion then
+  *                   dilation) as it streams in: erosion of line y-1 runs
+  *                   when line y arrives, dilation of line y-2 right after,
+  *                   so only three raw and three eroded rows are kept. Both
+  *                   are separable and work on whole words: the vertical pass
+  *                   is an AND (OR) of three rows, the horizontal pass
+  *                   combines each word with itself shifted by one, carrying
+  *                   the edge bits of its neighbours, so 32 pixels take a
+  *                   handful of instructions. Specks smaller than 3x3 vanish
+  *                   while the dot keeps its shape.
+  *
+  *                   The opened rows land in a QVGA bit frame of 9.6 KB in
+  *                   SRAM; CCM is left to the line-rate code and tables.
+  *                   The bounding box is tracked on each opened row with
+  *                   CLZ for the first set pixel and CLZ of RBIT for the
+  *                   last. Pixels outside the frame count as background.
+  *
+  *                   With MASK_ENABLED at 0 nothing here is built and the
+  *                   frame takes no RAM.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include <string.h>
+#include "ccm.h"
+#include "kernel.h"
+#include "mask.h"
+#include "simd.h"
+
+#if MASK_ENABLED
+
+/* Private variables ---------------------------------------------------------*/
+/* Opened frame, row y rewritten once line y + 2 of the next frame is in */
+static uint32_t mask_bits[MASK_MAX_LINES][MASK_WORDS];
+
+/* Last three thresholded and eroded rows, row y in slot y % 3 */
+static uint32_t mask_raw[3U][MASK_WORDS] CCM_BSS;
+static uint32_t mask_eroded[3U][MASK_WORDS] CCM_BSS;
+static uint32_t mask_empty[MASK_WORDS] CCM_BSS;
+
+static uint16_t mask_width;
+static uint16_t mask_words;
+static uint32_t mask_last_word;
+static uint16_t mask_next_y;
+static uint16_t mask_xmin;
+static uint16_t mask_xmax;
+static uint16_t mask_ymin;
+static uint16_t mask_ymax;
+
+static volatile uint32_t mask_seq;
+static volatile Mask_ResultTypeDef mask_result;
+static uint32_t mask_read_seq;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Mask_Begin(uint16_t width);
+static void Mask_Fill(const Kernel_RunTypeDef *runs, uint16_t count, uint32_t *row);
+static void Mask_Push(uint16_t y);
+static void Mask_Erode(const uint32_t *a, const uint32_t *b, const uint32_t *c, uint32_t *out);
+static void Mask_Dilate(const uint32_t *a, const uint32_t *b, const uint32_t *c, uint32_t *out);
+static void Mask_Bound(uint16_t y);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the mask
+  * @retval None
+  */
+void Mask_Init(void)
+{
+  mask_width = 0U;
+  mask_words = 0U;
+  mask_next_y = 0U;
+}
+
+/**
+  * @brief  Set the runs of one line and clean the rows it completes
+  * @note   Runs from the capture DMA interrupt. Lines must come in order;
+  *         missing ones are taken as background.
+  * @param  runs: runs of the line, left to right
+  * @param  count: number of runs
+  * @param  width: samples per line
+  * @param  y: line index in the frame
+  * @retval None
+  */
+CCM_FUNC void Mask_Line(const Kernel_RunTypeDef *runs, uint16_t count, uint16_t width, uint16_t y)
+{
+  if (y == 0U) {
+    Mask_Begin(width);
+  }
+  if (y < mask_next_y || y >= MASK_MAX_LINES || mask_words == 0U) {
+    return;
+  }
+  while (mask_next_y < y) {
+    memset(mask_raw[mask_next_y % 3U], 0, sizeof(mask_raw[0]));
+    Mask_Push(mask_next_y);
+  }
+  Mask_Fill(runs, count, mask_raw[y % 3U]);
+  Mask_Push(y);
+}
+
+/**
+  * @brief  Clean the last two rows and publish the frame
+  * @param  frame: capture frame sequence number
+  * @retval None
+  */
+void Mask_EndFrame(uint32_t frame)
+{
+  const uint16_t lines = mask_next_y;
+
+  if (lines >= 1U) {
+    Mask_Erode(lines >= 2U ? mask_raw[(lines - 2U) % 3U] : mask_empty,
+               mask_raw[(lines - 1U) % 3U], mask_empty, mask_eroded[(lines - 1U) % 3U]);
+  }
+  if (lines >= 2U) {
+    Mask_Dilate(lines >= 3U ? mask_eroded[(lines - 3U) % 3U] : mask_empty,
+                mask_eroded[(lines - 2U) % 3U], mask_eroded[(lines - 1U) % 3U],
+                mask_bits[lines - 2U]);
+    Mask_Bound(lines - 2U);
+  }
+  if (lines >= 1U) {
+    Mask_Dilate(lines >= 2U ? mask_eroded[(lines - 2U) % 3U] : mask_empty,
+                mask_eroded[(lines - 1U) % 3U], mask_empty, mask_bits[lines - 1U]);
+    Mask_Bound(lines - 1U);
+  }
+
+  mask_seq++;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  mask_result.Frame = frame;
+  mask_result.Width = mask_width;
+  mask_result.Lines = lines;
+  mask_result.XMin = mask_xmin;
+  mask_result.XMax = mask_xmax;
+  mask_result.YMin = mask_ymin;
+  mask_result.YMax = mask_ymax;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  mask_seq++;
+
+  mask_next_y = 0U;
+}
+
+/**
+  * @brief  Fetch the latest frame result
+  * @param  result: destination
+  * @retval 1 if the result is newer than the previous call, 0 otherwise
+  */
+uint8_t Mask_GetResult(Mask_ResultTypeDef *result)
+{
+  uint32_t seq;
+
+  do {
+    seq = mask_seq;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    result->Frame = mask_result.Frame;
+    result->Width = mask_result.Width;
+    result->Lines = mask_result.Lines;
+    result->XMin = mask_result.XMin;
+    result->XMax = mask_result.XMax;
+    result->YMin = mask_result.YMin;
+    result->YMax = mask_result.YMax;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  } while ((seq & 1U) != 0U || seq != mask_seq);
+
+  if (seq == mask_read_seq) {
+    return 0U;
+  }
+  mask_read_seq = seq;
+  return 1U;
+}
+
+/**
+  * @brief  One row of the opened mask
+  * @note   Row y of a frame stays valid until line y + 2 of the next frame
+  *         has been captured.
+  * @param  y: row index
+  * @retval MASK_WORDS words, sample x at bit 31 - x % 32 of word x / 32, or
+  *         NULL past the last row
+  */
+const uint32_t *Mask_GetRow(uint16_t y)
+{
+  return y < MASK_MAX_LINES ? mask_bits[y] : NULL;
+}
+
+/**
+  * @brief  Start a frame with the line length of its window
+  * @param  width: samples per line
+  * @retval None
+  */
+static void Mask_Begin(uint16_t width)
+{
+  width = width > MASK_MAX_WIDTH ? MASK_MAX_WIDTH : width;
+  mask_width = width;
+  mask_words = (uint16_t)((width + 31U) / 32U);
+  mask_last_word = (width % 32U) != 0U ? ~(0xFFFFFFFFU >> (width % 32U)) : 0xFFFFFFFFU;
+  mask_next_y = 0U;
+  mask_xmin = 0xFFFFU;
+  mask_xmax = 0U;
+  mask_ymin = 0xFFFFU;
+  mask_ymax = 0U;
+}
+
+/**
+  * @brief  Set the samples of a line's runs in a row, whole words at a time
+  * @param  runs: runs of the line
+  * @param  count: number of runs
+  * @param  row: MASK_WORDS words, overwritten
+  * @retval None
+  */
+CCM_FUNC static void Mask_Fill(const Kernel_RunTypeDef *runs, uint16_t count, uint32_t *row)
+{
+  memset(row, 0, MASK_WORDS * sizeof(row[0]));
+  for (uint16_t k = 0U; k < count && runs[k].Start < mask_width; k++) {
+    const uint32_t first = runs[k].Start;
+    uint32_t last = first + runs[k].Length - 1U;
+    uint32_t head;
+    uint32_t tail;
+
+    last = last < mask_width ? last : mask_width - 1U;
+    head = 0xFFFFFFFFU >> (first % 32U);
+    tail = ~(0x7FFFFFFFU >> (last % 32U));
+    if (first / 32U == last / 32U) {
+      row[first / 32U] |= head & tail;
+    } else {
+      row[first / 32U] |= head;
+      for (uint32_t j = first / 32U + 1U; j < last / 32U; j++) {
+        row[j] = 0xFFFFFFFFU;
+      }
+      row[last / 32U] |= tail;
+    }
+  }
+}
+
+/**
+  * @brief  Take in raw row y: erode row y - 1, then dilate row y - 2 into
+  *         the frame
+  * @param  y: row just thresholded into mask_raw[y % 3]
+  * @retval None
+  */
+CCM_FUNC static void Mask_Push(uint16_t y)
+{
+  if (y >= 1U) {
+    Mask_Erode(y >= 2U ? mask_raw[(y - 2U) % 3U] : mask_empty,
+               mask_raw[(y - 1U) % 3U], mask_raw[y % 3U], mask_eroded[(y - 1U) % 3U]);
+  }
+  if (y >= 2U) {
+    Mask_Dilate(y >= 3U ? mask_eroded[(y - 3U) % 3U] : mask_empty,
+                mask_eroded[(y - 2U) % 3U], mask_eroded[(y - 1U) % 3U], mask_bits[y - 2U]);
+    Mask_Bound(y - 2U);
+  }
+  mask_next_y = y + 1U;
+}
+
+/**
+  * @brief  3x3 erosion of the middle of three rows
+  * @param  a: row above
+  * @param  b: row to erode
+  * @param  c: row below
+  * @param  out: eroded row
+  * @retval None
+  */
+CCM_FUNC static void Mask_Erode(const uint32_t *a, const uint32_t *b, const uint32_t *c, uint32_t *out)
+{
+  uint32_t prev = 0U;
+  uint32_t cur = a[0] & b[0] & c[0];
+
+  for (uint32_t j = 0U; j < mask_words; j++) {
+    uint32_t next = j + 1U < mask_words ? a[j + 1U] & b[j + 1U] & c[j + 1U] : 0U;
+
+    out[j] = cur & (cur << 1 | next >> 31) & (cur >> 1 | prev << 31);
+    prev = cur;
+    cur = next;
+  }
+}
+
+/**
+  * @brief  3x3 dilation of the middle of three rows
+  * @param  a: row above
+  * @param  b: row to dilate
+  * @param  c: row below
+  * @param  out: dilated row, clear past the last sample
+  * @retval None
+  */
+CCM_FUNC static void Mask_Dilate(const uint32_t *a, const uint32_t *b, const uint32_t *c, uint32_t *out)
+{
+  uint32_t prev = 0U;
+  uint32_t cur = a[0] | b[0] | c[0];
+
+  for (uint32_t j = 0U; j < mask_words; j++) {
+    uint32_t next = j + 1U < mask_words ? a[j + 1U] | b[j + 1U] | c[j + 1U] : 0U;
+
+    out[j] = cur | cur << 1 | next >> 31 | cur >> 1 | prev << 31;
+    prev = cur;
+    cur = next;
+  }
+  out[mask_words - 1U] &= mask_last_word;
+}
+
+/**
+  * @brief  Grow the bounding box by the set pixels of an opened row
+  * @param  y: row index
+  * @retval None
+  */
+CCM_FUNC static void Mask_Bound(uint16_t y)
+{
+  const uint32_t *row = mask_bits[y];
+  uint32_t first = 0U;
+  uint32_t last = mask_words;
+  uint32_t x;
+
+  while (first < mask_words && row[first] == 0U) {
+    first++;
+  }
+  if (first == mask_words) {
+    return;
+  }
+  while (row[last - 1U] == 0U) {
+    last--;
+  }
+
+  x = 32U * first + __CLZ(row[first]);
+  mask_xmin = x < mask_xmin ? (uint16_t)x : mask_xmin;
+  x = 32U * (last - 1U) + 31U - __CLZ(__RBIT(row[last - 1U]));
+  mask_xmax = x > mask_xmax ? (uint16_t)x : mask_xmax;
+  mask_ymin = y < mask_ymin ? y : mask_ymin;
+  mask_ymax = y;
+}
+
+#endif /* MASK_ENABLED */
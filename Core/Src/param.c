@@ -0,0 +1,509 @@
+/**
+  ******************************************************************************
+  * @file           : param.c
+  * @brief          : Key/value parameter store in two flash pages
+  *
+  *                   Calibration and tuning results are kept across resets
+  *                   as records appended to a log in one flash page, the
+  *                   active one: a word holding the key and the value
+  *                   length, the value padded to a word, then a CRC-32 of
+  *                   both. Writing a key again appends a new record; the
+  *                   newest valid one wins. The CRC is programmed last, so
+  *                   a record cut short by a reset fails it and is
+  *                   skipped, while its length word still leads to the
+  *                   next one.
+  *
+  *                   When the active page is full, the newest record of
+  *                   every key is copied to the other page, the new record
+  *                   appended there, and only then the page header
+  *                   written: a sequence number, then a magic word. The
+  *                   page with the higher sequence number and a magic word
+  *                   is the active one, so a reset at any point leaves
+  *                   either the old page or the new one in use. The old
+  *                   page is erased last, ready for the next compaction.
+  *                   Pages thus take turns, and each is erased once per
+  *                   page of records: with a handful of keys rewritten
+  *                   now and then, far inside the 10000 cycles the flash
+  *                   is rated for.
+  *
+  *                   Param_Init scans the active page once, checking every
+  *                   CRC with the CRC unit, and keeps the offset of the
+  *                   newest record of each key: a lookup is then an index
+  *                   and a copy, and the boot scan of 2 KB takes tens of
+  *                   microseconds. Param_Set only stages the record; the
+  *                   flash is then programmed one word, or erased one
+  *                   page, per Param_Process call with the interrupt
+  *                   driven HAL API, so the thread keeps running between
+  *                   operations. Any fetch from flash still waits for the
+  *                   operation in progress, about 60 us for a word and up
+  *                   to 40 ms for a page: the erase of a compaction costs
+  *                   a frame or two.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "crc.h"
+#include "param.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief Page header, programmed once all the records of a compaction are
+  *        in place
+  */
+typedef struct
+{
+  uint32_t Sequence;  /*!< Compaction count, higher for the newer page */
+  uint32_t Magic;     /*!< PARAM_MAGIC once the page is complete       */
+} Param_HeaderTypeDef;
+
+/**
+  * @brief Flash operation sequence under way
+  */
+typedef enum
+{
+  PARAM_STEP_IDLE = 0U,
+  PARAM_STEP_ERASE,       /*!< Erase param_erase_page, then param_after_erase */
+  PARAM_STEP_COPY,        /*!< Copy the newest records to the spare page      */
+  PARAM_STEP_APPEND,      /*!< Program the staged record                      */
+  PARAM_STEP_HEADER       /*!< Complete the spare page and switch to it       */
+} Param_StepTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define PARAM_MAGIC             0x4D524150U   /* "PARM" */
+#define PARAM_PAGE_SIZE         FLASH_PAGE_SIZE
+#define PARAM_ERASED            0xFFFFFFFFU
+#define PARAM_FREE_KEY          0xFFFFU
+/* Words of a record: key and length, value, CRC */
+#define PARAM_RECORD_WORDS(length) (2U + ((uint32_t)(length) + 3U) / 4U)
+
+/* The newest record of every key fits one page */
+_Static_assert(sizeof(Param_HeaderTypeDef)
+               + (PARAM_KEY_COUNT - 1U) * 4U * PARAM_RECORD_WORDS(PARAM_MAX_VALUE)
+               <= PARAM_PAGE_SIZE, "parameter store page too small");
+
+/* Private variables ---------------------------------------------------------*/
+/* Active page, its sequence number, the offset of the newest record of each
+   key (0 for none) and of the first free word */
+static uint32_t param_active;
+static uint32_t param_sequence;
+static uint16_t param_index[PARAM_KEY_COUNT];
+static uint16_t param_end;
+static uint8_t param_spare_erased;
+
+/* Record staged by Param_Set */
+static uint32_t param_record[PARAM_RECORD_WORDS(PARAM_MAX_VALUE)];
+static uint16_t param_record_words;
+static uint16_t param_record_key;
+
+static Param_StepTypeDef param_step;
+static Param_StepTypeDef param_after_erase;
+static uint32_t param_erase_page;
+static uint8_t param_compacting;
+/* Word of the record, or of the header, programmed next */
+static uint16_t param_word;
+/* Compaction: key copied next, and the index and end of the spare page */
+static uint16_t param_copy_key;
+static uint16_t param_new_index[PARAM_KEY_COUNT];
+static uint16_t param_new_end;
+static HAL_StatusTypeDef param_status;
+
+static volatile uint8_t param_flash_busy;
+static volatile uint8_t param_flash_error;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t Param_Page(uint32_t page);
+static void Param_Scan(void);
+static uint8_t Param_IsErased(uint32_t page);
+static void Param_Program(uint32_t address, uint32_t word);
+static void Param_Erase(uint32_t page, Param_StepTypeDef after);
+static void Param_Finish(HAL_StatusTypeDef status);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Find the active page and index its records
+  * @note   Call once at boot, before any Param_Get. With no valid page the
+  *         store is empty and the first Param_Set formats one.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Param_Init(void)
+{
+  const Param_HeaderTypeDef *a = (const Param_HeaderTypeDef *)Param_Page(0U);
+  const Param_HeaderTypeDef *b = (const Param_HeaderTypeDef *)Param_Page(1U);
+  const uint8_t valid_a = a->Magic == PARAM_MAGIC;
+  const uint8_t valid_b = b->Magic == PARAM_MAGIC;
+
+  Crc_Init();
+  param_step = PARAM_STEP_IDLE;
+  param_status = HAL_OK;
+  param_flash_busy = 0U;
+  param_flash_error = 0U;
+  memset(param_index, 0, sizeof(param_index));
+
+  if (valid_a || valid_b) {
+    /* Both valid: a reset came before the old page was erased */
+    param_active = valid_b && (!valid_a || (int32_t)(b->Sequence - a->Sequence) > 0) ? 1U : 0U;
+    param_sequence = param_active != 0U ? b->Sequence : a->Sequence;
+    Param_Scan();
+  } else {
+    /* Nothing stored: a full page 1 sends the first write to page 0 */
+    param_active = 1U;
+    param_sequence = 0U;
+    param_end = PARAM_PAGE_SIZE;
+  }
+  param_spare_erased = Param_IsErased(param_active ^ 1U);
+
+  HAL_NVIC_SetPriority(FLASH_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(FLASH_IRQn);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Read the stored value of a key
+  * @param  key: parameter
+  * @param  value: destination, up to size bytes are copied
+  * @param  size: size of value
+  * @retval Length of the stored value, 0 if none
+  */
+uint16_t Param_Get(Param_KeyTypeDef key, void *value, uint16_t size)
+{
+  const uint32_t *record;
+  uint16_t length;
+
+  if (key == 0U || key >= PARAM_KEY_COUNT || param_index[key] == 0U) {
+    return 0U;
+  }
+  record = (const uint32_t *)(Param_Page(param_active) + param_index[key]);
+  length = (uint16_t)(record[0] >> 16);
+  memcpy(value, &record[1], length < size ? length : size);
+  return length;
+}
+
+/**
+  * @brief  Stage a new value for a key
+  * @note   Returns at once; the flash is programmed by the following
+  *         Param_Process calls. A value equal to the stored one is not
+  *         written again.
+  * @param  key: parameter
+  * @param  value: bytes to store
+  * @param  length: number of bytes, up to PARAM_MAX_VALUE
+  * @retval HAL_BUSY while the previous write is in progress
+  */
+HAL_StatusTypeDef Param_Set(Param_KeyTypeDef key, const void *value, uint16_t length)
+{
+  const uint32_t words = PARAM_RECORD_WORDS(length);
+  HAL_StatusTypeDef err;
+  uint8_t stored[PARAM_MAX_VALUE];
+
+  if (key == 0U || key >= PARAM_KEY_COUNT || length > PARAM_MAX_VALUE) {
+    return HAL_ERROR;
+  }
+  if (param_step != PARAM_STEP_IDLE) {
+    return HAL_BUSY;
+  }
+  if (Param_Get(key, stored, sizeof(stored)) == length && memcmp(stored, value, length) == 0) {
+    return HAL_OK;
+  }
+
+  memset(param_record, 0, words * sizeof(param_record[0]));
+  param_record[0] = (uint32_t)key | (uint32_t)length << 16;
+  memcpy(&param_record[1], value, length);
+  param_record[words - 1U] = Crc_Compute((const uint8_t *)param_record, 4U + length);
+  param_record_words = (uint16_t)words;
+  param_record_key = (uint16_t)key;
+
+  err = HAL_FLASH_Unlock();
+  if (err != HAL_OK) {
+    return err;
+  }
+  param_status = HAL_OK;
+  param_flash_error = 0U;
+  param_word = 0U;
+  param_compacting = param_end + words * 4U > PARAM_PAGE_SIZE;
+  if (!param_compacting) {
+    param_step = PARAM_STEP_APPEND;
+  } else {
+    memset(param_new_index, 0, sizeof(param_new_index));
+    param_new_end = sizeof(Param_HeaderTypeDef);
+    param_copy_key = 1U;
+    if (param_spare_erased) {
+      param_step = PARAM_STEP_COPY;
+    } else {
+      Param_Erase(param_active ^ 1U, PARAM_STEP_COPY);
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Start the next flash operation of a write, if the previous one
+  *         is over
+  * @note   Call from thread mode, as often as convenient: the idle loop
+  *         finishes a record within a few frames.
+  * @retval None
+  */
+void Param_Process(void)
+{
+  const uint32_t active = Param_Page(param_active);
+  const uint32_t spare = Param_Page(param_active ^ 1U);
+
+  if (param_step == PARAM_STEP_IDLE || param_flash_busy) {
+    return;
+  }
+  if (param_flash_error) {
+    Param_Finish(HAL_ERROR);
+    return;
+  }
+
+  switch (param_step) {
+    case PARAM_STEP_ERASE:
+      if (param_word == 0U) {
+        FLASH_EraseInitTypeDef erase = { FLASH_TYPEERASE_PAGES, Param_Page(param_erase_page), 1U };
+
+        param_word = 1U;
+        param_flash_busy = 1U;
+        if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK) {
+          param_flash_busy = 0U;
+          param_flash_error = 1U;
+        }
+        break;
+      }
+      if (param_erase_page != param_active) {
+        param_spare_erased = 1U;
+      }
+      param_word = 0U;
+      param_step = param_after_erase;
+      if (param_step == PARAM_STEP_IDLE) {
+        Param_Finish(HAL_OK);
+      }
+      break;
+
+    case PARAM_STEP_COPY:
+      while (param_copy_key < PARAM_KEY_COUNT
+             && (param_index[param_copy_key] == 0U || param_copy_key == param_record_key)) {
+        param_copy_key++;
+      }
+      if (param_copy_key == PARAM_KEY_COUNT) {
+        param_step = PARAM_STEP_APPEND;
+        break;
+      }
+      {
+        const uint32_t *src = (const uint32_t *)(active + param_index[param_copy_key]);
+
+        if (param_word < PARAM_RECORD_WORDS(src[0] >> 16)) {
+          Param_Program(spare + param_new_end + 4U * param_word, src[param_word]);
+          param_word++;
+          break;
+        }
+        param_new_index[param_copy_key] = param_new_end;
+        param_new_end += (uint16_t)(4U * param_word);
+        param_copy_key++;
+        param_word = 0U;
+      }
+      break;
+
+    case PARAM_STEP_APPEND:
+      {
+        const uint16_t end = param_compacting ? param_new_end : param_end;
+
+        if (param_word < param_record_words) {
+          Param_Program((param_compacting ? spare : active) + end + 4U * param_word,
+                        param_record[param_word]);
+          param_word++;
+          break;
+        }
+        param_word = 0U;
+        if (!param_compacting) {
+          param_index[param_record_key] = end;
+          param_end = end + 4U * param_record_words;
+          Param_Finish(HAL_OK);
+          break;
+        }
+        param_new_index[param_record_key] = end;
+        param_new_end = end + 4U * param_record_words;
+        param_step = PARAM_STEP_HEADER;
+      }
+      break;
+
+    case PARAM_STEP_HEADER:
+      if (param_word == 0U) {
+        Param_Program(spare, param_sequence + 1U);
+        param_word++;
+        break;
+      }
+      if (param_word == 1U) {
+        Param_Program(spare + 4U, PARAM_MAGIC);
+        param_word++;
+        break;
+      }
+      /* The spare page is the active one from here on */
+      param_active ^= 1U;
+      param_sequence++;
+      memcpy(param_index, param_new_index, sizeof(param_index));
+      param_end = param_new_end;
+      param_spare_erased = 0U;
+      param_compacting = 0U;
+      Param_Erase(param_active ^ 1U, PARAM_STEP_IDLE);
+      break;
+
+    default:
+      Param_Finish(HAL_ERROR);
+      break;
+  }
+}
+
+/**
+  * @brief  Tell whether a write is in progress
+  * @retval 1 until the last Param_Set is in flash
+  */
+uint8_t Param_IsBusy(void)
+{
+  return param_step != PARAM_STEP_IDLE;
+}
+
+/**
+  * @brief  Complete the write in progress
+  * @note   Blocks, for up to two page erases if a compaction is due.
+  * @retval Status of the last write
+  */
+HAL_StatusTypeDef Param_Flush(void)
+{
+  while (param_step != PARAM_STEP_IDLE) {
+    Param_Process();
+  }
+  return param_status;
+}
+
+/**
+  * @brief  Flash operation done
+  * @note   Runs from the flash interrupt, through HAL_FLASH_IRQHandler.
+  * @param  ReturnValue: address programmed, or page erased
+  * @retval None
+  */
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+  UNUSED(ReturnValue);
+  param_flash_busy = 0U;
+}
+
+/**
+  * @brief  Flash operation failed
+  * @param  ReturnValue: address of the failed operation
+  * @retval None
+  */
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+  UNUSED(ReturnValue);
+  param_flash_error = 1U;
+  param_flash_busy = 0U;
+}
+
+/**
+  * @brief  Address of a page of the store
+  * @param  page: 0 or 1
+  * @retval Page address
+  */
+static uint32_t Param_Page(uint32_t page)
+{
+  return PARAM_PAGE_ADDRESS + page * PARAM_PAGE_SIZE;
+}
+
+/**
+  * @brief  Index the records of the active page and find its end
+  * @note   A length running past the page, left by a reset during a key
+  *         and length word, ends the log at the page end: the next write
+  *         compacts.
+  * @retval None
+  */
+static void Param_Scan(void)
+{
+  const uint32_t base = Param_Page(param_active);
+  uint32_t offset = sizeof(Param_HeaderTypeDef);
+
+  while (offset + 8U <= PARAM_PAGE_SIZE) {
+    const uint32_t *record = (const uint32_t *)(base + offset);
+    const uint32_t key = record[0] & 0xFFFFU;
+    const uint32_t length = record[0] >> 16;
+    const uint32_t words = PARAM_RECORD_WORDS(length);
+
+    if (key == PARAM_FREE_KEY) {
+      break;
+    }
+    if (length > PARAM_MAX_VALUE || offset + 4U * words > PARAM_PAGE_SIZE) {
+      offset = PARAM_PAGE_SIZE;
+      break;
+    }
+    if (key != 0U && key < PARAM_KEY_COUNT
+        && Crc_Compute((const uint8_t *)record, 4U + length) == record[words - 1U]) {
+      param_index[key] = (uint16_t)offset;
+    }
+    offset += 4U * words;
+  }
+  param_end = (uint16_t)offset;
+}
+
+/**
+  * @brief  Check that a page is erased
+  * @param  page: 0 or 1
+  * @retval 1 if every word reads erased
+  */
+static uint8_t Param_IsErased(uint32_t page)
+{
+  const uint32_t *p = (const uint32_t *)Param_Page(page);
+
+  for (uint32_t i = 0U; i < PARAM_PAGE_SIZE / 4U; i++) {
+    if (p[i] != PARAM_ERASED) {
+      return 0U;
+    }
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Start programming one word
+  * @param  address: word address
+  * @param  word: value
+  * @retval None
+  */
+static void Param_Program(uint32_t address, uint32_t word)
+{
+  param_flash_busy = 1U;
+  if (HAL_FLASH_Program_IT(FLASH_TYPEPROGRAM_WORD, address, word) != HAL_OK) {
+    param_flash_busy = 0U;
+    param_flash_error = 1U;
+  }
+}
+
+/**
+  * @brief  Queue the erase of a page
+  * @param  page: 0 or 1
+  * @param  after: step that follows the erase
+  * @retval None
+  */
+static void Param_Erase(uint32_t page, Param_StepTypeDef after)
+{
+  param_erase_page = page;
+  param_after_erase = after;
+  param_word = 0U;
+  param_step = PARAM_STEP_ERASE;
+}
+
+/**
+  * @brief  End the write in progress
+  * @note   After a failure the log end is not trusted: the next write
+  *         compacts into the spare page, which is erased first.
+  * @param  status: result of the write
+  * @retval None
+  */
+static void Param_Finish(HAL_StatusTypeDef status)
+{
+  (void)HAL_FLASH_Lock();
+  if (status != HAL_OK) {
+    param_end = PARAM_PAGE_SIZE;
+    param_spare_erased = 0U;
+    param_compacting = 0U;
+  }
+  param_status = status;
+  param_step = PARAM_STEP_IDLE;
+}
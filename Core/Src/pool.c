@@ -0,0 +1,226 @@
+/**
+  ******************************************************************************
+  * @file           : pool.c
+  * @brief          : Fixed-block memory pools
+  *
+  *                   Every buffer the pipeline hands out comes from one
+  *                   static arena, sized at compile time from the pool table
+  *                   below, so the link map accounts for all of RAM. Each
+  *                   pool is a LIFO free list threaded through its own free
+  *                   blocks: allocation and release are a pointer swap with
+  *                   interrupts masked, O(1) and callable from any level.
+  *
+  *                   The capture buffer and the blob table are taken once at
+  *                   initialization; telemetry takes its packet and frame
+  *                   buffers for each packet and the run dump its table
+  *                   for each frame, and gives them back once sent. The
+  *                   high-water marks, reported over telemetry, tell how
+  *                   far each pool's block count can be trimmed, and a
+  *                   non-zero failure count a pool too small for the
+  *                   build. The run dump pool is compiled out with
+  *                   RUN_DUMP_ENABLED = 0. A block freed twice or foreign
+  *                   to the pool fails an assert_param.
+  *
+  *                   The newlib heap is only used during initialization;
+  *                   Sysmem_Lock (sysmem.c) turns any later _sbrk into a
+  *                   fatal error.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "pool.h"
+#include "capture.h"
+#include "cobs.h"
+#include "detect.h"
+#include "label.h"
+#include "telemetry.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct Pool_BlockTypeDef
+{
+  struct Pool_BlockTypeDef *Next;
+} Pool_BlockTypeDef;
+
+typedef struct
+{
+  uint32_t BlockSize;
+  uint16_t Blocks;
+} Pool_ConfigTypeDef;
+
+typedef struct
+{
+  uint8_t *Base;            /*!< First block                 */
+  Pool_BlockTypeDef *Free;  /*!< Free list head              */
+  uint32_t Used;            /*!< Bit n set while block n is out */
+  uint16_t InUse;
+  uint16_t HighWater;
+  uint16_t Failures;
+} Pool_StateTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define POOL_ROUND(size)        (((size) + 7U) & ~7U)
+
+/* Pool table: block size in bytes and number of blocks */
+#define POOL_CAPTURE_SIZE       (2U * CAPTURE_MAX_LINE_BYTES)
+#define POOL_CAPTURE_BLOCKS     1U
+#define POOL_BLOBS_SIZE         sizeof(Label_FrameTypeDef)
+#define POOL_BLOBS_BLOCKS       1U
+#if RUN_DUMP_ENABLED
+#define POOL_RUNS_SIZE          sizeof(Detect_RunsTypeDef)
+#define POOL_RUNS_BLOCKS        1U
+#else
+#define POOL_RUNS_SIZE          0U
+#define POOL_RUNS_BLOCKS        0U
+#endif
+#define POOL_PACKET_SIZE        (COBS_ENCODED_MAX(TELEMETRY_PACKET_MAX) + 1U)
+#define POOL_PACKET_BLOCKS      2U
+
+/* Pool_StateTypeDef.Used holds one bit per block */
+_Static_assert(POOL_CAPTURE_BLOCKS <= 32U && POOL_BLOBS_BLOCKS <= 32U
+               && POOL_RUNS_BLOCKS <= 32U && POOL_PACKET_BLOCKS <= 32U,
+               "pool block bitmap is 32 bits");
+
+#define POOL_ARENA_SIZE         (POOL_ROUND(POOL_CAPTURE_SIZE) * POOL_CAPTURE_BLOCKS \
+                                 + POOL_ROUND(POOL_BLOBS_SIZE) * POOL_BLOBS_BLOCKS \
+                                 + POOL_ROUND(POOL_RUNS_SIZE) * POOL_RUNS_BLOCKS \
+                                 + POOL_ROUND(POOL_PACKET_SIZE) * POOL_PACKET_BLOCKS)
+
+/* Private variables ---------------------------------------------------------*/
+static const Pool_ConfigTypeDef pool_config[POOL_COUNT] = {
+  [POOL_CAPTURE] = { POOL_ROUND(POOL_CAPTURE_SIZE), POOL_CAPTURE_BLOCKS },
+  [POOL_BLOBS] = { POOL_ROUND(POOL_BLOBS_SIZE), POOL_BLOBS_BLOCKS },
+#if RUN_DUMP_ENABLED
+  [POOL_RUNS] = { POOL_ROUND(POOL_RUNS_SIZE), POOL_RUNS_BLOCKS },
+#endif
+  [POOL_PACKET] = { POOL_ROUND(POOL_PACKET_SIZE), POOL_PACKET_BLOCKS },
+};
+
+static uint8_t pool_arena[POOL_ARENA_SIZE] __attribute__((aligned(8)));
+static Pool_StateTypeDef pool_state[POOL_COUNT];
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Carve the arena into pools and put every block on its free list
+  * @note   Any block handed out before is lost; call once, before the
+  *         modules that allocate.
+  * @retval None
+  */
+void Pool_Init(void)
+{
+  uint8_t *base = pool_arena;
+
+  for (uint32_t i = 0U; i < POOL_COUNT; i++) {
+    const Pool_ConfigTypeDef *config = &pool_config[i];
+    Pool_StateTypeDef *state = &pool_state[i];
+
+    state->Base = base;
+    state->Free = NULL;
+    state->Used = 0U;
+    state->InUse = 0U;
+    state->HighWater = 0U;
+    state->Failures = 0U;
+
+    /* Threaded last to first so that blocks go out in address order */
+    for (uint32_t b = config->Blocks; b > 0U; b--) {
+      Pool_BlockTypeDef *block = (Pool_BlockTypeDef *)(void *)&base[(b - 1U) * config->BlockSize];
+
+      block->Next = state->Free;
+      state->Free = block;
+    }
+    base += config->Blocks * config->BlockSize;
+  }
+}
+
+/**
+  * @brief  Take a block from a pool
+  * @param  pool: pool to allocate from
+  * @retval Block of at least the pool block size, 8-byte aligned, or NULL
+  *         if the pool is empty
+  */
+void *Pool_Alloc(Pool_IdTypeDef pool)
+{
+  Pool_StateTypeDef *state = &pool_state[pool];
+  uint32_t primask = __get_PRIMASK();
+  Pool_BlockTypeDef *block;
+
+  __disable_irq();
+  block = state->Free;
+  if (block != NULL) {
+    state->Free = block->Next;
+    state->Used |= 1UL << ((uint32_t)((uint8_t *)block - state->Base)
+                           / pool_config[pool].BlockSize);
+    if (++state->InUse > state->HighWater) {
+      state->HighWater = state->InUse;
+    }
+  } else {
+    state->Failures++;
+  }
+  __set_PRIMASK(primask);
+
+  return block;
+}
+
+/**
+  * @brief  Return a block to its pool
+  * @param  pool: pool the block was allocated from
+  * @param  block: block returned by Pool_Alloc, NULL is ignored
+  * @retval HAL_ERROR if the block does not belong to the pool or is not
+  *         allocated; assert_param fails first when enabled
+  */
+HAL_StatusTypeDef Pool_Free(Pool_IdTypeDef pool, void *block)
+{
+  const Pool_ConfigTypeDef *config = &pool_config[pool];
+  Pool_StateTypeDef *state = &pool_state[pool];
+  uint32_t offset;
+  uint32_t bit;
+  uint32_t primask;
+  HAL_StatusTypeDef err = HAL_OK;
+
+  if (block == NULL) {
+    return HAL_OK;
+  }
+  offset = (uint32_t)((uint8_t *)block - state->Base);
+  if ((uint8_t *)block < state->Base || offset >= config->Blocks * config->BlockSize
+      || offset % config->BlockSize != 0U) {
+    assert_param(0U);
+    return HAL_ERROR;
+  }
+  bit = 1UL << (offset / config->BlockSize);
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if ((state->Used & bit) != 0U) {
+    state->Used &= ~bit;
+    ((Pool_BlockTypeDef *)block)->Next = state->Free;
+    state->Free = block;
+    state->InUse--;
+  } else {
+    err = HAL_ERROR;
+  }
+  __set_PRIMASK(primask);
+
+  /* Freed twice: the block is already on the free list */
+  assert_param(err == HAL_OK);
+  return err;
+}
+
+/**
+  * @brief  Copy the occupancy of a pool
+  * @param  pool: pool to report
+  * @param  stats: destination
+  * @retval None
+  */
+void Pool_GetStats(Pool_IdTypeDef pool, Pool_StatsTypeDef *stats)
+{
+  const Pool_StateTypeDef *state = &pool_state[pool];
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  stats->BlockSize = pool_config[pool].BlockSize;
+  stats->Blocks = pool_config[pool].Blocks;
+  stats->InUse = state->InUse;
+  stats->HighWater = state->HighWater;
+  stats->Failures = state->Failures;
+  __set_PRIMASK(primask);
+}
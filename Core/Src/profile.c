@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+  * @file           : profile.c
+  * @brief          : DWT cycle-counter profiling
+  *
+  *                   The cycle counter is started unconditionally: telemetry
+  *                   timestamps rely on it even with profiling compiled out.
+  *                   Statistics are recorded from thread mode and from the
+  *                   capture interrupts; readers take a snapshot with
+  *                   interrupts masked.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "ccm.h"
+#include "profile.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+#if PROFILE_ENABLED
+Profile_StageStatsTypeDef profile_stages[PROFILE_STAGE_COUNT] CCM_BSS;
+#endif
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start the DWT cycle counter and clear the statistics
+  * @retval None
+  */
+void Profile_Init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  Profile_Reset();
+}
+
+/**
+  * @brief  Clear the statistics of every stage
+  * @retval None
+  */
+void Profile_Reset(void)
+{
+#if PROFILE_ENABLED
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memset(profile_stages, 0, sizeof(profile_stages));
+  for (uint32_t i = 0U; i < PROFILE_STAGE_COUNT; i++) {
+    profile_stages[i].Min = UINT32_MAX;
+  }
+  __set_PRIMASK(primask);
+#endif
+}
+
+/**
+  * @brief  Summarize the statistics of a stage
+  * @param  stage: pipeline stage
+  * @param  stats: destination, all zero when profiling is compiled out
+  * @retval None
+  */
+void Profile_GetStats(Profile_StageTypeDef stage, Profile_StatsTypeDef *stats)
+{
+#if PROFILE_ENABLED
+  Profile_StageStatsTypeDef snapshot;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  snapshot = profile_stages[stage];
+  __set_PRIMASK(primask);
+
+  stats->Count = 0U;
+  for (uint32_t i = 0U; i < PROFILE_BINS; i++) {
+    stats->Histogram[i] = snapshot.Histogram[i];
+    stats->Count += snapshot.Histogram[i];
+  }
+  stats->Min = stats->Count != 0U ? snapshot.Min : 0U;
+  stats->Max = snapshot.Max;
+  stats->Mean = stats->Count != 0U ? (uint32_t)(snapshot.Sum / stats->Count) : 0U;
+#else
+  UNUSED(stage);
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
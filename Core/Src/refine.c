@@ -0,0 +1,518 @@
+/**
+  ******************************************************************************
+  * @file           : refine.c
+  * @brief          : Subpixel Gaussian fit of the dot centroid
+  *
+  *                   Intensity-weighted moments only see the samples above
+  *                   the detection threshold, less the threshold: a high
+  *                   threshold leaves a few samples near the top of the
+  *                   spot and pulls the centroid towards pixel centers.
+  *                   Around the heaviest blob the samples are fitted
+  *                   instead with an axis-aligned Gaussian over the
+  *                   background,
+  *                   I = bg + A exp(-(x - x0)^2 / 2sx^2 - (y - y0)^2 / 2sy^2),
+  *                   whose logarithm is a quadratic in x and y:
+  *                   ln(I - bg) = a + b u + c u^2 + d v + e v^2, with the
+  *                   center at u = -b / 2c, v = -d / 2e. The quadratic is a
+  *                   linear least-squares fit over a square window around
+  *                   the rounded moment centroid, weighted by (I - bg)^2 so
+  *                   that the noisy flanks count little. Background is the
+  *                   window minimum. Samples below halfway from it to the
+  *                   threshold are noise rather than spot, and clipped
+  *                   samples are left out, so that a saturated spot is
+  *                   fitted on its flanks alone. The window reaches one
+  *                   sample past the blob bounding box, at least
+  *                   2 REFINE_RADIUS + 1 and at most 2 REFINE_MAX_RADIUS + 1
+  *                   samples wide: a saturated core then sits inside a
+  *                   ring of unclipped flank instead of filling the window.
+  *
+  *                   Sums are fixed point: ln(I - bg) comes from a Q16
+  *                   table, the per-row sums of q u^k from 32-bit MACs, but
+  *                   for q u^4 and those of q ln(I - bg) u^k which take
+  *                   SMLAL, and only the 5 x 5 normal equations are solved
+  *                   on the FPU. A fit takes a number of steps set by the
+  *                   window alone, about 4000 cycles at 11 x 11 and three
+  *                   times that at 19 x 19, and the centroid is rounded to
+  *                   1/64 pixel. A fit that fails keeps the moment
+  *                   centroid: too few samples, a core clipped over most of
+  *                   the window, no peak, or a center more than
+  *                   REFINE_MAX_SHIFT away.
+  *
+  *                   The pipeline keeps no frame, so the samples are taken
+  *                   from the lines as they stream: a REFINE_PATCH square
+  *                   around the tracker prediction of the next frame is
+  *                   copied out of each line, and published with the frame
+  *                   at its end. Thread mode fits on the published patch
+  *                   and checks the sequence counter afterwards.
+
+  *                   With REFINE_ENABLED at 0 nothing here is built.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <string.h>
+#include "ccm.h"
+#include "capture.h"
+#include "detect.h"
+#include "refine.h"
+#include "roi.h"
+#include "track.h"
+
+#if REFINE_ENABLED
+
+/* Private typedef -----------------------------------------------------------*/
+/**
+  * @brief Samples of one frame around the dot
+  */
+typedef struct
+{
+  uint32_t Frame;   /*!< Capture frame sequence number               */
+  uint16_t X;       /*!< Window sample of the patch corner            */
+  uint16_t Y;
+  uint16_t Width;   /*!< Columns kept, 0 when the frame had no aim    */
+  uint16_t Height;  /*!< Lines kept, fewer at the bottom of a window  */
+  uint8_t Samples[REFINE_PATCH][REFINE_PATCH];
+} Refine_PatchTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define REFINE_NO_AIM           0xFFFFFFFFU
+/* Thread mode is done with frame N before the first line of N + 1 */
+#define REFINE_LEAD_FRAMES      1U
+/* Unknowns of the fit: a, b, c, d, e */
+#define REFINE_TERMS            5U
+
+/* Private variables ---------------------------------------------------------*/
+/* ln(k) in Q16, k = 1..255 */
+static const int32_t refine_log[256] = {
+       0,      0,  45426,  71999,  90852, 105476, 117425, 127527,
+  136278, 143997, 150902, 157148, 162851, 168097, 172953, 177475,
+  181704, 185677, 189423, 192967, 196328, 199526, 202575, 205488,
+  208277, 210952, 213523, 215996, 218379, 220679, 222901, 225050,
+  227130, 229147, 231104, 233003, 234849, 236645, 238393, 240095,
+  241754, 243373, 244952, 246494, 248001, 249473, 250914, 252323,
+  253703, 255054, 256378, 257676, 258949, 260197, 261422, 262625,
+  263805, 264965, 266105, 267225, 268327, 269410, 270476, 271524,
+  272557, 273573, 274573, 275559, 276530, 277486, 278429, 279359,
+  280276, 281180, 282071, 282951, 283819, 284676, 285521, 286356,
+  287180, 287995, 288799, 289593, 290378, 291154, 291920, 292678,
+  293427, 294167, 294900, 295624, 296340, 297048, 297749, 298443,
+  299129, 299808, 300480, 301146, 301804, 302457, 303102, 303742,
+  304375, 305002, 305623, 306239, 306848, 307452, 308051, 308644,
+  309232, 309814, 310392, 310964, 311531, 312094, 312652, 313205,
+  313753, 314297, 314836, 315371, 315902, 316428, 316951, 317469,
+  317983, 318493, 318999, 319501, 319999, 320494, 320985, 321472,
+  321956, 322436, 322912, 323386, 323855, 324322, 324785, 325245,
+  325702, 326155, 326606, 327053, 327497, 327939, 328377, 328812,
+  329245, 329675, 330102, 330526, 330947, 331366, 331782, 332196,
+  332607, 333015, 333421, 333824, 334225, 334623, 335019, 335413,
+  335804, 336193, 336580, 336964, 337346, 337726, 338104, 338479,
+  338853, 339224, 339593, 339961, 340326, 340689, 341050, 341409,
+  341766, 342121, 342475, 342826, 343175, 343523, 343869, 344213,
+  344555, 344896, 345234, 345571, 345907, 346240, 346572, 346902,
+  347231, 347557, 347883, 348206, 348528, 348849, 349168, 349485,
+  349801, 350115, 350428, 350739, 351049, 351358, 351665, 351970,
+  352274, 352577, 352878, 353178, 353477, 353774, 354070, 354364,
+  354658, 354950, 355240, 355530, 355818, 356104, 356390, 356674,
+  356957, 357239, 357520, 357799, 358078, 358355, 358631, 358906,
+  359179, 359452, 359723, 359993, 360262, 360530, 360797, 361063,
+  361328, 361592, 361854, 362116, 362377, 362636, 362895, 363152,
+};
+
+static Refine_PatchTypeDef refine_build CCM_BSS;
+/* Patch center for the next frame, row << 16 | column, or REFINE_NO_AIM */
+static volatile uint32_t refine_aim;
+
+static volatile uint32_t refine_seq;
+static Refine_PatchTypeDef refine_published;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Refine_Begin(uint32_t samples);
+static uint8_t Refine_Solve(float m[REFINE_TERMS][REFINE_TERMS + 1U], float x[REFINE_TERMS]);
+static int32_t Refine_Round(float offset);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset the patch and drop the aim
+  * @retval None
+  */
+void Refine_Init(void)
+{
+  refine_aim = REFINE_NO_AIM;
+  refine_build.Width = 0U;
+  refine_build.Height = 0U;
+}
+
+/**
+  * @brief  Keep the samples of one line that fall in the patch
+  * @note   Runs from the capture DMA interrupt, after the detector.
+  * @param  line: captured bytes, or the redness scores of an RGB565 line
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples
+  * @param  y: line index in the frame
+  * @retval None
+  */
+CCM_FUNC void Refine_Line(const uint8_t *line, uint16_t line_bytes, uint16_t stride, uint16_t y)
+{
+  const uint8_t *src;
+  uint8_t *dst;
+  uint32_t row;
+
+  if (y == 0U) {
+    Refine_Begin(line_bytes / stride);
+  }
+  row = (uint32_t)y - refine_build.Y;
+  if (refine_build.Width == 0U || row >= REFINE_PATCH) {
+    return;
+  }
+
+  src = &line[refine_build.X * stride];
+  dst = refine_build.Samples[row];
+  if (stride == 1U) {
+    memcpy(dst, src, REFINE_PATCH);
+  } else {
+    for (uint32_t i = 0U; i < REFINE_PATCH; i++) {
+      dst[i] = src[i * stride];
+    }
+  }
+  refine_build.Height = (uint16_t)(row + 1U);
+}
+
+/**
+  * @brief  Publish the patch of the frame
+  * @param  frame: capture frame sequence number
+  * @retval None
+  */
+void Refine_EndFrame(uint32_t frame)
+{
+  refine_build.Frame = frame;
+  refine_seq++;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  refine_published = refine_build;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  refine_seq++;
+}
+
+/**
+  * @brief  Replace the moment centroid of the heaviest blob by the fitted
+  *         one
+  * @note   Call from thread mode with a frame read at full resolution,
+  *         before the frame result is superseded by the next one.
+  * @param  frame: blobs of the frame, coordinates in window samples
+  * @retval 1 if the centroid was refined, 0 if it was left as is
+  */
+uint8_t Refine_Frame(Label_FrameTypeDef *frame)
+{
+  Label_BlobTypeDef *blob = &frame->Blobs[0];
+  int32_t r;
+  int32_t cx;
+  int32_t cy;
+  int32_t u;
+  int32_t v;
+  int32_t dx;
+  int32_t dy;
+  uint32_t seq;
+  uint8_t fitted;
+
+  if (frame->Count == 0U) {
+    return 0U;
+  }
+  cx = (blob->X + (1L << 15)) >> 16;
+  cy = (blob->Y + (1L << 15)) >> 16;
+  r = (int32_t)Refine_Radius(blob->XMax - blob->XMin > blob->YMax - blob->YMin
+                             ? blob->XMax - blob->XMin + 1U : blob->YMax - blob->YMin + 1U);
+
+  /* The fit reads the published patch in place: it is only rewritten at
+     the end of the next frame, and a fit it overlapped is discarded */
+  seq = refine_seq;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  if ((seq & 1U) != 0U || refine_published.Frame != frame->Frame) {
+    return 0U;
+  }
+  u = cx - refine_published.X;
+  v = cy - refine_published.Y;
+  if (u < r || v < r || u + r >= (int32_t)refine_published.Width
+      || v + r >= (int32_t)refine_published.Height) {
+    return 0U;
+  }
+  fitted = Refine_Fit(&refine_published.Samples[v][u], REFINE_PATCH, (uint32_t)r,
+                      Detect_GetThreshold(), &dx, &dy);
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  if (!fitted || seq != refine_seq) {
+    return 0U;
+  }
+
+  blob->X = cx * (1L << 16) + dx;
+  blob->Y = cy * (1L << 16) + dy;
+  blob->Refined = 1U;
+  return 1U;
+}
+
+/**
+  * @brief  Center the patch of the next frame on the tracker prediction
+  * @note   Call from thread mode once a frame is processed, after
+  *         Roi_Update. Without a track, or while searching, no patch is
+  *         kept.
+  * @param  frame: frame just processed
+  * @retval None
+  */
+void Refine_Aim(uint32_t frame)
+{
+  const uint32_t period = Capture_GetFramePeriod();
+  Track_PredictionTypeDef prediction;
+  Sensor_WindowTypeDef window;
+  uint32_t time;
+  float x;
+  float y;
+
+  (void)Roi_GetWindow(frame, &window);
+  if (Roi_GetState() != ROI_STATE_TRACK || window.Scale != 1U || period == 0U
+      || !Capture_GetFrameTime(frame, &time)
+      || !Track_Predict(time + REFINE_LEAD_FRAMES * period, &prediction)) {
+    refine_aim = REFINE_NO_AIM;
+    return;
+  }
+
+  x = prediction.X - (float)window.X + 0.5f;
+  y = prediction.Y - (float)window.Y + 0.5f;
+  if (!(x >= 0.0f && x < (float)window.Width && y >= 0.0f && y < (float)window.Height)) {
+    refine_aim = REFINE_NO_AIM;
+    return;
+  }
+  refine_aim = (uint32_t)y << 16 | (uint32_t)x;
+}
+
+/**
+  * @brief  Half side of the fit window for a blob
+  * @param  extent: larger side of the blob bounding box, samples
+  * @retval Radius in [REFINE_RADIUS, REFINE_MAX_RADIUS]
+  */
+uint32_t Refine_Radius(uint32_t extent)
+{
+  const uint32_t r = extent / 2U + 1U;
+
+  return r < REFINE_RADIUS ? REFINE_RADIUS : r > REFINE_MAX_RADIUS ? REFINE_MAX_RADIUS : r;
+}
+
+/**
+  * @brief  Fit a Gaussian spot on the window around a sample
+  * @note   The (2 radius + 1)^2 window must lie in the buffer.
+  * @param  center: window center sample
+  * @param  pitch: bytes between two rows
+  * @param  radius: half side of the window, at most REFINE_MAX_RADIUS
+  * @param  threshold: detection threshold the samples were cut at
+  * @param  dx: center column offset from the sample, Q16.16 pixels rounded
+  *         to 2^-REFINE_FRACTION_BITS
+  * @param  dy: center row offset from the sample, same format
+  * @retval 1 on success, 0 if the fit failed and dx, dy are unset
+  */
+uint8_t Refine_Fit(const uint8_t *center, uint32_t pitch, uint32_t radius, uint8_t threshold,
+                   int32_t *dx, int32_t *dy)
+{
+  const int32_t r = (int32_t)radius;
+  int64_t n00 = 0, n01 = 0, n02 = 0, n03 = 0, n04 = 0;
+  int64_t n12 = 0, n13 = 0, n14 = 0;
+  int64_t n22 = 0, n23 = 0, n24 = 0;
+  int64_t n34 = 0, n44 = 0;
+  int64_t b0 = 0, b1 = 0, b2 = 0, b3 = 0, b4 = 0;
+  float m[REFINE_TERMS][REFINE_TERMS + 1U];
+  float k[REFINE_TERMS];
+  float fx;
+  float fy;
+  float scale;
+  uint32_t samples = 0U;
+  uint32_t clipped = 0U;
+  uint32_t bg = 255U;
+  uint32_t floor;
+
+  for (int32_t v = -r; v <= r; v++) {
+    const uint8_t *row = center + v * (int32_t)pitch;
+
+    for (int32_t u = -r; u <= r; u++) {
+      bg = row[u] < bg ? row[u] : bg;
+      clipped += row[u] >= REFINE_CLIP;
+    }
+  }
+  floor = threshold > bg ? (bg + threshold) / 2U : bg;
+
+  /* Row sums in 32 (q u^k) and 64 bits (q u^4, q ln(w) u^k), folded into
+     the normal equations with the powers of v once per row; q u^4 reaches
+     2^33 over a row of the widest window */
+  for (int32_t v = -r; v <= r; v++) {
+    const uint8_t *row = center + v * (int32_t)pitch;
+    int32_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+    int64_t r4 = 0, t0 = 0, t1 = 0, t2 = 0;
+    const int64_t v2 = v * v;
+
+    for (int32_t u = -r; u <= r; u++) {
+      const uint32_t w = (uint32_t)row[u] - bg;
+      int32_t q;
+      int32_t qu;
+      int32_t qu2;
+      int32_t l;
+
+      if (row[u] <= floor || row[u] >= REFINE_CLIP) {
+        continue;
+      }
+      q = (int32_t)(w * w);
+      qu = q * u;
+      qu2 = qu * u;
+      l = refine_log[w];
+      r0 += q;
+      r1 += qu;
+      r2 += qu2;
+      r3 += qu2 * u;
+      r4 += qu2 * u * u;
+      t0 += (int64_t)q * l;
+      t1 += (int64_t)qu * l;
+      t2 += (int64_t)qu2 * l;
+      samples++;
+    }
+
+    n00 += r0;
+    n01 += r1;
+    n02 += r2;
+    n12 += r3;
+    n22 += r4;
+    n03 += v * (int64_t)r0;
+    n04 += v2 * r0;
+    n34 += v2 * v * r0;
+    n44 += v2 * v2 * r0;
+    n13 += v * (int64_t)r1;
+    n14 += v2 * r1;
+    n23 += v * (int64_t)r2;
+    n24 += v2 * r2;
+    b0 += t0;
+    b1 += t1;
+    b2 += t2;
+    b3 += v * t0;
+    b4 += v2 * t0;
+  }
+  /* A core clipped over most of the window leaves only its corners */
+  if (samples < REFINE_MIN_SAMPLES || clipped > samples) {
+    return 0U;
+  }
+
+  /* Terms 1, u, u^2, v, v^2; normalized by the total weight so that the
+     matrix stays well inside the float range */
+  scale = 1.0f / (float)n00;
+  m[0][0] = 1.0f;
+  m[0][1] = m[1][0] = (float)n01 * scale;
+  m[0][2] = m[2][0] = m[1][1] = (float)n02 * scale;
+  m[0][3] = m[3][0] = (float)n03 * scale;
+  m[0][4] = m[4][0] = m[3][3] = (float)n04 * scale;
+  m[1][2] = m[2][1] = (float)n12 * scale;
+  m[1][3] = m[3][1] = (float)n13 * scale;
+  m[1][4] = m[4][1] = (float)n14 * scale;
+  m[2][2] = (float)n22 * scale;
+  m[2][3] = m[3][2] = (float)n23 * scale;
+  m[2][4] = m[4][2] = (float)n24 * scale;
+  m[3][4] = m[4][3] = (float)n34 * scale;
+  m[4][4] = (float)n44 * scale;
+  scale /= (float)(1L << 16);
+  m[0][REFINE_TERMS] = (float)b0 * scale;
+  m[1][REFINE_TERMS] = (float)b1 * scale;
+  m[2][REFINE_TERMS] = (float)b2 * scale;
+  m[3][REFINE_TERMS] = (float)b3 * scale;
+  m[4][REFINE_TERMS] = (float)b4 * scale;
+
+  if (!Refine_Solve(m, k) || !(k[2] < 0.0f) || !(k[4] < 0.0f)) {
+    return 0U;
+  }
+  fx = -k[1] / (2.0f * k[2]);
+  fy = -k[3] / (2.0f * k[4]);
+  if (!(fabsf(fx) <= REFINE_MAX_SHIFT && fabsf(fy) <= REFINE_MAX_SHIFT)) {
+    return 0U;
+  }
+
+  *dx = Refine_Round(fx);
+  *dy = Refine_Round(fy);
+  return 1U;
+}
+
+/**
+  * @brief  Latch the aim and place the patch for a new frame
+  * @param  samples: samples per line
+  * @retval None
+  */
+CCM_FUNC static void Refine_Begin(uint32_t samples)
+{
+  const uint32_t aim = refine_aim;
+  int32_t x;
+  int32_t y;
+
+  refine_build.Width = 0U;
+  refine_build.Height = 0U;
+  if (aim == REFINE_NO_AIM || samples < REFINE_PATCH) {
+    return;
+  }
+
+  x = (int32_t)(aim & 0xFFFFU) - (int32_t)REFINE_PATCH / 2;
+  y = (int32_t)(aim >> 16) - (int32_t)REFINE_PATCH / 2;
+  x = x < 0 ? 0 : x > (int32_t)(samples - REFINE_PATCH) ? (int32_t)(samples - REFINE_PATCH) : x;
+  refine_build.X = (uint16_t)x;
+  refine_build.Y = (uint16_t)(y < 0 ? 0 : y);
+  refine_build.Width = REFINE_PATCH;
+}
+
+/**
+  * @brief  Solve the normal equations by Gaussian elimination with partial
+  *         pivoting
+  * @param  m: augmented matrix, destroyed
+  * @param  x: solution
+  * @retval 1 on success, 0 if the matrix is singular
+  */
+static uint8_t Refine_Solve(float m[REFINE_TERMS][REFINE_TERMS + 1U], float x[REFINE_TERMS])
+{
+  for (uint32_t c = 0U; c < REFINE_TERMS; c++) {
+    uint32_t pivot = c;
+
+    for (uint32_t i = c + 1U; i < REFINE_TERMS; i++) {
+      if (fabsf(m[i][c]) > fabsf(m[pivot][c])) {
+        pivot = i;
+      }
+    }
+    if (!(fabsf(m[pivot][c]) > 1e-9f)) {
+      return 0U;
+    }
+    if (pivot != c) {
+      for (uint32_t j = c; j <= REFINE_TERMS; j++) {
+        const float t = m[c][j];
+
+        m[c][j] = m[pivot][j];
+        m[pivot][j] = t;
+      }
+    }
+    for (uint32_t i = c + 1U; i < REFINE_TERMS; i++) {
+      const float f = m[i][c] / m[c][c];
+
+      for (uint32_t j = c; j <= REFINE_TERMS; j++) {
+        m[i][j] -= f * m[c][j];
+      }
+    }
+  }
+
+  for (uint32_t i = REFINE_TERMS; i-- > 0U;) {
+    float s = m[i][REFINE_TERMS];
+
+    for (uint32_t j = i + 1U; j < REFINE_TERMS; j++) {
+      s -= m[i][j] * x[j];
+    }
+    x[i] = s / m[i][i];
+  }
+  return 1U;
+}
+
+/**
+  * @brief  Round a fitted offset to the reported precision
+  * @param  offset: pixels
+  * @retval Q16.16 pixels, a multiple of 2^-REFINE_FRACTION_BITS
+  */
+static int32_t Refine_Round(float offset)
+{
+  return (int32_t)floorf(offset * (float)(1U << REFINE_FRACTION_BITS) + 0.5f)
+         * (int32_t)(1U << (16U - REFINE_FRACTION_BITS));
+}
+
+#endif /* REFINE_ENABLED */
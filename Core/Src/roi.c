@@ -0,0 +1,282 @@
+/**
+  ******************************************************************************
+  * @file           : roi.c
+  * @brief          : Region-of-interest tracking
+  *
+  *                   Acquisition is coarse to fine. The search scans the
+  *                   full frame downsampled by the sensor to 80 x 60, which
+  *                   it outputs at twice the frame rate: 4800 pixels per
+  *                   frame to capture and process instead of 76800. Once a
+  *                   dot has been seen for ROI_LOCK_FRAMES search frames
+  *                   the sensor switches back to full resolution with its
+  *                   readout window shrunk to ROI_SIZE pixels around the
+  *                   dot, where the centroid is refined to subpixel
+  *                   precision. The window is re-centered when the dot
+  *                   nears its edge and returns to the search after
+  *                   ROI_LOST_FRAMES frames without a dot. Building with
+  *                   ROI_COARSE_SEARCH = 0 searches at full resolution.
+  *
+  *                   Blob coordinates are expected in output pixels: search
+  *                   frames are scaled up with Label_ScaleFrame before they
+  *                   are fed here.
+  *
+  *                   The sensor latches a new window at its next frame while
+  *                   the capture engine switches at the next VSYNC, so the
+  *                   frame following a change is discarded. A window decided
+  *                   on frame N is therefore first read out at frame N + 2:
+  *                   it is centered on the tracker prediction for that VSYNC
+  *                   rather than on the dot position in frame N.
+  *
+  *                   A window the sensor bus does not take, because the
+  *                   previous batch is still being written or failed, is
+  *                   not a fault: the state is left as it was and the
+  *                   decision made again on the next frame. A failed batch
+  *                   may have left part of the window in the sensor, so
+  *                   the window in use is then written again first.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "roi.h"
+#include "capture.h"
+#include "hotpix.h"
+#include "track.h"
+
+/* Private variables ---------------------------------------------------------*/
+static Roi_StateTypeDef roi_state;
+static Sensor_WindowTypeDef roi_window;
+static uint32_t roi_valid_from;
+static uint32_t roi_lock_count;
+static uint32_t roi_lost_count;
+/* Dot position in the last search frame, in output pixels */
+static int32_t roi_candidate_x;
+static int32_t roi_candidate_y;
+/* The last window batch failed: the sensor may not hold roi_window */
+static uint8_t roi_resend;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef Roi_Apply(uint32_t frame, int32_t cx, int32_t cy, uint16_t size);
+static void Roi_Target(uint32_t frame, int32_t *cx, int32_t *cy);
+static int32_t Roi_Clamp(float v, uint16_t size);
+static uint8_t Roi_Near(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start in search mode and program the search window
+  * @note   Call once the sensor mode table is loaded and before the capture
+  *         starts: waits for the window registers, so that the first frame
+  *         captured is already a search frame.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Roi_Init(void)
+{
+  HAL_StatusTypeDef err;
+
+  roi_state = ROI_STATE_SEARCH;
+  roi_lock_count = 0U;
+  roi_lost_count = 0U;
+  roi_resend = 0U;
+  err = Roi_Apply(0U, SENSOR_WIDTH / 2, SENSOR_HEIGHT / 2, 0U);
+  if (err != HAL_OK) {
+    return err;
+  }
+  roi_valid_from = 0U;
+  return Sensor_Wait();
+}
+
+/**
+  * @brief  Feed the blobs of a frame and move the window if needed
+  * @note   Queues SCCB writes: call from thread mode.
+  * @param  frame: labeled frame, in output pixels relative to its window
+  * @retval HAL status: HAL_BUSY or the bus error of the previous batch when
+  *         the window was not programmed, in which case the state is kept
+  *         and the write retried on the next frame
+  */
+HAL_StatusTypeDef Roi_Update(const Label_FrameTypeDef *frame)
+{
+  const Label_BlobTypeDef *dot = &frame->Blobs[0];
+  HAL_StatusTypeDef err;
+  int32_t cx;
+  int32_t cy;
+  int32_t tx;
+  int32_t ty;
+
+  /* Sensor_Wait returns at once when idle, with the status of the batch */
+  if (!Sensor_IsBusy() && Sensor_Wait() != HAL_OK) {
+    roi_resend = 1U;
+  }
+  if (roi_resend) {
+    return Roi_Apply(frame->Frame, (int32_t)(roi_window.X + roi_window.Width / 2U),
+                     (int32_t)(roi_window.Y + roi_window.Height / 2U),
+                     roi_window.Scale == 1U ? roi_window.Width : 0U);
+  }
+
+  if (frame->Frame < roi_valid_from) {
+    return HAL_OK;
+  }
+
+  if (frame->Count == 0U || dot->Weight < ROI_LOCK_WEIGHT) {
+    roi_lock_count = 0U;
+    if (roi_state == ROI_STATE_TRACK && ++roi_lost_count >= ROI_LOST_FRAMES) {
+      err = Roi_Apply(frame->Frame, SENSOR_WIDTH / 2, SENSOR_HEIGHT / 2, 0U);
+      if (err == HAL_OK) {
+        roi_state = ROI_STATE_SEARCH;
+      }
+      return err;
+    }
+    return HAL_OK;
+  }
+
+  roi_lost_count = 0U;
+  cx = (int32_t)roi_window.X + (dot->X >> 16);
+  cy = (int32_t)roi_window.Y + (dot->Y >> 16);
+
+  if (roi_state == ROI_STATE_SEARCH) {
+    /* Only a candidate that stays put counts towards the lock */
+    if (roi_lock_count != 0U && !Roi_Near(cx, cy, roi_candidate_x, roi_candidate_y)) {
+      roi_lock_count = 0U;
+    }
+    roi_candidate_x = cx;
+    roi_candidate_y = cy;
+    tx = cx;
+    ty = cy;
+    if (++roi_lock_count < ROI_LOCK_FRAMES) {
+      return HAL_OK;
+    }
+    /* The tracker may still coast on the dot it lost: its prediction is
+       only trusted next to the candidate */
+    Roi_Target(frame->Frame, &tx, &ty);
+    if (Roi_Near(tx, ty, cx, cy)) {
+      cx = tx;
+      cy = ty;
+    }
+    err = Roi_Apply(frame->Frame, cx, cy, ROI_SIZE);
+    if (err == HAL_OK) {
+      roi_state = ROI_STATE_TRACK;
+    }
+    return err;
+  }
+
+  Roi_Target(frame->Frame, &cx, &cy);
+  if (!Roi_Near(cx, cy, (int32_t)(roi_window.X + roi_window.Width / 2U),
+                (int32_t)(roi_window.Y + roi_window.Height / 2U))) {
+    return Roi_Apply(frame->Frame, cx, cy, ROI_SIZE);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Return the tracking state
+  * @retval ROI state
+  */
+Roi_StateTypeDef Roi_GetState(void)
+{
+  return roi_state;
+}
+
+/**
+  * @brief  Window a given frame was captured with
+  * @param  frame: capture frame sequence number
+  * @param  window: destination
+  * @retval 0 if the frame straddles a window change, 1 otherwise
+  */
+uint8_t Roi_GetWindow(uint32_t frame, Sensor_WindowTypeDef *window)
+{
+  *window = roi_window;
+  return frame >= roi_valid_from;
+}
+
+/**
+  * @brief  Replace a measured dot position by its prediction at the VSYNC
+  *         of the first frame read with a window decided now
+  * @param  frame: frame the decision is based on
+  * @param  cx: measured column in, predicted column out, in output pixels
+  * @param  cy: measured row in, predicted row out, in output pixels
+  * @retval None
+  */
+static void Roi_Target(uint32_t frame, int32_t *cx, int32_t *cy)
+{
+  const uint32_t period = Capture_GetFramePeriod();
+  Track_PredictionTypeDef prediction;
+  uint32_t time;
+
+  if (period == 0U || !Capture_GetFrameTime(frame, &time)
+      || !Track_Predict(time + ROI_LEAD_FRAMES * period, &prediction)) {
+    return;
+  }
+  *cx = Roi_Clamp(prediction.X, SENSOR_WIDTH);
+  *cy = Roi_Clamp(prediction.Y, SENSOR_HEIGHT);
+}
+
+/**
+  * @brief  Round a coordinate to the nearest pixel of the sensor array
+  * @param  v: coordinate, in output pixels
+  * @param  size: array size along that axis
+  * @retval Pixel index in [0, size)
+  */
+static int32_t Roi_Clamp(float v, uint16_t size)
+{
+  if (!(v >= 0.0f)) {
+    return 0;
+  }
+  if (v >= (float)(size - 1U)) {
+    return (int32_t)size - 1;
+  }
+  return (int32_t)(v + 0.5f);
+}
+
+/**
+  * @brief  Tell whether two points are within ROI_MARGIN along both axes
+  * @param  x0: first point column, in output pixels
+  * @param  y0: first point row, in output pixels
+  * @param  x1: second point column, in output pixels
+  * @param  y1: second point row, in output pixels
+  * @retval 1 if they are, 0 otherwise
+  */
+static uint8_t Roi_Near(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+  return x0 - x1 <= (int32_t)ROI_MARGIN && x1 - x0 <= (int32_t)ROI_MARGIN
+         && y0 - y1 <= (int32_t)ROI_MARGIN && y1 - y0 <= (int32_t)ROI_MARGIN;
+}
+
+/**
+  * @brief  Center a square window on a point, clamped to the sensor array,
+  *         and program the sensor, the capture engine and the hot pixel
+  *         map
+  * @param  frame: frame the decision is based on
+  * @param  cx: window center column, in output pixels
+  * @param  cy: window center row, in output pixels
+  * @param  size: window side at full resolution, 0 for the search window
+  * @retval HAL status; on failure nothing is changed
+  */
+static HAL_StatusTypeDef Roi_Apply(uint32_t frame, int32_t cx, int32_t cy, uint16_t size)
+{
+  HAL_StatusTypeDef err;
+  Sensor_WindowTypeDef window = { 0U, 0U, SENSOR_WIDTH, SENSOR_HEIGHT, ROI_SEARCH_SCALE };
+
+  if (size != 0U) {
+    int32_t x = cx - (int32_t)size / 2;
+    int32_t y = cy - (int32_t)size / 2;
+
+    x = x < 0 ? 0 : x > (int32_t)(SENSOR_WIDTH - size) ? (int32_t)(SENSOR_WIDTH - size) : x;
+    y = y < 0 ? 0 : y > (int32_t)(SENSOR_HEIGHT - size) ? (int32_t)(SENSOR_HEIGHT - size) : y;
+    window = (Sensor_WindowTypeDef){ (uint16_t)x, (uint16_t)y, size, size, 1U };
+  }
+
+  err = Sensor_SetWindow(&window);
+  if (err != HAL_OK) {
+    return err;
+  }
+  err = Capture_SetWindow(window.Width / window.Scale * CAPTURE_BYTES_PER_PIXEL,
+                          window.Height / window.Scale);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  Hotpix_SetWindow(&window);
+  roi_window = window;
+  roi_valid_from = frame + 2U;
+  roi_resend = 0U;
+  return HAL_OK;
+}
@@ -0,0 +1,384 @@
+/**
+  ******************************************************************************
+  * @file           : sensor.c
+  * @brief          : OV7670 camera sensor control over SCCB
+  *
+  *                   The sensor runs from the 8 MHz HSI on MCO (PA8) and is
+  *                   set to YUYV with a 4 MHz PCLK, inside the capture engine
+  *                   DMA budget. SCCB has no repeated start, so reads are a
+  *                   write of the register address followed by a separate
+  *                   read transaction.
+  *
+  *                   Configuration is table driven (sensor_tables.cpp). A
+  *                   batch of tables is streamed from the I2C1 interrupts:
+  *                   each transfer-complete callback issues the next
+  *                   register, so the CPU only takes a few interrupts per
+  *                   register and thread mode goes on meanwhile. With
+  *                   verification, the registers are then read back and
+  *                   compared under their mask. At 400 kHz a register write
+  *                   takes about 75 us and a readback 100 us: bring-up,
+  *                   verified, completes about 5 ms after the soft reset.
+  *
+  *                   A failed batch is reported once, by Sensor_Wait or by
+  *                   the next batch submitted.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sensor.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  SENSOR_STEP_WRITE = 0U,   /*!< Register address and value     */
+  SENSOR_STEP_ADDRESS,      /*!< Readback: register address     */
+  SENSOR_STEP_READ          /*!< Readback: register value       */
+} Sensor_StepTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+#define SENSOR_PID              0x76U
+#define SENSOR_TIMEOUT          10U
+/* Settling time after a soft reset, in ms */
+#define SENSOR_RESET_MS         1U
+/* Tables in one batch */
+#define SENSOR_BATCH_TABLES     2U
+
+/* Private variables ---------------------------------------------------------*/
+I2C_HandleTypeDef hi2c1;
+
+static Sensor_TableTypeDef sensor_tables[SENSOR_BATCH_TABLES];
+static uint32_t sensor_table_count;
+static uint32_t sensor_table;
+static uint32_t sensor_index;
+static uint8_t sensor_verify;
+static Sensor_StepTypeDef sensor_step;
+static uint8_t sensor_buffer[2];
+static volatile uint8_t sensor_busy;
+static volatile HAL_StatusTypeDef sensor_status;
+
+/* Window registers, kept until their batch completes */
+static Sensor_RegTypeDef sensor_window_regs[SENSOR_WINDOW_REGS];
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef Sensor_Submit(const Sensor_TableTypeDef *tables, uint32_t count,
+                                       uint8_t verify);
+static const Sensor_RegTypeDef *Sensor_Current(void);
+static void Sensor_Issue(void);
+static void Sensor_Finish(HAL_StatusTypeDef status);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Start XCLK, bring up I2C1, reset and identify the sensor, then
+  *         start loading the mode table and the default exposure
+  * @note   Returns once the load is under way: Sensor_Wait tells when it is
+  *         done.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Sensor_Init(void)
+{
+  HAL_StatusTypeDef err;
+  uint8_t pid;
+  Sensor_TableTypeDef tables[SENSOR_BATCH_TABLES];
+
+  HAL_RCC_MCOConfig(RCC_MCO, RCC_MCO1SOURCE_HSI, RCC_MCODIV_1);
+
+  /* 400 kHz fast mode from the 8 MHz HSI */
+  hi2c1.Instance = I2C1;
+  hi2c1.Init.Timing = 0x0000020B;
+  hi2c1.Init.OwnAddress1 = 0;
+  hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  hi2c1.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+  hi2c1.Init.OwnAddress2 = 0;
+  hi2c1.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+  hi2c1.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+  hi2c1.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+  err = HAL_I2C_Init(&hi2c1);
+  if (err != HAL_OK) {
+    return err;
+  }
+  err = HAL_I2CEx_ConfigAnalogFilter(&hi2c1, I2C_ANALOGFILTER_ENABLE);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  /* I2C interrupt init, below the capture path and the control loop */
+  HAL_NVIC_SetPriority(I2C1_EV_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+  HAL_NVIC_SetPriority(I2C1_ER_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+  sensor_busy = 0U;
+  sensor_status = HAL_OK;
+
+  err = Sensor_WriteReg(SENSOR_REG_COM7, 0x80U);
+  if (err != HAL_OK) {
+    return err;
+  }
+  HAL_Delay(SENSOR_RESET_MS);
+
+  err = Sensor_ReadReg(SENSOR_REG_PID, &pid);
+  if (err != HAL_OK) {
+    return err;
+  }
+  if (pid != SENSOR_PID) {
+    return HAL_ERROR;
+  }
+
+  tables[0] = sensor_mode_table;
+  tables[1] = sensor_exposure_tables[SENSOR_EXPOSURE_DEFAULT];
+  return Sensor_Submit(tables, SENSOR_BATCH_TABLES, SENSOR_VERIFY);
+}
+
+/**
+  * @brief  Wait for the batch in progress, if any
+  * @note   Sleeps between I2C interrupts.
+  * @retval Status of the batch
+  */
+HAL_StatusTypeDef Sensor_Wait(void)
+{
+  HAL_StatusTypeDef err;
+
+  while (sensor_busy) {
+    __WFI();
+  }
+  err = sensor_status;
+  sensor_status = HAL_OK;
+  return err;
+}
+
+/**
+  * @brief  Tell whether a batch is being written
+  * @retval 1 while busy, 0 otherwise
+  */
+uint8_t Sensor_IsBusy(void)
+{
+  return sensor_busy;
+}
+
+/**
+  * @brief  Write one sensor register
+  * @param  reg: register address
+  * @param  value: register value
+  * @retval HAL status, HAL_BUSY while a batch is being written
+  */
+HAL_StatusTypeDef Sensor_WriteReg(uint8_t reg, uint8_t value)
+{
+  uint8_t data[2] = { reg, value };
+
+  if (sensor_busy) {
+    return HAL_BUSY;
+  }
+  return HAL_I2C_Master_Transmit(&hi2c1, SENSOR_ADDRESS, data, sizeof(data),
+                                 SENSOR_TIMEOUT);
+}
+
+/**
+  * @brief  Read one sensor register
+  * @param  reg: register address
+  * @param  value: register value
+  * @retval HAL status, HAL_BUSY while a batch is being written
+  */
+HAL_StatusTypeDef Sensor_ReadReg(uint8_t reg, uint8_t *value)
+{
+  HAL_StatusTypeDef err;
+
+  if (sensor_busy) {
+    return HAL_BUSY;
+  }
+  err = HAL_I2C_Master_Transmit(&hi2c1, SENSOR_ADDRESS, &reg, 1U, SENSOR_TIMEOUT);
+  if (err != HAL_OK) {
+    return err;
+  }
+  return HAL_I2C_Master_Receive(&hi2c1, SENSOR_ADDRESS, value, 1U, SENSOR_TIMEOUT);
+}
+
+/**
+  * @brief  Start programming the readout window
+  * @note   The batch takes about 0.8 ms; the sensor applies the window
+  *         from its next frame. A window at SENSOR_SEARCH_SCALE also
+  *         doubles the frame rate, see sensor_tables.hpp.
+  * @param  window: window in output pixels, inside SENSOR_WIDTH x SENSOR_HEIGHT;
+  *         at SENSOR_SEARCH_SCALE, a multiple of it in size
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Sensor_SetWindow(const Sensor_WindowTypeDef *window)
+{
+  const Sensor_TableTypeDef table = { sensor_window_regs, SENSOR_WINDOW_REGS };
+
+  if (window->Width == 0U || window->Height == 0U
+      || window->X + window->Width > SENSOR_WIDTH
+      || window->Y + window->Height > SENSOR_HEIGHT
+      || (window->Scale != 1U && window->Scale != SENSOR_SEARCH_SCALE)
+      || window->Width % window->Scale != 0U || window->Height % window->Scale != 0U) {
+    return HAL_ERROR;
+  }
+  if (sensor_busy) {
+    return HAL_BUSY;
+  }
+
+  Sensor_WindowRegs(window, sensor_window_regs);
+  return Sensor_Submit(&table, 1U, 0U);
+}
+
+/**
+  * @brief  Master transmit complete: next register, or its readback
+  * @param  hi2c: I2C handle
+  * @retval None
+  */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c->Instance != I2C1) {
+    return;
+  }
+  if (sensor_step == SENSOR_STEP_ADDRESS) {
+    sensor_step = SENSOR_STEP_READ;
+  } else {
+    sensor_index++;
+  }
+  Sensor_Issue();
+}
+
+/**
+  * @brief  Master receive complete: check the register read back
+  * @param  hi2c: I2C handle
+  * @retval None
+  */
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  const Sensor_RegTypeDef *r;
+
+  if (hi2c->Instance != I2C1) {
+    return;
+  }
+  r = Sensor_Current();
+  if (((sensor_buffer[1] ^ r->Value) & r->Mask) != 0U) {
+    Sensor_Finish(HAL_ERROR);
+    return;
+  }
+  sensor_step = SENSOR_STEP_ADDRESS;
+  sensor_index++;
+  Sensor_Issue();
+}
+
+/**
+  * @brief  I2C error: the batch is abandoned
+  * @param  hi2c: I2C handle
+  * @retval None
+  */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  if (hi2c->Instance == I2C1) {
+    Sensor_Finish(HAL_ERROR);
+  }
+}
+
+/**
+  * @brief  Start writing a batch of tables
+  * @param  tables: tables, copied
+  * @param  count: number of tables, at most SENSOR_BATCH_TABLES
+  * @param  verify: 1 to read the registers back afterwards
+  * @retval HAL status: HAL_BUSY if a batch is in progress, the error of the
+  *         previous batch if it failed
+  */
+static HAL_StatusTypeDef Sensor_Submit(const Sensor_TableTypeDef *tables, uint32_t count,
+                                       uint8_t verify)
+{
+  HAL_StatusTypeDef err;
+
+  if (sensor_busy) {
+    return HAL_BUSY;
+  }
+  err = sensor_status;
+  if (err != HAL_OK) {
+    sensor_status = HAL_OK;
+    return err;
+  }
+
+  for (uint32_t i = 0U; i < count; i++) {
+    sensor_tables[i] = tables[i];
+  }
+  sensor_table_count = count;
+  sensor_table = 0U;
+  sensor_index = 0U;
+  sensor_verify = verify;
+  sensor_step = SENSOR_STEP_WRITE;
+  sensor_busy = 1U;
+  Sensor_Issue();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Register at the current position, moving on to the next table
+  *         when the current one is exhausted
+  * @retval Register, NULL past the last table
+  */
+static const Sensor_RegTypeDef *Sensor_Current(void)
+{
+  while (sensor_table < sensor_table_count) {
+    if (sensor_index < sensor_tables[sensor_table].Count) {
+      return &sensor_tables[sensor_table].Regs[sensor_index];
+    }
+    sensor_table++;
+    sensor_index = 0U;
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Start the next transfer of the batch, or close it
+  * @note   Called from thread mode to start, then from the I2C callbacks.
+  * @retval None
+  */
+static void Sensor_Issue(void)
+{
+  const Sensor_RegTypeDef *r = Sensor_Current();
+  HAL_StatusTypeDef err;
+
+  /* Readback skips the registers that cannot be checked */
+  while (r != NULL && sensor_step != SENSOR_STEP_WRITE && r->Mask == 0U) {
+    sensor_index++;
+    r = Sensor_Current();
+  }
+
+  if (r == NULL) {
+    if (sensor_step != SENSOR_STEP_WRITE || !sensor_verify) {
+      Sensor_Finish(HAL_OK);
+      return;
+    }
+    sensor_table = 0U;
+    sensor_index = 0U;
+    sensor_step = SENSOR_STEP_ADDRESS;
+    Sensor_Issue();
+    return;
+  }
+
+  switch (sensor_step) {
+    case SENSOR_STEP_WRITE:
+      sensor_buffer[0] = r->Reg;
+      sensor_buffer[1] = r->Value;
+      err = HAL_I2C_Master_Transmit_IT(&hi2c1, SENSOR_ADDRESS, sensor_buffer, 2U);
+      break;
+    case SENSOR_STEP_ADDRESS:
+      sensor_buffer[0] = r->Reg;
+      err = HAL_I2C_Master_Transmit_IT(&hi2c1, SENSOR_ADDRESS, sensor_buffer, 1U);
+      break;
+    default:
+      err = HAL_I2C_Master_Receive_IT(&hi2c1, SENSOR_ADDRESS, &sensor_buffer[1], 1U);
+      break;
+  }
+  if (err != HAL_OK) {
+    Sensor_Finish(err);
+  }
+}
+
+/**
+  * @brief  Close the batch
+  * @param  status: outcome
+  * @retval None
+  */
+static void Sensor_Finish(HAL_StatusTypeDef status)
+{
+  sensor_status = status;
+  sensor_busy = 0U;
+}
@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_tables.cpp
+  * @brief          : OV7670 register tables
+  *
+  *                   The mode table of the build (SENSOR_MODE and
+  *                   SENSOR_FORMAT) and the
+  *                   exposure presets are generated at compile time from
+  *                   sensor_tables.hpp; sensor.c streams them to the sensor.
+  *                   Window tables for the ROI are computed at run time by
+  *                   the same functions, switching between the build mode
+  *                   and the search mode as the window scale asks.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sensor_regs.h"
+#include "sensor_tables.hpp"
+
+/* Private variables ---------------------------------------------------------*/
+#if SENSOR_MODE == SENSOR_MODE_QVGA
+static constexpr sensor_tables::Mode sensor_mode = sensor_tables::Qvga;
+#elif SENSOR_MODE == SENSOR_MODE_QQVGA
+static constexpr sensor_tables::Mode sensor_mode = sensor_tables::Qqvga;
+#else
+#error "Unknown SENSOR_MODE"
+#endif
+
+#if SENSOR_FORMAT == SENSOR_FORMAT_LUMA
+static constexpr sensor_tables::Pixel sensor_pixel = sensor_tables::Luma;
+#elif SENSOR_FORMAT == SENSOR_FORMAT_YUV422
+static constexpr sensor_tables::Pixel sensor_pixel = sensor_tables::Yuv422;
+#elif SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+static constexpr sensor_tables::Pixel sensor_pixel = sensor_tables::Rgb565;
+#else
+#error "Unknown SENSOR_FORMAT"
+#endif
+
+static_assert(sensor_mode.Width == SENSOR_WIDTH && sensor_mode.Height == SENSOR_HEIGHT);
+static_assert(sensor_tables::Qqqvga.Scale == SENSOR_SEARCH_SCALE * sensor_mode.Scale);
+
+static constexpr auto sensor_format = sensor_tables::Format(sensor_mode, sensor_pixel);
+static constexpr auto sensor_auto = sensor_tables::AutoExposure();
+/* Indoor scene, half a frame of exposure */
+static constexpr auto sensor_indoor = sensor_tables::ManualExposure(240U, 0x10U);
+/* Laser dot over a dark background: shortest exposure, unity gain */
+static constexpr auto sensor_dot = sensor_tables::ManualExposure(2U, 0x00U);
+
+/* Exported variables --------------------------------------------------------*/
+extern "C" const Sensor_TableTypeDef sensor_mode_table = {
+  sensor_format.data(), sensor_format.size()
+};
+
+extern "C" const Sensor_TableTypeDef sensor_exposure_tables[SENSOR_EXPOSURE_COUNT] = {
+  { sensor_auto.data(), sensor_auto.size() },
+  { sensor_indoor.data(), sensor_indoor.size() },
+  { sensor_dot.data(), sensor_dot.size() },
+};
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Registers programming a readout window and its scaling
+  * @param  window: window in output pixels, inside SENSOR_WIDTH x SENSOR_HEIGHT,
+  *         at scale 1 or SENSOR_SEARCH_SCALE
+  * @param  regs: destination, SENSOR_WINDOW_REGS entries
+  * @retval None
+  */
+void Sensor_WindowRegs(const Sensor_WindowTypeDef *window, Sensor_RegTypeDef *regs)
+{
+  const auto table = sensor_tables::Concat(
+      sensor_tables::Scaling(window->Scale == 1U ? sensor_mode : sensor_tables::Qqqvga),
+      sensor_tables::Window(sensor_mode, *window));
+
+  static_assert(table.size() == SENSOR_WINDOW_REGS);
+  for (const Sensor_RegTypeDef &r : table) {
+    *regs++ = r;
+  }
+}
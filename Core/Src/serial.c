@@ -0,0 +1,286 @@
+/**
+  ******************************************************************************
+  * @file           : serial.c
+  * @brief          : Non-blocking serial output on USART2
+  *
+  *                   Writers copy into a ring buffer and return; DMA1 channel 7
+  *                   drains the ring to the USART2 data register one
+  *                   contiguous chunk at a time, and its transfer-complete
+  *                   interrupt releases the chunk and starts the next one.
+  *
+  *                   The ring is single-producer: the head is only moved from
+  *                   thread mode and the tail only from the DMA interrupt, so
+  *                   neither side takes a lock. A write that does not fit is
+  *                   dropped whole and counted, the tracking loop never waits
+  *                   for the line.
+  *
+  *                   At 460800 baud the 8 MHz PCLK1 of the low-power profile
+  *                   gives a by-16 divider of 17, 2.1 % fast; the USART then
+  *                   oversamples by 8 (divider 35, 0.8 % slow). The 36 MHz
+  *                   performance profile keeps oversampling by 16 (0.2 %).
+  *
+  *                   _write is routed here, so printf goes out the virtual
+  *                   COM port. stdout is unbuffered to keep newlib from
+  *                   allocating a stream buffer on the heap.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "serial.h"
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+#define SERIAL_RING_MASK        (SERIAL_RING_SIZE - 1U)
+/* Smallest by-16 divider rounding the rate within 1.6 %; below it the
+   USART oversamples by 8 for twice the resolution */
+#define SERIAL_OVER16_MIN_DIV   32U
+
+/* Private variables ---------------------------------------------------------*/
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+static uint8_t serial_ring[SERIAL_RING_SIZE];
+static volatile uint32_t serial_head;
+static volatile uint32_t serial_tail;
+static volatile uint32_t serial_chunk;
+static volatile uint8_t serial_busy;
+static volatile uint32_t serial_dropped;
+
+/* Private function prototypes -----------------------------------------------*/
+static void Serial_Kick(void);
+static void Serial_DMA_Cplt(DMA_HandleTypeDef *hdma);
+static void Serial_DMA_Error(DMA_HandleTypeDef *hdma);
+static void Serial_ClockChanged(void);
+static uint32_t Serial_GetOverSampling(uint32_t pclk);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Configure USART2 for transmission through DMA1 channel 7
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Serial_Init(void)
+{
+  HAL_StatusTypeDef err;
+
+  huart2.Instance = USART2;
+  huart2.Init.BaudRate = SERIAL_BAUDRATE;
+  huart2.Init.WordLength = UART_WORDLENGTH_8B;
+  huart2.Init.StopBits = UART_STOPBITS_1;
+  huart2.Init.Parity = UART_PARITY_NONE;
+  huart2.Init.Mode = UART_MODE_TX_RX;
+  huart2.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart2.Init.OverSampling = Serial_GetOverSampling(HAL_RCC_GetPCLK1Freq());
+  huart2.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart2.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  err = HAL_UART_Init(&huart2);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_usart2_tx.Instance = DMA1_Channel7;
+  hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+  hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+  err = HAL_DMA_Init(&hdma_usart2_tx);
+  if (err != HAL_OK) {
+    return err;
+  }
+  hdma_usart2_tx.XferCpltCallback = Serial_DMA_Cplt;
+  hdma_usart2_tx.XferErrorCallback = Serial_DMA_Error;
+
+  /* DMA interrupt init, below the capture path */
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+
+  /* TXE requests feed the DMA for as long as the USART is enabled */
+  SET_BIT(huart2.Instance->CR3, USART_CR3_DMAT);
+
+  serial_head = 0U;
+  serial_tail = 0U;
+  serial_busy = 0U;
+  serial_dropped = 0U;
+  setvbuf(stdout, NULL, _IONBF, 0);
+
+  return Clock_RegisterCallback(Serial_ClockChanged);
+}
+
+/**
+  * @brief  Queue bytes for transmission without blocking
+  * @note   Thread mode only: the ring has a single producer.
+  * @param  data: bytes to send
+  * @param  len: number of bytes
+  * @retval len if queued, 0 if the ring was too full and the bytes dropped
+  */
+uint32_t Serial_Write(const void *data, uint32_t len)
+{
+  uint32_t head = serial_head;
+  uint32_t offset = head & SERIAL_RING_MASK;
+  uint32_t first;
+
+  if (len > SERIAL_RING_SIZE - (head - serial_tail)) {
+    serial_dropped += len;
+    return 0U;
+  }
+
+  first = SERIAL_RING_SIZE - offset;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(&serial_ring[offset], data, first);
+  memcpy(serial_ring, (const uint8_t *)data + first, len - first);
+
+  /* Publish the bytes before the new head */
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  serial_head = head + len;
+
+  /* The DMA interrupt only runs while busy, so an idle check cannot race */
+  if (!serial_busy) {
+    Serial_Kick();
+  }
+  return len;
+}
+
+/**
+  * @brief  Wait until every queued byte has been handed to the USART
+  * @note   Also works with interrupts masked, e.g. from Error_Handler, by
+  *         servicing the DMA by hand.
+  * @retval None
+  */
+void Serial_Flush(void)
+{
+  while (serial_busy) {
+    if (__get_PRIMASK() != 0U) {
+      HAL_DMA_IRQHandler(&hdma_usart2_tx);
+    }
+  }
+}
+
+/**
+  * @brief  Number of bytes dropped because the ring was full
+  * @retval Dropped byte count since Serial_Init
+  */
+uint32_t Serial_GetDropped(void)
+{
+  return serial_dropped;
+}
+
+/**
+  * @brief  Start the DMA on the next contiguous run of queued bytes
+  * @note   Called from thread mode while idle or from the DMA interrupt.
+  * @retval None
+  */
+static void Serial_Kick(void)
+{
+  uint32_t tail = serial_tail;
+  uint32_t offset = tail & SERIAL_RING_MASK;
+  uint32_t chunk = serial_head - tail;
+
+  if (chunk == 0U) {
+    serial_busy = 0U;
+    return;
+  }
+  if (chunk > SERIAL_RING_SIZE - offset) {
+    chunk = SERIAL_RING_SIZE - offset;
+  }
+
+  serial_busy = 1U;
+  serial_chunk = chunk;
+  if (HAL_DMA_Start_IT(&hdma_usart2_tx, (uint32_t)&serial_ring[offset],
+                       (uint32_t)&huart2.Instance->TDR, chunk) != HAL_OK) {
+    Serial_DMA_Error(&hdma_usart2_tx);
+  }
+}
+
+/**
+  * @brief  DMA transfer complete: release the chunk and send the next one
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+static void Serial_DMA_Cplt(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+
+  serial_tail += serial_chunk;
+  Serial_Kick();
+}
+
+/**
+  * @brief  DMA transfer error: drop what is queued rather than stall forever
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+static void Serial_DMA_Error(DMA_HandleTypeDef *hdma)
+{
+  UNUSED(hdma);
+
+  serial_dropped += serial_head - serial_tail;
+  serial_tail = serial_head;
+  serial_busy = 0U;
+}
+
+/**
+  * @brief  Recompute the oversampling and baud rate divider after a clock
+  *         profile switch
+  * @note   OVER8 may only change with the USART disabled.
+  * @retval None
+  */
+static void Serial_ClockChanged(void)
+{
+  uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+  uint32_t div;
+
+  huart2.Init.OverSampling = Serial_GetOverSampling(pclk);
+
+  __HAL_UART_DISABLE(&huart2);
+  if (huart2.Init.OverSampling == UART_OVERSAMPLING_8) {
+    /* BRR[2:0] holds USARTDIV[3:0] shifted right, BRR[3] stays clear */
+    div = UART_DIV_SAMPLING8(pclk, SERIAL_BAUDRATE);
+    SET_BIT(huart2.Instance->CR1, USART_CR1_OVER8);
+    huart2.Instance->BRR = (uint16_t)((div & 0xFFF0U) | ((div & 0x000FU) >> 1U));
+  } else {
+    CLEAR_BIT(huart2.Instance->CR1, USART_CR1_OVER8);
+    huart2.Instance->BRR = (uint16_t)UART_DIV_SAMPLING16(pclk, SERIAL_BAUDRATE);
+  }
+  __HAL_UART_ENABLE(&huart2);
+}
+
+/**
+  * @brief  Choose the oversampling that keeps the line rate closest to
+  *         SERIAL_BAUDRATE
+  * @param  pclk: USART2 kernel clock in Hz
+  * @retval UART_OVERSAMPLING_8 or UART_OVERSAMPLING_16
+  */
+static uint32_t Serial_GetOverSampling(uint32_t pclk)
+{
+  if (UART_DIV_SAMPLING16(pclk, SERIAL_BAUDRATE) < SERIAL_OVER16_MIN_DIV) {
+    return UART_OVERSAMPLING_8;
+  }
+  return UART_OVERSAMPLING_16;
+}
+
+/**
+  * @brief  newlib write hook, overriding the weak one in syscalls.c
+  * @param  file: file descriptor, ignored
+  * @param  ptr: bytes to write
+  * @param  len: number of bytes
+  * @retval len, dropped bytes are accounted in Serial_GetDropped
+  */
+int _write(int file, char *ptr, int len)
+{
+  UNUSED(file);
+
+  if (len > 0) {
+    Serial_Write(ptr, (uint32_t)len);
+  }
+  return len;
+}
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+  * @file           : servo.c
+  * @brief          : Pan/tilt servo PWM
+  *
+  *                   TIM8 counts microseconds whatever the clock profile, so
+  *                   compare values are pulse widths in microseconds: 1 us
+  *                   positioning steps, about 0.09 degree on a 180 degree /
+  *                   2000 us servo. Pan is on CH3 (PC8), tilt on CH4 (PC9).
+  *
+  *                   Commands are never written to the timer by the CPU. At
+  *                   every update event TIM8 raises a DMA burst through DMAR
+  *                   (DCR: base CCR3, two transfers) and DMA2 channel 1, in
+  *                   circular mode with no interrupt, copies the two pulse
+  *                   widths of servo_command into CCR3 and CCR4. The compare
+  *                   preload then applies them at the following update, so a
+  *                   pulse is never cut short and a command always takes
+  *                   effect at a period boundary, at most two periods after
+  *                   Servo_SetPulses.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "servo.h"
+#include "clock.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Counter clock, one tick per microsecond */
+#define SERVO_TICK_HZ           1000000U
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim8;
+DMA_HandleTypeDef hdma_tim8_up;
+
+/* Pan in the low half-word, tilt in the high one: one store updates both */
+static volatile uint32_t servo_command;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint16_t Servo_Clamp(uint16_t us);
+static void Servo_ClockChanged(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Configure TIM8 channels 3 and 4 for servo PWM and DMA2 channel 1
+  *         for the compare refresh; both servos start centered
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Servo_Init(void)
+{
+  HAL_StatusTypeDef err;
+  TIM_OC_InitTypeDef sConfigOC = {0};
+
+  servo_command = SERVO_PULSE_CENTER_US | (uint32_t)SERVO_PULSE_CENTER_US << 16;
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  hdma_tim8_up.Instance = DMA2_Channel1;
+  hdma_tim8_up.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_tim8_up.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_tim8_up.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_tim8_up.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_tim8_up.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_tim8_up.Init.Mode = DMA_CIRCULAR;
+  hdma_tim8_up.Init.Priority = DMA_PRIORITY_LOW;
+  err = HAL_DMA_Init(&hdma_tim8_up);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  htim8.Instance = TIM8;
+  htim8.Init.Prescaler = Clock_GetApb2TimerFreq() / SERVO_TICK_HZ - 1U;
+  htim8.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim8.Init.Period = SERVO_PERIOD_US - 1U;
+  htim8.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim8.Init.RepetitionCounter = 0U;
+  htim8.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  err = HAL_TIM_PWM_Init(&htim8);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  sConfigOC.OCMode = TIM_OCMODE_PWM1;
+  sConfigOC.Pulse = SERVO_PULSE_CENTER_US;
+  sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+  sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+  sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+  sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+  sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+  err = HAL_TIM_PWM_ConfigChannel(&htim8, &sConfigOC, TIM_CHANNEL_3);
+  if (err != HAL_OK) {
+    return err;
+  }
+  err = HAL_TIM_PWM_ConfigChannel(&htim8, &sConfigOC, TIM_CHANNEL_4);
+  if (err != HAL_OK) {
+    return err;
+  }
+
+  return Clock_RegisterCallback(Servo_ClockChanged);
+}
+
+/**
+  * @brief  Start the compare refresh DMA and both PWM outputs
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Servo_Start(void)
+{
+  HAL_StatusTypeDef err;
+
+  err = HAL_DMA_Start(&hdma_tim8_up, (uint32_t)&servo_command,
+                      (uint32_t)&htim8.Instance->DMAR, SERVO_COUNT);
+  if (err != HAL_OK) {
+    return err;
+  }
+  htim8.Instance->DCR = TIM_DMABASE_CCR3 | TIM_DMABURSTLENGTH_2TRANSFERS;
+  __HAL_TIM_ENABLE_DMA(&htim8, TIM_DMA_UPDATE);
+
+  err = HAL_TIM_PWM_Start(&htim8, TIM_CHANNEL_3);
+  if (err != HAL_OK) {
+    return err;
+  }
+  return HAL_TIM_PWM_Start(&htim8, TIM_CHANNEL_4);
+}
+
+/**
+  * @brief  Stop both PWM outputs and the refresh DMA
+  * @note   Servos go limp: no pulse is a release, not a hold.
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Servo_Stop(void)
+{
+  HAL_StatusTypeDef err;
+
+  __HAL_TIM_DISABLE_DMA(&htim8, TIM_DMA_UPDATE);
+  err = HAL_TIM_PWM_Stop(&htim8, TIM_CHANNEL_3);
+  if (err != HAL_OK) {
+    return err;
+  }
+  err = HAL_TIM_PWM_Stop(&htim8, TIM_CHANNEL_4);
+  if (err != HAL_OK) {
+    return err;
+  }
+  return HAL_DMA_Abort(&hdma_tim8_up);
+}
+
+/**
+  * @brief  Command both servos
+  * @note   Callable from any interrupt level; values are clamped to
+  *         [SERVO_PULSE_MIN_US, SERVO_PULSE_MAX_US].
+  * @param  pan_us: pan pulse width, microseconds
+  * @param  tilt_us: tilt pulse width, microseconds
+  * @retval None
+  */
+void Servo_SetPulses(uint16_t pan_us, uint16_t tilt_us)
+{
+  servo_command = Servo_Clamp(pan_us) | (uint32_t)Servo_Clamp(tilt_us) << 16;
+}
+
+/**
+  * @brief  Last commanded pulse width of one servo
+  * @param  axis: servo
+  * @retval Pulse width, microseconds
+  */
+uint16_t Servo_GetPulse(Servo_AxisTypeDef axis)
+{
+  return (uint16_t)(servo_command >> (16U * axis));
+}
+
+/**
+  * @brief  Limit a pulse width to the servo range
+  * @param  us: pulse width, microseconds
+  * @retval Clamped pulse width
+  */
+static uint16_t Servo_Clamp(uint16_t us)
+{
+  if (us < SERVO_PULSE_MIN_US) {
+    return SERVO_PULSE_MIN_US;
+  }
+  if (us > SERVO_PULSE_MAX_US) {
+    return SERVO_PULSE_MAX_US;
+  }
+  return us;
+}
+
+/**
+  * @brief  Keep the counter at 1 MHz after a clock profile switch
+  * @note   The prescaler is preloaded: the current period finishes at the
+  *         old rate.
+  * @retval None
+  */
+static void Servo_ClockChanged(void)
+{
+  __HAL_TIM_SET_PRESCALER(&htim8, Clock_GetApb2TimerFreq() / SERVO_TICK_HZ - 1U);
+}
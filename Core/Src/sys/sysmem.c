@@ -23,12 +23,31 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include "main.h"
+#include "sysmem.h"
 
 /**
  * Pointer to the current high watermark of the heap usage
  */
 static uint8_t *__sbrk_heap_end = NULL;
 
+/**
+ * Set once initialization is over: the heap must not grow any more
+ */
+static uint8_t __sbrk_locked = 0;
+
+/**
+ * @brief Forbid any further heap growth
+ *
+ * Runtime buffers come from the fixed-block pools (pool.c). Past this
+ * call, a _sbrk means something allocates from the heap in the tracking
+ * loop, which is treated as a fatal error.
+ */
+void Sysmem_Lock(void)
+{
+  __sbrk_locked = 1;
+}
+
 /**
  * @brief _sbrk() allocates memory to the newlib heap and is used by malloc
  *        and others from the C library
@@ -59,6 +78,12 @@ void *_sbrk(ptrdiff_t incr)
   const uint8_t *max_heap = (uint8_t *)stack_limit;
   uint8_t *prev_heap_end;
 
+  /* No heap allocation after initialization */
+  if (__sbrk_locked)
+  {
+    Error_Handler(__func__, HAL_ERROR);
+  }
+
   /* Initialize heap end at first call */
   if (NULL == __sbrk_heap_end)
   {
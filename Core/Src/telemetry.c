@@ -0,0 +1,282 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.c
+  * @brief          : Binary blob telemetry
+  *
+  *                   Each labeled frame becomes one packet of at most 212
+  *                   bytes (see telemetry_protocol.h), against several hundred
+  *                   bytes and tens of thousands of cycles of printf text.
+  *                   The CRC-32 runs on the CRC unit (see crc.c). With
+  *                   RUN_DUMP_ENABLED each frame also sends the runs the
+  *                   detector kept, 8 bytes each: for a dot frame, the
+  *                   whole thresholded foreground in under 200 bytes.
+  *
+  *                   The packet and frame buffers come from POOL_PACKET for
+  *                   each packet and go back once the frame is in the
+  *                   serial ring; a packet that finds the pool empty is
+  *                   dropped. Every TELEMETRY_STATS_PERIOD frames a stats
+  *                   packet reports the occupancy of the pools and the
+  *                   bytes the serial ring had to drop.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry.h"
+#include "cobs.h"
+#include "crc.h"
+#include "pool.h"
+#include "profile.h"
+#include "serial.h"
+#include <string.h>
+
+/* Private define ------------------------------------------------------------*/
+_Static_assert(DETECT_MAX_FRAME_RUNS <= TELEMETRY_MAX_RUNS, "kept runs fit one packet");
+_Static_assert(TELEMETRY_MAX_RUNS * sizeof(Telemetry_RunTypeDef)
+               <= TELEMETRY_MAX_BLOBS * sizeof(Telemetry_BlobTypeDef),
+               "a run packet fits the packet buffers");
+_Static_assert(sizeof(Telemetry_StatsTypeDef)
+               <= TELEMETRY_MAX_BLOBS * sizeof(Telemetry_BlobTypeDef),
+               "a stats packet fits the packet buffers");
+_Static_assert(POOL_COUNT <= TELEMETRY_MAX_POOLS, "every pool fits a stats record");
+
+/* Private variables ---------------------------------------------------------*/
+#if PROFILE_ENABLED
+static Profile_StageTypeDef telemetry_profile_stage;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef Telemetry_Send(uint8_t *packet, uint32_t len);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Bring up the CRC unit used to protect packets
+  * @retval HAL status
+  */
+HAL_StatusTypeDef Telemetry_Init(void)
+{
+  Crc_Init();
+  return HAL_OK;
+}
+
+/**
+  * @brief  Encode the blobs of a frame and queue the packet for transmission
+  * @param  frame: labeled frame
+  * @param  window: window the frame was captured with
+  * @param  timestamp: DWT cycle count associated with the frame
+  * @retval HAL_BUSY if the serial ring was full or POOL_PACKET empty and
+  *         the packet dropped
+  */
+HAL_StatusTypeDef Telemetry_SendBlobs(const Label_FrameTypeDef *frame,
+                                      const Sensor_WindowTypeDef *window,
+                                      uint32_t timestamp)
+{
+  uint8_t *packet = Pool_Alloc(POOL_PACKET);
+  Telemetry_HeaderTypeDef *header = (Telemetry_HeaderTypeDef *)(void *)packet;
+  Telemetry_BlobTypeDef *records = (Telemetry_BlobTypeDef *)(void *)(header + 1);
+  uint32_t count = frame->Count < TELEMETRY_MAX_BLOBS ? frame->Count : TELEMETRY_MAX_BLOBS;
+  uint32_t total = 0U;
+
+  if (packet == NULL) {
+    return HAL_BUSY;
+  }
+  for (uint32_t i = 0U; i < count; i++) {
+    total += frame->Blobs[i].Weight;
+  }
+
+  header->Version = TELEMETRY_VERSION;
+  header->Type = TELEMETRY_TYPE_BLOBS;
+  header->Count = (uint8_t)count;
+  header->Flags = frame->Dropped != 0U ? TELEMETRY_FLAG_TRUNCATED : 0U;
+  header->Frame = frame->Frame;
+  header->Timestamp = timestamp;
+  header->OriginX = window->X;
+  header->OriginY = window->Y;
+
+  for (uint32_t i = 0U; i < count; i++) {
+    const Label_BlobTypeDef *blob = &frame->Blobs[i];
+
+    records[i].X = blob->X;
+    records[i].Y = blob->Y;
+    records[i].Area = blob->Area > 0xFFFFU ? 0xFFFFU : (uint16_t)blob->Area;
+    records[i].Confidence = (uint8_t)(((uint64_t)blob->Weight * 255U) / total);
+    records[i].Flags = blob->Refined ? TELEMETRY_BLOB_REFINED : 0U;
+  }
+
+  return Telemetry_Send(packet, sizeof(*header) + count * sizeof(*records));
+}
+
+/**
+  * @brief  Encode the runs kept from a frame and queue the packet for
+  *         transmission
+  * @param  runs: runs of the frame
+  * @param  window: window the frame was captured with
+  * @param  timestamp: DWT cycle count associated with the frame
+  * @retval HAL_BUSY if the serial ring was full or POOL_PACKET empty and
+  *         the packet dropped
+  */
+HAL_StatusTypeDef Telemetry_SendRuns(const Detect_RunsTypeDef *runs,
+                                     const Sensor_WindowTypeDef *window,
+                                     uint32_t timestamp)
+{
+#if RUN_DUMP_ENABLED
+  uint8_t *packet = Pool_Alloc(POOL_PACKET);
+  Telemetry_HeaderTypeDef *header = (Telemetry_HeaderTypeDef *)(void *)packet;
+  Telemetry_RunTypeDef *records = (Telemetry_RunTypeDef *)(void *)(header + 1);
+  uint32_t count = runs->Count < TELEMETRY_MAX_RUNS ? runs->Count : TELEMETRY_MAX_RUNS;
+
+  if (packet == NULL) {
+    return HAL_BUSY;
+  }
+  header->Version = TELEMETRY_VERSION;
+  header->Type = TELEMETRY_TYPE_RUNS;
+  header->Count = (uint8_t)count;
+  header->Flags = (uint8_t)((31U - __CLZ(window->Scale)) << TELEMETRY_FLAG_SCALE_Pos)
+                  | (runs->Dropped != 0U ? TELEMETRY_FLAG_TRUNCATED : 0U);
+  header->Frame = runs->Frame;
+  header->Timestamp = timestamp;
+  header->OriginX = window->X;
+  header->OriginY = window->Y;
+
+  for (uint32_t i = 0U; i < count; i++) {
+    const Detect_RunTypeDef *run = &runs->Runs[i];
+
+    records[i].Y = run->Y;
+    records[i].Start = run->Start;
+    records[i].Length = run->Length;
+    records[i].Sum = run->Sum > 0xFFFFU ? 0xFFFFU : (uint16_t)run->Sum;
+  }
+
+  return Telemetry_Send(packet, sizeof(*header) + count * sizeof(*records));
+#else
+  UNUSED(runs);
+  UNUSED(window);
+  UNUSED(timestamp);
+  return HAL_OK;
+#endif
+}
+
+/**
+  * @brief  Report the profile of the next pipeline stage, cycling through
+  *         all of them on successive calls
+  * @param  frame: current frame sequence number
+  * @param  timestamp: DWT cycle count
+  * @retval HAL_BUSY if the serial ring was full or POOL_PACKET empty and
+  *         the packet dropped
+  */
+HAL_StatusTypeDef Telemetry_SendProfile(uint32_t frame, uint32_t timestamp)
+{
+#if PROFILE_ENABLED
+  uint8_t *packet = Pool_Alloc(POOL_PACKET);
+  Telemetry_HeaderTypeDef *header = (Telemetry_HeaderTypeDef *)(void *)packet;
+  Telemetry_ProfileTypeDef *record = (Telemetry_ProfileTypeDef *)(void *)(header + 1);
+  Profile_StatsTypeDef stats;
+
+  if (packet == NULL) {
+    return HAL_BUSY;
+  }
+  Profile_GetStats(telemetry_profile_stage, &stats);
+
+  memset(header, 0, sizeof(*header));
+  header->Version = TELEMETRY_VERSION;
+  header->Type = TELEMETRY_TYPE_PROFILE;
+  header->Count = 1U;
+  header->Frame = frame;
+  header->Timestamp = timestamp;
+
+  memset(record, 0, sizeof(*record));
+  record->Stage = (uint8_t)telemetry_profile_stage;
+  record->Count = stats.Count;
+  record->Min = stats.Min;
+  record->Max = stats.Max;
+  record->Mean = stats.Mean;
+  for (uint32_t i = 0U; i < PROFILE_BINS; i++) {
+    record->Histogram[i] = stats.Histogram[i] > 0xFFFFU ? 0xFFFFU : (uint16_t)stats.Histogram[i];
+  }
+
+  if (++telemetry_profile_stage == PROFILE_STAGE_COUNT) {
+    telemetry_profile_stage = PROFILE_STAGE_CAPTURE_WAIT;
+  }
+  return Telemetry_Send(packet, sizeof(*header) + sizeof(*record));
+#else
+  UNUSED(frame);
+  UNUSED(timestamp);
+  return HAL_OK;
+#endif
+}
+
+/**
+  * @brief  Report the occupancy of the memory pools and the bytes dropped by
+  *         the serial ring
+  * @param  frame: current frame sequence number
+  * @param  timestamp: DWT cycle count
+  * @retval HAL_BUSY if the serial ring was full or POOL_PACKET empty and
+  *         the packet dropped
+  */
+HAL_StatusTypeDef Telemetry_SendStats(uint32_t frame, uint32_t timestamp)
+{
+  Pool_StatsTypeDef pools[POOL_COUNT];
+  Telemetry_HeaderTypeDef *header;
+  Telemetry_StatsTypeDef *record;
+  uint8_t *packet;
+
+  /* Taken before this packet holds blocks of its own */
+  for (uint32_t i = 0U; i < POOL_COUNT; i++) {
+    Pool_GetStats((Pool_IdTypeDef)i, &pools[i]);
+  }
+  packet = Pool_Alloc(POOL_PACKET);
+  if (packet == NULL) {
+    return HAL_BUSY;
+  }
+  header = (Telemetry_HeaderTypeDef *)(void *)packet;
+  record = (Telemetry_StatsTypeDef *)(void *)(header + 1);
+
+  memset(header, 0, sizeof(*header));
+  header->Version = TELEMETRY_VERSION;
+  header->Type = TELEMETRY_TYPE_STATS;
+  header->Count = 1U;
+  header->Frame = frame;
+  header->Timestamp = timestamp;
+
+  memset(record, 0, sizeof(*record));
+  record->Pools = (uint8_t)POOL_COUNT;
+  record->SerialDropped = Serial_GetDropped();
+  for (uint32_t i = 0U; i < POOL_COUNT; i++) {
+    record->Pool[i].BlockSize = (uint16_t)pools[i].BlockSize;
+    record->Pool[i].Blocks = (uint8_t)pools[i].Blocks;
+    record->Pool[i].InUse = (uint8_t)pools[i].InUse;
+    record->Pool[i].HighWater = (uint8_t)pools[i].HighWater;
+    record->Pool[i].Failures = pools[i].Failures;
+  }
+
+  return Telemetry_Send(packet, sizeof(*header) + sizeof(*record));
+}
+
+/**
+  * @brief  Append the CRC to a packet, frame it, queue it and give back its
+  *         buffers
+  * @param  packet: packet from POOL_PACKET, freed on return
+  * @param  len: packet length, CRC excluded
+  * @retval HAL_BUSY if the serial ring was full or POOL_PACKET empty and
+  *         the packet dropped
+  */
+static HAL_StatusTypeDef Telemetry_Send(uint8_t *packet, uint32_t len)
+{
+  uint8_t *frame = Pool_Alloc(POOL_PACKET);
+  HAL_StatusTypeDef err = HAL_BUSY;
+  uint32_t crc;
+
+  if (frame != NULL) {
+    crc = Crc_Compute(packet, len);
+    memcpy(&packet[len], &crc, sizeof(crc));
+    len += sizeof(crc);
+
+    len = Cobs_Encode(packet, len, frame);
+    frame[len++] = 0U;
+    err = Serial_Write(frame, len) == len ? HAL_OK : HAL_BUSY;
+  }
+
+  (void)Pool_Free(POOL_PACKET, frame);
+  (void)Pool_Free(POOL_PACKET, packet);
+  return err;
+}
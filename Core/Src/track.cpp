@@ -0,0 +1,282 @@
+/**
+  ******************************************************************************
+  * @file           : track.cpp
+  * @brief          : Multi-dot tracking
+  *
+  *                   Up to TRACK_MAX_DOTS dots are followed in sensor pixel
+  *                   coordinates, each by one filter per axis. Measurements
+  *                   are timed by the DWT timestamp of the VSYNC edge that
+  *                   opened their frame, so the filters see the true frame
+  *                   period, whatever the thread-mode processing delay.
+  *
+  *                   Each frame, tracks are predicted to the frame time and
+  *                   blobs, heaviest first, go to the nearest free track
+  *                   within TRACK_GATE or else start a new one. The longest-
+  *                   lived track is the primary dot. Its state is written
+  *                   to the idle one of two snapshots, then published by
+  *                   flipping an index: an interrupt preempting the update
+  *                   still reads the previous, complete snapshot, so
+  *                   Track_Predict can be called from any interrupt level to
+  *                   extrapolate it to the next readout or to an actuator
+  *                   deadline, without waiting on thread mode.
+  *
+  *                   The filter is a compile-time policy (track_filter.hpp)
+  *                   chosen with TRACK_FILTER.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "track.h"
+#include "system_stm32f3xx.h"
+#include "track_filter.hpp"
+
+/* Private define ------------------------------------------------------------*/
+/* track_current when no dot is tracked */
+#define TRACK_NONE              2U
+
+/* Private typedef -----------------------------------------------------------*/
+#if TRACK_FILTER == TRACK_FILTER_KALMAN_CV
+using Track_Filter = KalmanFilter<2U, 1.0e4f, 0.25f>;
+#elif TRACK_FILTER == TRACK_FILTER_KALMAN_CA
+using Track_Filter = KalmanFilter<3U, 1.0e6f, 0.25f>;
+#elif TRACK_FILTER == TRACK_FILTER_ALPHA_BETA
+using Track_Filter = AlphaBetaFilter<0.6f, 0.2f>;
+#else
+#error "Unknown TRACK_FILTER"
+#endif
+
+static_assert(TrackFilter<Track_Filter>);
+
+namespace {
+
+/**
+  * @brief Motion state of the primary dot at a given time
+  */
+struct Track_SnapshotTypeDef
+{
+  uint32_t Time;
+  float X;
+  float Y;
+  float VX;
+  float VY;
+  float AX;
+  float AY;
+  uint16_t Hits;
+};
+
+/**
+  * @brief Tracks of up to Size dots, filtered by Filter along each axis
+  */
+template <TrackFilter Filter, uint32_t Size>
+class Tracker
+{
+public:
+  void Reset()
+  {
+    for (Track &track : tracks) {
+      track.Active = false;
+    }
+  }
+
+  void Update(const Label_FrameTypeDef &frame, float origin_x, float origin_y, uint32_t time)
+  {
+    bool assigned[Size] = {};
+
+    for (Track &track : tracks) {
+      if (track.Active) {
+        const float dt = Seconds(time - track.Time);
+
+        track.X.Predict(dt);
+        track.Y.Predict(dt);
+        track.Time = time;
+      }
+    }
+
+    for (uint32_t i = 0U; i < frame.Count; i++) {
+      const Label_BlobTypeDef &blob = frame.Blobs[i];
+      const float x = origin_x + static_cast<float>(blob.X) / 65536.0f;
+      const float y = origin_y + static_cast<float>(blob.Y) / 65536.0f;
+      uint32_t best = Size;
+      float best_d2 = TRACK_GATE * TRACK_GATE;
+
+      if (blob.Weight < TRACK_MIN_WEIGHT) {
+        break;
+      }
+      for (uint32_t k = 0U; k < Size; k++) {
+        const Track &track = tracks[k];
+
+        if (track.Active && !assigned[k]) {
+          const float dx = x - track.X.Position();
+          const float dy = y - track.Y.Position();
+          const float d2 = dx * dx + dy * dy;
+
+          if (d2 < best_d2) {
+            best = k;
+            best_d2 = d2;
+          }
+        }
+      }
+      if (best == Size) {
+        best = Spawn(assigned);
+        if (best == Size) {
+          continue;
+        }
+        tracks[best].X.Reset(x);
+        tracks[best].Y.Reset(y);
+        tracks[best].Time = time;
+      } else {
+        tracks[best].X.Correct(x);
+        tracks[best].Y.Correct(y);
+      }
+      assigned[best] = true;
+      tracks[best].Misses = 0U;
+      if (tracks[best].Hits < UINT16_MAX) {
+        tracks[best].Hits++;
+      }
+    }
+
+    for (uint32_t k = 0U; k < Size; k++) {
+      if (tracks[k].Active && !assigned[k] && ++tracks[k].Misses >= TRACK_LOST_FRAMES) {
+        tracks[k].Active = false;
+      }
+    }
+  }
+
+  bool Primary(Track_SnapshotTypeDef &snapshot) const
+  {
+    const Track *primary = nullptr;
+
+    for (const Track &track : tracks) {
+      if (track.Active && (primary == nullptr || track.Hits > primary->Hits)) {
+        primary = &track;
+      }
+    }
+    if (primary == nullptr) {
+      return false;
+    }
+    snapshot.Time = primary->Time;
+    snapshot.X = primary->X.Position();
+    snapshot.Y = primary->Y.Position();
+    snapshot.VX = primary->X.Velocity();
+    snapshot.VY = primary->Y.Velocity();
+    snapshot.AX = primary->X.Acceleration();
+    snapshot.AY = primary->Y.Acceleration();
+    snapshot.Hits = primary->Hits;
+    return true;
+  }
+
+  static float Seconds(uint32_t cycles)
+  {
+    return static_cast<float>(static_cast<int32_t>(cycles)) / static_cast<float>(SystemCoreClock);
+  }
+
+private:
+  struct Track
+  {
+    Filter X;
+    Filter Y;
+    uint32_t Time = 0U;     /*!< DWT time of the filter state */
+    uint16_t Hits = 0U;
+    uint8_t Misses = 0U;
+    bool Active = false;
+  };
+
+  /* Free slot for a new track; when full, the track missed for the most
+   * frames gives way */
+  uint32_t Spawn(const bool (&assigned)[Size])
+  {
+    uint32_t slot = Size;
+
+    for (uint32_t k = 0U; k < Size && slot == Size; k++) {
+      if (!tracks[k].Active) {
+        slot = k;
+      }
+    }
+    if (slot == Size) {
+      /* Every unassigned missed track is compared, not just the first */
+      for (uint32_t k = 0U; k < Size; k++) {
+        if (!assigned[k] && tracks[k].Misses > 0U
+            && (slot == Size || tracks[k].Misses > tracks[slot].Misses)) {
+          slot = k;
+        }
+      }
+    }
+    if (slot != Size) {
+      tracks[slot].Active = true;
+      tracks[slot].Hits = 0U;
+      tracks[slot].Misses = 0U;
+    }
+    return slot;
+  }
+
+  Track tracks[Size];
+};
+
+}  // namespace
+
+/* Private variables ---------------------------------------------------------*/
+static Tracker<Track_Filter, TRACK_MAX_DOTS> track_tracker;
+
+/* Snapshots of the primary dot; track_current indexes the published one */
+static Track_SnapshotTypeDef track_primary[2];
+static volatile uint8_t track_current = TRACK_NONE;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Drop every track
+  * @retval None
+  */
+void Track_Init(void)
+{
+  track_tracker.Reset();
+  track_current = TRACK_NONE;
+}
+
+/**
+  * @brief  Feed the blobs of a frame and publish the primary dot
+  * @note   Thread mode only; interrupts may predict meanwhile.
+  * @param  frame: labeled frame, coordinates relative to its window
+  * @param  origin_x: window column on the sensor
+  * @param  origin_y: window row on the sensor
+  * @param  time: DWT timestamp of the frame VSYNC
+  * @retval None
+  */
+void Track_Update(const Label_FrameTypeDef *frame, uint16_t origin_x, uint16_t origin_y,
+                  uint32_t time)
+{
+  const uint8_t idle = track_current == 0U ? 1U : 0U;
+
+  track_tracker.Update(*frame, origin_x, origin_y, time);
+  if (track_tracker.Primary(track_primary[idle])) {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    track_current = idle;
+  } else {
+    track_current = TRACK_NONE;
+  }
+}
+
+/**
+  * @brief  Extrapolate the primary dot to a given time
+  * @param  time: DWT timestamp to predict at, e.g. the next VSYNC
+  * @param  prediction: destination
+  * @retval 1 if a dot is tracked, 0 otherwise
+  */
+uint8_t Track_Predict(uint32_t time, Track_PredictionTypeDef *prediction)
+{
+  const uint8_t current = track_current;
+
+  if (current == TRACK_NONE) {
+    return 0U;
+  }
+
+  const Track_SnapshotTypeDef &s = track_primary[current];
+  const float dt = Tracker<Track_Filter, TRACK_MAX_DOTS>::Seconds(time - s.Time);
+  prediction->X = s.X + (s.VX + 0.5f * s.AX * dt) * dt;
+  prediction->Y = s.Y + (s.VY + 0.5f * s.AY * dt) * dt;
+  prediction->VX = s.VX + s.AX * dt;
+  prediction->VY = s.VY + s.AY * dt;
+  prediction->Time = s.Time;
+  prediction->Hits = s.Hits;
+  return 1U;
+}
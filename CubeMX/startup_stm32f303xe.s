@@ -44,6 +44,13 @@ defined in linker script */
 .word	_sbss
 /* end address for the .bss section. defined in linker script */
 .word	_ebss
+/* load address, start and end of the .ccmram section. defined in linker script */
+.word	_siccmram
+.word	_sccmram
+.word	_eccmram
+/* start and end address for the .ccmbss section. defined in linker script */
+.word	_sccmbss
+.word	_eccmbss
 
 .equ  BootRAM,        0xF1E0F85F
 /**
@@ -81,6 +88,37 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
   
+/* Copy the CCM code and data initializers from flash to CCM SRAM */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  movs r3, #0
+  b LoopCopyCcmInit
+
+CopyCcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmInit
+
+/* Zero fill the CCM bss segment. */
+  ldr r2, =_sccmbss
+  ldr r4, =_eccmbss
+  movs r3, #0
+  b LoopFillZeroCcmbss
+
+FillZeroCcmbss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroCcmbss:
+  cmp r2, r4
+  bcc FillZeroCcmbss
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -0,0 +1,420 @@
+/**
+  ******************************************************************************
+  * @file           : bench_kernels.c
+  * @brief          : Pixel kernel check and benchmark
+  *
+  *                   Runs the optimized kernels against their reference
+  *                   implementation on random lines and stops at the first
+  *                   mismatch, then reports the time per line of each.
+  *                   Hot pixel masking is checked against runs trimmed and
+  *                   summed again from the pixels.
+  *                   On the host the SIMD intrinsics are C models, so the
+  *                   timings compare algorithms, not Cortex-M4 cycles.
+  *
+  *                   With REFINE_ENABLED, synthetic spots at random
+  *                   subpixel positions are also located both by
+  *                   thresholded moments and by the Gaussian fit, and the
+  *                   error of each against the true center is reported per
+  *                   kind of spot and threshold, from small and dim spots
+  *                   to a saturated core, fitted on its flanks over a
+  *                   window widened to the blob.
+  *
+  *                   Usage: bench_kernels [lines]
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "kernel.h"
+#include "refine.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_LINE_BYTES        640U
+#define BENCH_LINES_DEFAULT     4096U
+#define BENCH_THRESHOLD         200U
+#define BENCH_MAX_RUNS          48U
+/* Masked columns per line: mostly run ends, some anywhere */
+#define BENCH_MASK_COLUMNS      8U
+
+/* Synthetic spots: patch side, background level and noise amplitude */
+#define BENCH_SPOT_SIDE         24U
+#define BENCH_SPOT_BACKGROUND   32.0
+#define BENCH_SPOT_NOISE        8U
+#define BENCH_SPOTS             4096U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef uint32_t (*Bench_RunsFn)(const uint8_t *line, uint32_t line_bytes,
+                                 uint32_t stride, uint8_t threshold,
+                                 Kernel_RunTypeDef *runs, uint32_t max_runs);
+typedef void (*Bench_RednessFn)(const uint8_t *line, uint32_t line_bytes, uint8_t *score);
+
+#if REFINE_ENABLED
+typedef struct
+{
+  const char *Name;
+  double Sigma;       /*!< Gaussian radius, pixels            */
+  double Peak;        /*!< Amplitude above the background     */
+  uint8_t Threshold;  /*!< Moments are taken above this level */
+} Bench_SpotTypeDef;
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+#if REFINE_ENABLED
+static const Bench_SpotTypeDef bench_spots[] = {
+  { "small",     1.0,  200.0,  64U },
+  { "small",     1.0,  200.0, 128U },
+  { "dim",       2.0,  120.0,  64U },
+  { "bright",    2.0,  200.0,  64U },
+  { "bright",    2.0,  200.0, 160U },
+  { "clipped",   2.0,  600.0,  64U },
+  { "clipped",   2.0,  600.0, 200U },
+  { "clipped",   3.0,  400.0, 200U },
+  { "saturated", 3.0, 1500.0,  64U },
+};
+#endif
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Monotonic time
+  * @retval Nanoseconds
+  */
+static double Bench_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+  * @brief  Fill lines with dark noise and a few bright spots, the load the
+  *         kernels see when tracking
+  * @param  lines: destination
+  * @param  count: number of lines
+  * @retval None
+  */
+static void Bench_Fill(uint8_t *lines, uint32_t count)
+{
+  for (uint32_t i = 0U; i < count * BENCH_LINE_BYTES; i++) {
+    lines[i] = (uint8_t)(rand() % 96);
+  }
+  for (uint32_t y = 0U; y < count; y++) {
+    uint32_t spots = (uint32_t)rand() % 4U;
+
+    for (uint32_t s = 0U; s < spots; s++) {
+      uint32_t x = (uint32_t)rand() % BENCH_LINE_BYTES;
+      uint32_t w = 1U + (uint32_t)rand() % 24U;
+
+      for (uint32_t i = x; i < x + w && i < BENCH_LINE_BYTES; i++) {
+        lines[y * BENCH_LINE_BYTES + i] = (uint8_t)(180 + rand() % 76);
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Mask random columns out of the runs of a line, favoring run
+  *         ends, and check the result against the runs trimmed of listed
+  *         end columns and summed again with listed samples weighing 0
+  * @param  line: samples
+  * @param  line_bytes: number of bytes in the line
+  * @param  stride: bytes between two samples
+  * @retval 1 if they agree
+  */
+static uint8_t Bench_CheckMask(const uint8_t *line, uint32_t line_bytes, uint32_t stride)
+{
+  const uint32_t samples = (line_bytes + stride - 1U) / stride;
+  Kernel_RunTypeDef runs[BENCH_MAX_RUNS];
+  Kernel_RunTypeDef ref[BENCH_MAX_RUNS];
+  uint8_t listed[BENCH_LINE_BYTES] = {0};
+  uint16_t columns[BENCH_LINE_BYTES];
+  uint32_t column_count = 0U;
+  uint32_t ref_count = 0U;
+  uint32_t found;
+  uint32_t count;
+  uint32_t kept;
+
+  found = Kernel_ThresholdRuns_Ref(line, line_bytes, stride, BENCH_THRESHOLD, runs, BENCH_MAX_RUNS);
+  count = found < BENCH_MAX_RUNS ? found : BENCH_MAX_RUNS;
+  for (uint32_t i = 0U; i < BENCH_MASK_COLUMNS; i++) {
+    uint32_t x = (uint32_t)rand() % samples;
+
+    if (count != 0U && rand() % 4 != 0) {
+      const Kernel_RunTypeDef *r = &runs[(uint32_t)rand() % count];
+
+      /* Either end, or next to the last sample */
+      x = rand() % 2 != 0 ? r->Start : r->Start + r->Length - 1U;
+      x -= x > r->Start ? (uint32_t)rand() % 2U : 0U;
+    }
+    listed[x] = 1U;
+  }
+  for (uint32_t x = 0U; x < samples; x++) {
+    if (listed[x]) {
+      columns[column_count++] = (uint16_t)x;
+    }
+  }
+
+  for (uint32_t k = 0U; k < count; k++) {
+    uint32_t s = runs[k].Start;
+    uint32_t e = runs[k].Start + runs[k].Length;
+    Kernel_RunTypeDef r = {0};
+
+    while (s < e && listed[s]) {
+      s++;
+    }
+    while (e > s && listed[e - 1U]) {
+      e--;
+    }
+    if (s == e) {
+      continue;
+    }
+    r.Start = (uint16_t)s;
+    r.Length = (uint16_t)(e - s);
+    for (uint32_t x = s; x < e; x++) {
+      uint32_t w = listed[x] ? 0U : (uint32_t)line[x * stride] - BENCH_THRESHOLD;
+
+      r.Sum += w;
+      r.SumX += w * (x - s);
+      r.SumXX += w * (x - s) * (x - s);
+    }
+    ref[ref_count++] = r;
+  }
+
+  kept = Kernel_MaskRuns(line, stride, BENCH_THRESHOLD, columns, column_count, runs, count);
+  return kept == ref_count && memcmp(runs, ref, kept * sizeof(runs[0])) == 0;
+}
+
+/**
+  * @brief  Time one kernel over all lines
+  * @retval Nanoseconds per line
+  */
+static double Bench_Run(Bench_RunsFn fn, const uint8_t *lines, uint32_t count,
+                        uint32_t stride, uint32_t *sink)
+{
+  Kernel_RunTypeDef runs[BENCH_MAX_RUNS];
+  double start = Bench_Now();
+
+  for (uint32_t y = 0U; y < count; y++) {
+    uint32_t n = fn(&lines[y * BENCH_LINE_BYTES], BENCH_LINE_BYTES, stride, BENCH_THRESHOLD,
+                    runs, BENCH_MAX_RUNS);
+    *sink += n != 0U ? runs[0].Sum ^ runs[n - 1U].SumXX : 0U;
+  }
+  return (Bench_Now() - start) / count;
+}
+
+/**
+  * @brief  Time one redness kernel over all lines, read as RGB565
+  * @retval Nanoseconds per line
+  */
+static double Bench_RunRedness(Bench_RednessFn fn, const uint8_t *lines, uint32_t count,
+                               uint32_t *sink)
+{
+  uint8_t score[BENCH_LINE_BYTES / 2U];
+  double start = Bench_Now();
+
+  for (uint32_t y = 0U; y < count; y++) {
+    fn(&lines[y * BENCH_LINE_BYTES], BENCH_LINE_BYTES, score);
+    *sink += score[y % sizeof(score)];
+  }
+  return (Bench_Now() - start) / count;
+}
+
+#if REFINE_ENABLED
+/**
+  * @brief  Render a spot over a noisy background, clipped to 8 bits
+  * @param  spot: spot kind
+  * @param  patch: BENCH_SPOT_SIDE squared samples
+  * @param  x0: true center column
+  * @param  y0: true center row
+  * @retval None
+  */
+static void Bench_RenderSpot(const Bench_SpotTypeDef *spot, uint8_t *patch, double x0, double y0)
+{
+  for (uint32_t y = 0U; y < BENCH_SPOT_SIDE; y++) {
+    for (uint32_t x = 0U; x < BENCH_SPOT_SIDE; x++) {
+      double d2 = (x - x0) * (x - x0) + (y - y0) * (y - y0);
+      double v = BENCH_SPOT_BACKGROUND + (double)(rand() % (2 * BENCH_SPOT_NOISE + 1))
+                 - BENCH_SPOT_NOISE + spot->Peak * exp(-d2 / (2.0 * spot->Sigma * spot->Sigma));
+
+      patch[y * BENCH_SPOT_SIDE + x] = (uint8_t)(v > 255.0 ? 255.0 : v);
+    }
+  }
+}
+
+/**
+  * @brief  Locate spots of one kind by moments and by the fit
+  * @param  spot: spot kind
+  * @retval None
+  */
+static void Bench_Spots(const Bench_SpotTypeDef *spot)
+{
+  uint8_t patch[BENCH_SPOT_SIDE * BENCH_SPOT_SIDE];
+  double moment_sum = 0.0;
+  double moment_max = 0.0;
+  double fit_sum = 0.0;
+  double fit_max = 0.0;
+  double elapsed = 0.0;
+  uint32_t fitted = 0U;
+
+  for (uint32_t i = 0U; i < BENCH_SPOTS; i++) {
+    double x0 = BENCH_SPOT_SIDE / 2.0 + (double)rand() / RAND_MAX - 0.5;
+    double y0 = BENCH_SPOT_SIDE / 2.0 + (double)rand() / RAND_MAX - 0.5;
+    double sum = 0.0;
+    double sum_x = 0.0;
+    double sum_y = 0.0;
+    double mx;
+    double my;
+    double error;
+    double start;
+    uint32_t x_min = BENCH_SPOT_SIDE;
+    uint32_t x_max = 0U;
+    uint32_t y_min = BENCH_SPOT_SIDE;
+    uint32_t y_max = 0U;
+    uint32_t radius;
+    int32_t cx;
+    int32_t cy;
+    int32_t dx;
+    int32_t dy;
+    uint8_t ok;
+
+    Bench_RenderSpot(spot, patch, x0, y0);
+    for (uint32_t y = 0U; y < BENCH_SPOT_SIDE; y++) {
+      for (uint32_t x = 0U; x < BENCH_SPOT_SIDE; x++) {
+        uint32_t v = patch[y * BENCH_SPOT_SIDE + x];
+
+        if (v > spot->Threshold) {
+          sum += v - spot->Threshold;
+          sum_x += (double)(v - spot->Threshold) * x;
+          sum_y += (double)(v - spot->Threshold) * y;
+          x_min = x < x_min ? x : x_min;
+          x_max = x > x_max ? x : x_max;
+          y_min = y < y_min ? y : y_min;
+          y_max = y > y_max ? y : y_max;
+        }
+      }
+    }
+    mx = sum_x / sum;
+    my = sum_y / sum;
+    error = hypot(mx - x0, my - y0);
+    moment_sum += error;
+    moment_max = error > moment_max ? error : moment_max;
+
+    /* The fit starts from the rounded moment centroid, over a window sized
+       from the bounding box, and keeps the moments when it fails, as in the
+       pipeline */
+    cx = (int32_t)(mx + 0.5);
+    cy = (int32_t)(my + 0.5);
+    radius = Refine_Radius(x_max - x_min > y_max - y_min ? x_max - x_min + 1U
+                                                         : y_max - y_min + 1U);
+    start = Bench_Now();
+    ok = Refine_Fit(&patch[cy * BENCH_SPOT_SIDE + cx], BENCH_SPOT_SIDE, radius, spot->Threshold,
+                    &dx, &dy);
+    elapsed += Bench_Now() - start;
+    if (ok) {
+      error = hypot(cx + dx / 65536.0 - x0, cy + dy / 65536.0 - y0);
+      fitted++;
+    }
+    fit_sum += error;
+    fit_max = error > fit_max ? error : fit_max;
+  }
+
+  printf("%-9s  sigma %.1f peak %4.0f threshold %3u: moments %.3f / %.3f px, fit %.3f / %.3f px"
+         " (mean / max), %u fitted, %.0f ns/fit\n",
+         spot->Name, spot->Sigma, spot->Peak, spot->Threshold, moment_sum / BENCH_SPOTS, moment_max,
+         fit_sum / BENCH_SPOTS, fit_max, fitted, elapsed / BENCH_SPOTS);
+}
+#endif /* REFINE_ENABLED */
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_LINES_DEFAULT;
+  uint8_t *lines = malloc((size_t)count * BENCH_LINE_BYTES);
+  uint32_t sink = 0U;
+
+  if (lines == NULL || count == 0U) {
+    fprintf(stderr, "usage: %s [lines]\n", argv[0]);
+    return 2;
+  }
+  srand(1);
+  Bench_Fill(lines, count);
+
+  for (uint32_t stride = 1U; stride <= 2U; stride++) {
+    for (uint32_t y = 0U; y < count; y++) {
+      /* Odd lengths and offsets exercise the unaligned head and scalar tail,
+         short tables the runs found past the last entry */
+      uint32_t offset = (uint32_t)rand() % 4U;
+      uint32_t len = BENCH_LINE_BYTES - offset - (uint32_t)rand() % 8U;
+      uint32_t max_runs = 1U + (uint32_t)rand() % BENCH_MAX_RUNS;
+      Kernel_RunTypeDef fast[BENCH_MAX_RUNS];
+      Kernel_RunTypeDef ref[BENCH_MAX_RUNS];
+      uint32_t n_fast;
+      uint32_t n_ref;
+
+      n_fast = Kernel_ThresholdRuns(&lines[y * BENCH_LINE_BYTES + offset], len, stride,
+                                    BENCH_THRESHOLD, fast, max_runs);
+      n_ref = Kernel_ThresholdRuns_Ref(&lines[y * BENCH_LINE_BYTES + offset], len, stride,
+                                       BENCH_THRESHOLD, ref, max_runs);
+      if (n_fast != n_ref
+          || memcmp(fast, ref, (n_ref < max_runs ? n_ref : max_runs) * sizeof(fast[0])) != 0) {
+        fprintf(stderr, "threshold runs mismatch: stride %u line %u\n", stride, y);
+        return 1;
+      }
+    }
+  }
+  printf("threshold runs: %u lines x 2 strides match the reference\n", count);
+
+  for (uint32_t stride = 1U; stride <= 2U; stride++) {
+    for (uint32_t y = 0U; y < count; y++) {
+      if (!Bench_CheckMask(&lines[y * BENCH_LINE_BYTES], BENCH_LINE_BYTES, stride)) {
+        fprintf(stderr, "masked runs mismatch: stride %u line %u\n", stride, y);
+        return 1;
+      }
+    }
+  }
+  printf("masked runs: %u lines x 2 strides match the reference\n", count);
+
+  for (uint32_t y = 0U; y < count; y++) {
+    /* Whole pixels only, with and without a pixel past the last word */
+    uint32_t offset = 2U * ((uint32_t)rand() % 2U);
+    uint32_t len = BENCH_LINE_BYTES - offset - 2U * ((uint32_t)rand() % 4U);
+    uint8_t fast_score[BENCH_LINE_BYTES / 2U];
+    uint8_t ref_score[BENCH_LINE_BYTES / 2U];
+
+    Kernel_RednessScores(&lines[y * BENCH_LINE_BYTES + offset], len, fast_score);
+    Kernel_RednessScores_Ref(&lines[y * BENCH_LINE_BYTES + offset], len, ref_score);
+    if (memcmp(fast_score, ref_score, len / 2U) != 0) {
+      fprintf(stderr, "redness scores mismatch: line %u\n", y);
+      return 1;
+    }
+  }
+  printf("redness scores: %u lines match the reference\n", count);
+
+  for (uint32_t stride = 1U; stride <= 2U; stride++) {
+    double ref = Bench_Run(Kernel_ThresholdRuns_Ref, lines, count, stride, &sink);
+    double fast = Bench_Run(Kernel_ThresholdRuns, lines, count, stride, &sink);
+
+    printf("stride %u: reference %8.1f ns/line, kernel %8.1f ns/line (x%.2f)\n",
+           stride, ref, fast, ref / fast);
+  }
+  {
+    double ref = Bench_RunRedness(Kernel_RednessScores_Ref, lines, count, &sink);
+    double fast = Bench_RunRedness(Kernel_RednessScores, lines, count, &sink);
+
+    printf("redness:  reference %8.1f ns/line, kernel %8.1f ns/line (x%.2f)\n",
+           ref, fast, ref / fast);
+  }
+
+#if REFINE_ENABLED
+  for (uint32_t i = 0U; i < sizeof(bench_spots) / sizeof(bench_spots[0]); i++) {
+    Bench_Spots(&bench_spots[i]);
+  }
+#endif
+
+  free(lines);
+  return sink == 0xFFFFFFFFU;
+}
@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+  * @file           : capture_replay.c
+  * @brief          : Camera bus waveform replay
+  *
+  *                   Drives the capture engine the way the sensor and the DMA
+  *                   controller would: pixel values are placed on the data
+  *                   port IDR, HREF/VSYNC edges enter through the EXTI
+  *                   callback, and each TIM2 CC1 capture, one per PCLK or
+  *                   one every IC1PSC PCLK edges, moves one byte from IDR
+  *                   to CMAR while the engine keeps the capture DMA request
+  *                   and the DMA channel enabled. Half-transfer and transfer-
+  *                   complete flags are raised on the channel and its
+  *                   interrupt handler is run when the engine enabled them.
+  *
+  *                   DWT->CYCCNT follows the waveform: it advances by
+  *                   PclkCycles per PCLK and VSYNC edges are FrameCycles
+  *                   apart, as with a sensor whose frame period does not
+  *                   depend on the readout window.
+  *
+  *                   CMAR holds a 32-bit address, so the host image must be
+  *                   linked non-PIE for the static line buffers to be
+  *                   reachable through it.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "capture_replay.h"
+#include "stm32f3xx_it.h"
+
+/* Private variables ---------------------------------------------------------*/
+static CaptureReplay_TimingTypeDef replay_timing = {
+  .HBlank = 16U,
+  .VBlank = 64U,
+  .BlankData = 0xA5U,
+  .BlankPclk = 0U,          /* COM10[5]: PCLK held during blanking */
+  .PclkCycles = 12U,        /* 6 MHz PCLK at 72 MHz */
+  .FrameCycles = 2400000U,  /* 30 frames/s at 72 MHz */
+};
+
+/* DMA reload value, latched when the engine re-arms the channel */
+static uint32_t replay_reload;
+static uint32_t replay_pclk_count;
+/* PCLK edges counted by the TIM2 input capture prescaler */
+static uint32_t replay_psc_events;
+static uint32_t replay_vsync_cycles;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Raise a DMA1 channel 5 event and run its interrupt handler
+  * @param  flag: DMA_ISR_HTIF5 or DMA_ISR_TCIF5
+  * @param  enable: matching interrupt enable bit in CCR
+  * @retval None
+  */
+static void CaptureReplay_DmaEvent(uint32_t flag, uint32_t enable)
+{
+  DMA_TypeDef *dma = hdma_tim2_ch1.DmaBaseAddress;
+
+  dma->ISR |= flag | DMA_ISR_GIF5;
+  if ((hdma_tim2_ch1.Instance->CCR & enable) != 0U) {
+    DMA1_Channel5_IRQHandler();
+  }
+  dma->ISR &= ~(flag | DMA_ISR_GIF5);
+}
+
+/**
+  * @brief  One PCLK rising edge: TIM2_CH1 capture and its DMA request
+  * @param  data: value on the camera bus
+  * @retval None
+  */
+static void CaptureReplay_Pclk(uint8_t data)
+{
+  DMA_Channel_TypeDef *ch = hdma_tim2_ch1.Instance;
+  uint8_t *mem;
+
+  const uint32_t psc = (htim2.Instance->CCMR1 & TIM_CCMR1_IC1PSC) >> TIM_CCMR1_IC1PSC_Pos;
+
+  replay_pclk_count++;
+  DWT->CYCCNT += replay_timing.PclkCycles;
+  CAM_DATA_GPIO_Port->IDR = (CAM_DATA_GPIO_Port->IDR & ~0xFFU) | data;
+
+  if (++replay_psc_events < (1U << psc)) {
+    return;
+  }
+  replay_psc_events = 0U;
+  if ((htim2.Instance->DIER & TIM_DIER_CC1DE) == 0U
+      || (ch->CCR & DMA_CCR_EN) == 0U || replay_reload == 0U) {
+    return;
+  }
+  mem = (uint8_t *)(uintptr_t)ch->CMAR;
+  mem[replay_reload - ch->CNDTR] = (uint8_t)CAM_DATA_GPIO_Port->IDR;
+  if (--ch->CNDTR == replay_reload / 2U) {
+    CaptureReplay_DmaEvent(DMA_ISR_HTIF5, DMA_CCR_HTIE);
+  } else if (ch->CNDTR == 0U) {
+    ch->CNDTR = replay_reload;
+    CaptureReplay_DmaEvent(DMA_ISR_TCIF5, DMA_CCR_TCIE);
+  }
+}
+
+/**
+  * @brief  One PCLK period with HREF low
+  * @retval None
+  */
+static void CaptureReplay_Blank(void)
+{
+  if (replay_timing.BlankPclk) {
+    CaptureReplay_Pclk(replay_timing.BlankData);
+    return;
+  }
+  replay_pclk_count++;
+  DWT->CYCCNT += replay_timing.PclkCycles;
+  CAM_DATA_GPIO_Port->IDR = (CAM_DATA_GPIO_Port->IDR & ~0xFFU) | replay_timing.BlankData;
+}
+
+/**
+  * @brief  Drive a synchronization pin and raise its EXTI callback
+  * @param  port: GPIO port of the pin
+  * @param  pin: synchronization pin
+  * @param  level: new pin level
+  * @retval None
+  */
+static void CaptureReplay_Edge(GPIO_TypeDef *port, uint16_t pin, uint8_t level)
+{
+  if (level) {
+    port->IDR |= pin;
+  } else {
+    port->IDR &= ~(uint32_t)pin;
+  }
+  if (pin == CAM_VSYNC_Pin && !level) {
+    return;
+  }
+  HAL_GPIO_EXTI_Callback(pin);
+}
+
+/**
+  * @brief  Override the default waveform timing
+  * @param  timing: new timing
+  * @retval None
+  */
+void CaptureReplay_SetTiming(const CaptureReplay_TimingTypeDef *timing)
+{
+  replay_timing = *timing;
+}
+
+/**
+  * @brief  Return the waveform timing in use
+  * @param  timing: destination
+  * @retval None
+  */
+void CaptureReplay_GetTiming(CaptureReplay_TimingTypeDef *timing)
+{
+  *timing = replay_timing;
+}
+
+/**
+  * @brief  Replay one frame: VSYNC pulse, vertical blanking, then one HREF
+  *         window per line separated by horizontal blanking
+  * @param  frame: line_bytes * lines bytes, as output on the camera bus
+  * @param  line_bytes: bytes per line
+  * @param  lines: lines in the frame
+  * @retval None
+  */
+void CaptureReplay_Frame(const uint8_t *frame, uint16_t line_bytes, uint16_t lines)
+{
+  DWT->CYCCNT = replay_vsync_cycles;
+  replay_vsync_cycles += replay_timing.FrameCycles;
+
+  CaptureReplay_Edge(CAM_VSYNC_GPIO_Port, CAM_VSYNC_Pin, 1U);
+  replay_reload = hdma_tim2_ch1.Instance->CNDTR;
+  /* The engine toggles CC1E at VSYNC, which clears the capture prescaler */
+  replay_psc_events = 0U;
+  CaptureReplay_Blank();
+  CaptureReplay_Edge(CAM_VSYNC_GPIO_Port, CAM_VSYNC_Pin, 0U);
+
+  for (uint32_t i = 0U; i < replay_timing.VBlank; i++) {
+    CaptureReplay_Blank();
+  }
+
+  for (uint16_t y = 0U; y < lines; y++) {
+    CaptureReplay_Edge(CAM_HREF_GPIO_Port, CAM_HREF_Pin, 1U);
+    for (uint16_t x = 0U; x < line_bytes; x++) {
+      CaptureReplay_Pclk(frame[(uint32_t)y * line_bytes + x]);
+    }
+    CaptureReplay_Edge(CAM_HREF_GPIO_Port, CAM_HREF_Pin, 0U);
+
+    for (uint32_t i = 0U; i < replay_timing.HBlank; i++) {
+      CaptureReplay_Blank();
+    }
+  }
+}
+
+/**
+  * @brief  Return the number of PCLK periods replayed so far
+  * @retval PCLK count
+  */
+uint32_t CaptureReplay_GetPclkCount(void)
+{
+  return replay_pclk_count;
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : capture_replay.h
+  * @brief          : Header for capture_replay.c file.
+  *                   Host-side test double of the camera bus: replays a
+  *                   synthetic PCLK/HREF/VSYNC waveform into the capture
+  *                   engine and emulates the TIM2_CH1-triggered DMA transfer.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CAPTURE_REPLAY_H
+#define __CAPTURE_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "capture.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Waveform timing, in PCLK periods unless noted
+  */
+typedef struct
+{
+  uint16_t HBlank;        /*!< PCLK periods with HREF low between two lines */
+  uint16_t VBlank;        /*!< PCLK periods between VSYNC and the first line */
+  uint8_t BlankData;      /*!< Bus value driven outside active pixels       */
+  uint8_t BlankPclk;      /*!< Nonzero if PCLK toggles while HREF is low    */
+  uint8_t PclkCycles;     /*!< CPU cycles per PCLK period                   */
+  uint32_t FrameCycles;   /*!< CPU cycles between two VSYNC edges           */
+} CaptureReplay_TimingTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void CaptureReplay_SetTiming(const CaptureReplay_TimingTypeDef *timing);
+void CaptureReplay_GetTiming(CaptureReplay_TimingTypeDef *timing);
+void CaptureReplay_Frame(const uint8_t *frame, uint16_t line_bytes, uint16_t lines);
+uint32_t CaptureReplay_GetPclkCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CAPTURE_REPLAY_H */
@@ -0,0 +1,807 @@
+/**
+  ******************************************************************************
+  * @file           : replay.c
+  * @brief          : Frame replay through the tracking pipeline
+  *
+  *                   Feeds frames through the capture engine via the bus
+  *                   replay double, then through detection, labeling, ROI
+  *                   tracking and telemetry, exactly as wired in main.c. The
+  *                   sensor answers on the emulated I2C bus and each frame is
+  *                   cropped to the window last programmed into it. Search
+  *                   windows are downsampled the way the sensor does it, by
+  *                   dropping rows and columns, and the frame period follows
+  *                   the sensor clock prescaler.
+  *
+  *                   Every telemetry packet is decoded again and compared
+  *                   with the blobs, or with RUN_DUMP_ENABLED the runs, it
+  *                   was built from. The pool occupancy printed at the end
+  *                   comes from the last stats packet decoded, not from the
+  *                   pools directly. With PROFILE_ENABLED the stages are
+  *                   scoped and their records streamed as in main.c, and
+  *                   each record must count no fewer samples than the last
+  *                   one for its stage. Without an input file a synthetic dot
+  *                   moving on a circle is replayed and the centroid error
+  *                   against its true position is reported over the
+  *                   full-resolution frames, along with the error of the
+  *                   tracker prediction made for each frame before it was
+  *                   seen, and the time from the dot appearance to lock: the
+  *                   first full-resolution ROI frame that finds it. With -a
+  *                   the dot blinks, hidden for REPLAY_BLINK_HIDE of every
+  *                   REPLAY_BLINK_PERIOD frame periods, so that every
+  *                   reappearance is reacquired. With REFINE_ENABLED the
+  *                   error of the moment centroid and of the fitted one
+  *                   are also compared on the frames that were fitted.
+  *
+  *                   Synthetic frames carry REPLAY_HOT_PIXELS hot pixels at
+  *                   fixed places. With -c the hot pixel map is first
+  *                   calibrated on dark frames and stored to the emulated
+  *                   flash, and the pixels it found are checked against
+  *                   those planted, failing the run unless the map holds
+  *                   exactly those; the blob count per frame shows what the
+  *                   map takes out.
+  *
+  *                   With -w a new threshold is written to the parameter
+  *                   store every frame, and the store advanced between
+  *                   frames as the main loop does while waiting, so that
+  *                   it compacts several times over the run. The store is
+  *                   then read back as after a reset: the last threshold
+  *                   and the hot pixel map must survive.
+  *
+  *                   With -g a register write of the sensor bus is NACKed
+  *                   every REPLAY_GLITCH_PERIOD frames, partway through the
+  *                   next window batch: the ROI must write the window again
+  *                   and keep tracking.
+  *
+  *                   Usage: replay [-n frames] [-a] [-c] [-w] [-g] [-v] [frames.yuyv]
+  *                   Input: raw QVGA YUYV frames, e.g. from
+  *                   ffmpeg -i in.mp4 -s 320x240 -pix_fmt yuyv422 -f rawvideo
+  *                   or, with SENSOR_FORMAT_RGB565, -pix_fmt rgb565be
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "capture_replay.h"
+#include "detect.h"
+#include "host_hal.h"
+#include "hotpix.h"
+#include "label.h"
+#include "mask.h"
+#include "param.h"
+#include "pool.h"
+#include "profile.h"
+#include "refine.h"
+#include "roi.h"
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+#include "track.h"
+
+/* Private define ------------------------------------------------------------*/
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+#define REPLAY_THRESHOLD        64U
+#define REPLAY_STRIDE           1U
+#else
+#define REPLAY_THRESHOLD        200U
+#define REPLAY_STRIDE           CAPTURE_BYTES_PER_PIXEL
+#endif
+#define REPLAY_AUTO_PERCENTILE  990U
+#define REPLAY_AUTO_MARGIN      48U
+#define REPLAY_AUTO_MIN         32U
+#define REPLAY_AUTO_MAX         250U
+#define REPLAY_FRAME_BYTES      (SENSOR_WIDTH * SENSOR_BYTES_PER_PIXEL * SENSOR_HEIGHT)
+#define REPLAY_SENSOR_PID       0x76U
+/* Offset of Y in a bus pixel: UYVY with SENSOR_FORMAT_LUMA, YUYV otherwise */
+#if SENSOR_FORMAT == SENSOR_FORMAT_LUMA
+#define REPLAY_Y_OFFSET         1U
+#else
+#define REPLAY_Y_OFFSET         0U
+#endif
+
+/* Synthetic dot: saturated Gaussian spot on a circular path */
+#define REPLAY_DOT_SIGMA        3.0
+#define REPLAY_DOT_RADIUS       80.0
+#define REPLAY_DOT_PERIOD       240.0
+/* Isolated saturated pixels per synthetic frame */
+#define REPLAY_SALT             16U
+/* Saturated pixels at the same place in every synthetic frame */
+#define REPLAY_HOT_PIXELS       12U
+/* Blinking dot, in frame periods of the mode table clock */
+#define REPLAY_BLINK_PERIOD     60.0
+#define REPLAY_BLINK_HIDE       10.0
+/* Frames between two injected sensor bus NACKs, and the register write of
+   the next batch that fails */
+#define REPLAY_GLITCH_PERIOD    50U
+#define REPLAY_GLITCH_TRANSFER  3U
+/* Param_Process calls between two frames, standing for the idle loop */
+#define REPLAY_PARAM_STEPS      8U
+/* Largest centroid error of a locked dot, in pixels */
+#define REPLAY_LOCK_ERROR       1.0
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t replay_frame[REPLAY_FRAME_BYTES];
+static uint8_t replay_window[REPLAY_FRAME_BYTES];
+static Label_FrameTypeDef *replay_blobs;
+static Sensor_WindowTypeDef replay_sent_window;
+static Hotpix_PixelTypeDef replay_hot[REPLAY_HOT_PIXELS];
+
+static TelemetryDecoder_HandleTypeDef replay_decoder;
+static const Label_FrameTypeDef *replay_sent;
+static uint32_t replay_mismatches;
+static Telemetry_StatsTypeDef replay_stats;
+static uint32_t replay_stats_packets;
+#if PROFILE_ENABLED
+static uint32_t replay_profile_count[PROFILE_STAGE_COUNT];
+static uint32_t replay_profile_packets;
+#endif
+#if RUN_DUMP_ENABLED
+static Detect_RunsTypeDef *replay_runs;
+static uint32_t replay_run_packets;
+static uint32_t replay_run_count;
+#endif
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Same wiring as main.c
+  */
+void Capture_LineCpltCallback(const uint8_t *line, uint16_t line_bytes, uint16_t y)
+{
+  const Kernel_RunTypeDef *runs;
+  uint16_t count;
+
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+  count = Detect_ColorLine(line, line_bytes, y, &runs);
+#if REFINE_ENABLED
+  Refine_Line(Detect_GetScores(), line_bytes / 2U, 1U, y);
+#endif
+  Hotpix_CalibrateLine(Detect_GetScores(), line_bytes / 2U, 1U, y);
+#else
+  count = Detect_Line(line, line_bytes, y, &runs);
+#if REFINE_ENABLED
+  Refine_Line(line, line_bytes, REPLAY_STRIDE, y);
+#endif
+  Hotpix_CalibrateLine(line, line_bytes, REPLAY_STRIDE, y);
+#endif
+  Label_Line(runs, count, y);
+#if MASK_ENABLED
+  Mask_Line(runs, count, line_bytes / CAPTURE_BYTES_PER_PIXEL, y);
+#endif
+}
+
+void Capture_FrameCpltCallback(uint32_t frame, uint16_t lines)
+{
+  UNUSED(lines);
+  Detect_EndFrame(frame);
+  Label_EndFrame(frame);
+#if MASK_ENABLED
+  Mask_EndFrame(frame);
+#endif
+#if REFINE_ENABLED
+  Refine_EndFrame(frame);
+#endif
+  Hotpix_EndFrame(frame);
+}
+
+/**
+  * @brief  Check a decoded packet against the blobs it was encoded from
+  */
+static void Replay_OnPacket(const TelemetryDecoder_PacketTypeDef *packet, void *user)
+{
+  const Label_FrameTypeDef *sent = replay_sent;
+  uint32_t count;
+
+  UNUSED(user);
+  if (packet->Header.Type == TELEMETRY_TYPE_STATS) {
+    replay_stats = packet->Stats;
+    replay_stats_packets++;
+    return;
+  }
+#if PROFILE_ENABLED
+  if (packet->Header.Type == TELEMETRY_TYPE_PROFILE) {
+    const Telemetry_ProfileTypeDef *profile = &packet->Profile;
+
+    /* Samples are only ever added to a stage */
+    if (profile->Stage >= PROFILE_STAGE_COUNT
+        || profile->Count < replay_profile_count[profile->Stage]) {
+      replay_mismatches++;
+      return;
+    }
+    replay_profile_count[profile->Stage] = profile->Count;
+    replay_profile_packets++;
+    return;
+  }
+#endif
+#if RUN_DUMP_ENABLED
+  if (packet->Header.Type == TELEMETRY_TYPE_RUNS) {
+    const Detect_RunsTypeDef *runs = replay_runs;
+
+    if (packet->Header.Frame != runs->Frame || packet->Header.Count != runs->Count
+        || ((packet->Header.Flags & TELEMETRY_FLAG_TRUNCATED) != 0U) != (runs->Dropped != 0U)
+        || 1U << ((packet->Header.Flags & TELEMETRY_FLAG_SCALE) >> TELEMETRY_FLAG_SCALE_Pos)
+           != replay_sent_window.Scale) {
+      replay_mismatches++;
+      return;
+    }
+    for (uint32_t i = 0U; i < runs->Count; i++) {
+      if (packet->Runs[i].Y != runs->Runs[i].Y || packet->Runs[i].Start != runs->Runs[i].Start
+          || packet->Runs[i].Length != runs->Runs[i].Length) {
+        replay_mismatches++;
+        return;
+      }
+    }
+    replay_run_packets++;
+    replay_run_count += runs->Count;
+    return;
+  }
+#endif
+  if (packet->Header.Type != TELEMETRY_TYPE_BLOBS) {
+    return;
+  }
+  count = sent->Count < TELEMETRY_MAX_BLOBS ? sent->Count : TELEMETRY_MAX_BLOBS;
+  if (packet->Header.Frame != sent->Frame || packet->Header.Count != count) {
+    replay_mismatches++;
+    return;
+  }
+  for (uint32_t i = 0U; i < count; i++) {
+    if (packet->Blobs[i].X != sent->Blobs[i].X || packet->Blobs[i].Y != sent->Blobs[i].Y
+        || packet->Blobs[i].Area != (sent->Blobs[i].Area > 0xFFFFU ? 0xFFFFU : sent->Blobs[i].Area)
+        || packet->Blobs[i].Flags != (sent->Blobs[i].Refined ? TELEMETRY_BLOB_REFINED : 0U)) {
+      replay_mismatches++;
+      return;
+    }
+  }
+}
+
+/**
+  * @brief  Serial output goes to the decoder
+  */
+static void Replay_OnSerial(const uint8_t *data, uint32_t len, void *user)
+{
+  UNUSED(user);
+  TelemetryDecoder_Feed(&replay_decoder, data, len);
+}
+
+/**
+  * @brief  Set the places of the hot pixels, spread over the frame by a
+  *         fixed generator
+  * @retval None
+  */
+static void Replay_PlantHotPixels(void)
+{
+  uint32_t state = 12345U;
+
+  for (uint32_t i = 0U; i < REPLAY_HOT_PIXELS; i++) {
+    state = state * 1103515245U + 12345U;
+    replay_hot[i].X = (uint16_t)((state >> 8) % SENSOR_WIDTH);
+    state = state * 1103515245U + 12345U;
+    replay_hot[i].Y = (uint16_t)((state >> 8) % SENSOR_HEIGHT);
+  }
+}
+
+/**
+  * @brief  Render the synthetic frame at time t, in frame periods: Y carries
+  *         the dot, if visible, over dark noise, a few isolated saturated
+  *         pixels and the hot pixels, chroma is flat. In RGB565 the dot and
+  *         the pixels are red over grey noise.
+  * @retval None
+  */
+static void Replay_Synthesize(double t, uint8_t visible, double *x0, double *y0)
+{
+  double a = 2.0 * M_PI * t / REPLAY_DOT_PERIOD;
+  double peak = visible ? 400.0 : 0.0;
+
+  *x0 = SENSOR_WIDTH / 2.0 + REPLAY_DOT_RADIUS * cos(a);
+  *y0 = SENSOR_HEIGHT / 2.0 + 0.6 * REPLAY_DOT_RADIUS * sin(a);
+
+  for (uint32_t y = 0U; y < SENSOR_HEIGHT; y++) {
+    for (uint32_t x = 0U; x < SENSOR_WIDTH; x++) {
+      double d2 = (x - *x0) * (x - *x0) + (y - *y0) * (y - *y0);
+      double v = 16 + rand() % 32 + peak * exp(-d2 / (2.0 * REPLAY_DOT_SIGMA * REPLAY_DOT_SIGMA));
+      uint8_t *p = &replay_frame[(y * SENSOR_WIDTH + x) * SENSOR_BYTES_PER_PIXEL];
+
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+      uint32_t r = (uint32_t)(v > 255.0 ? 255.0 : v);
+      uint32_t g = 16U + (uint32_t)rand() % 32U;
+
+      p[0] = (uint8_t)((r & 0xF8U) | g >> 5);
+      p[1] = (uint8_t)((g << 3 & 0xE0U) | g >> 3);
+#else
+      p[REPLAY_Y_OFFSET] = (uint8_t)(v > 255.0 ? 255.0 : v);
+      p[1U - REPLAY_Y_OFFSET] = 128U;
+#endif
+    }
+  }
+
+  for (uint32_t i = 0U; i < REPLAY_SALT + REPLAY_HOT_PIXELS; i++) {
+    uint32_t x = i < REPLAY_SALT ? (uint32_t)rand() % SENSOR_WIDTH : replay_hot[i - REPLAY_SALT].X;
+    uint32_t y = i < REPLAY_SALT ? (uint32_t)rand() % SENSOR_HEIGHT : replay_hot[i - REPLAY_SALT].Y;
+    uint8_t *p = &replay_frame[(y * SENSOR_WIDTH + x) * SENSOR_BYTES_PER_PIXEL];
+
+#if SENSOR_FORMAT == SENSOR_FORMAT_RGB565
+    p[0] = 0xF8U;
+    p[1] = 0x00U;
+#else
+    p[REPLAY_Y_OFFSET] = 255U;
+#endif
+  }
+}
+
+/**
+  * @brief  Read the sensor window out of the full frame, dropping rows and
+  *         columns at search scale
+  * @param  window: window last programmed
+  * @retval Bytes per line
+  */
+static uint32_t Replay_Crop(const Sensor_WindowTypeDef *window)
+{
+  const uint32_t width = window->Width / window->Scale;
+  uint8_t *out = replay_window;
+
+  for (uint32_t y = 0U; y < window->Height / window->Scale; y++) {
+    const uint8_t *row = &replay_frame[((window->Y + y * window->Scale) * SENSOR_WIDTH + window->X)
+                                       * SENSOR_BYTES_PER_PIXEL];
+
+    for (uint32_t x = 0U; x < width; x++, out += SENSOR_BYTES_PER_PIXEL) {
+      const uint32_t src = x * window->Scale;
+
+      memcpy(out, &row[src * SENSOR_BYTES_PER_PIXEL], SENSOR_BYTES_PER_PIXEL);
+#if SENSOR_FORMAT != SENSOR_FORMAT_RGB565
+      /* U and V alternate: chroma comes from the pixel of the same parity */
+      out[1U - REPLAY_Y_OFFSET] =
+        row[((src & ~1U) + (x & 1U)) * SENSOR_BYTES_PER_PIXEL + 1U - REPLAY_Y_OFFSET];
+#endif
+    }
+  }
+  return width * SENSOR_BYTES_PER_PIXEL;
+}
+
+/**
+  * @brief  Calibrate the hot pixel map on dark full frames and store it,
+  *         as main.c does with HOTPIX_CALIBRATE
+  * @retval HAL status
+  */
+static HAL_StatusTypeDef Replay_Calibrate(void)
+{
+  const Sensor_WindowTypeDef full = { 0U, 0U, SENSOR_WIDTH, SENSOR_HEIGHT, 1U };
+  HAL_StatusTypeDef err;
+  double x0;
+  double y0;
+
+  Hotpix_StartCalibration();
+  err = Capture_Start();
+  if (err != HAL_OK) {
+    return err;
+  }
+  while (Hotpix_IsCalibrating()) {
+    uint32_t row_bytes;
+
+    Replay_Synthesize(0.0, 0U, &x0, &y0);
+    row_bytes = Replay_Crop(&full);
+    CaptureReplay_Frame(replay_window, (uint16_t)row_bytes, SENSOR_HEIGHT);
+  }
+  err = Capture_Stop();
+  if (err != HAL_OK) {
+    return err;
+  }
+  return Hotpix_Store();
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = 480U;
+  uint32_t verbose = 0U;
+  uint32_t blink = 0U;
+  uint32_t calibrate = 0U;
+  uint32_t store = 0U;
+  uint32_t glitch = 0U;
+  uint32_t glitch_count = 0U;
+  uint32_t param_written = 0U;
+  uint32_t param_busy = 0U;
+  uint8_t param_last = 0U;
+  uint32_t decoded = 0U;
+  double error_sum = 0.0;
+  uint32_t error_count = 0U;
+  double predict_sum = 0.0;
+  uint32_t predict_count = 0U;
+  CaptureReplay_TimingTypeDef timing;
+  uint32_t base_cycles;
+  uint64_t cycles = 0U;
+  uint8_t visible = 0U;
+  uint8_t locked = 0U;
+  uint32_t appear_frame = 0U;
+  uint64_t appear_cycles = 0U;
+  uint32_t lock_count = 0U;
+  uint32_t lock_frames = 0U;
+  uint64_t lock_cycles = 0U;
+  uint32_t blob_sum = 0U;
+  uint32_t blob_frames = 0U;
+#if MASK_ENABLED
+  Mask_ResultTypeDef mask;
+  uint32_t mask_count = 0U;
+  uint32_t mask_inside = 0U;
+  uint32_t mask_width_sum = 0U;
+  uint32_t mask_height_sum = 0U;
+#endif
+#if REFINE_ENABLED
+  uint32_t refine_count = 0U;
+  uint32_t refine_tried = 0U;
+  double refine_moment_sum = 0.0;
+  double refine_fit_sum = 0.0;
+#endif
+  FILE *input = NULL;
+  uint8_t *sensor;
+  double start;
+  double elapsed;
+  struct timespec ts;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:acwgv")) != -1) {
+    switch (opt) {
+      case 'n':
+        frames = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'a':
+        blink = 1U;
+        break;
+      case 'c':
+        calibrate = 1U;
+        break;
+      case 'w':
+        store = 1U;
+        break;
+      case 'g':
+        glitch = 1U;
+        break;
+      case 'v':
+        verbose = 1U;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-n frames] [-a] [-c] [-w] [-g] [-v] [frames.yuyv]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (optind < argc) {
+    input = fopen(argv[optind], "rb");
+    if (input == NULL) {
+      perror(argv[optind]);
+      return 2;
+    }
+  }
+
+  sensor = HostHal_I2C_AttachDevice(SENSOR_ADDRESS);
+  sensor[SENSOR_REG_PID] = REPLAY_SENSOR_PID;
+  TelemetryDecoder_Init(&replay_decoder, Replay_OnPacket, NULL);
+  HostHal_SetSerialSink(Replay_OnSerial, NULL);
+
+  HAL_Init();
+  Pool_Init();
+  Profile_Init();
+  if (Telemetry_Init() != HAL_OK) {
+    fprintf(stderr, "telemetry bring-up failed\n");
+    return 1;
+  }
+  if (Param_Init() != HAL_OK) {
+    fprintf(stderr, "parameter store bring-up failed\n");
+    return 1;
+  }
+  replay_blobs = Pool_Alloc(POOL_BLOBS);
+  if (replay_blobs == NULL) {
+    fprintf(stderr, "blob table allocation failed\n");
+    return 1;
+  }
+  if (Sensor_Init() != HAL_OK || Sensor_Wait() != HAL_OK) {
+    fprintf(stderr, "sensor bring-up failed\n");
+    return 1;
+  }
+  Track_Init();
+  Detect_Init(REPLAY_THRESHOLD, REPLAY_STRIDE);
+  Detect_SetAuto(&(const Detect_AutoTypeDef){
+    REPLAY_AUTO_PERCENTILE, REPLAY_AUTO_MARGIN, REPLAY_AUTO_MIN, REPLAY_AUTO_MAX });
+  Label_Init();
+#if MASK_ENABLED
+  Mask_Init();
+#endif
+#if REFINE_ENABLED
+  Refine_Init();
+#endif
+  Replay_PlantHotPixels();
+  Hotpix_Init();
+  if (Capture_Init(SENSOR_WIDTH * CAPTURE_BYTES_PER_PIXEL, SENSOR_HEIGHT) != HAL_OK) {
+    fprintf(stderr, "capture bring-up failed\n");
+    return 1;
+  }
+  if (calibrate && Replay_Calibrate() != HAL_OK) {
+    fprintf(stderr, "hot pixel calibration failed\n");
+    return 1;
+  }
+  if (Roi_Init() != HAL_OK || Capture_Start() != HAL_OK) {
+    fprintf(stderr, "capture bring-up failed\n");
+    return 1;
+  }
+  CaptureReplay_GetTiming(&timing);
+  base_cycles = timing.FrameCycles;
+
+  srand(1);
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  start = ts.tv_sec + ts.tv_nsec * 1e-9;
+
+  for (uint32_t n = 0U; n < frames; n++) {
+    Sensor_WindowTypeDef window;
+    uint32_t row_bytes;
+    uint64_t vsync_cycles = cycles;
+    double t = (double)cycles / base_cycles;
+    double x0 = 0.0;
+    double y0 = 0.0;
+
+    /* The frame period follows the sensor clock, XCLK / 2 in the mode table */
+    timing.FrameCycles = base_cycles / 2U * ((sensor[SENSOR_REG_CLKRC] & 0x3FU) + 1U);
+    CaptureReplay_SetTiming(&timing);
+    cycles += timing.FrameCycles;
+
+    if (!blink || fmod(t, REPLAY_BLINK_PERIOD) < REPLAY_BLINK_PERIOD - REPLAY_BLINK_HIDE) {
+      if (!visible) {
+        appear_frame = n;
+        appear_cycles = vsync_cycles;
+        locked = 0U;
+      }
+      visible = 1U;
+    } else {
+      visible = 0U;
+    }
+
+    if (input != NULL) {
+      if (fread(replay_frame, 1U, REPLAY_FRAME_BYTES, input) != REPLAY_FRAME_BYTES) {
+        frames = n;
+        break;
+      }
+#if SENSOR_FORMAT == SENSOR_FORMAT_LUMA
+      /* The sensor is set up for UYVY: swap the bytes of each pair */
+      for (uint32_t i = 0U; i < REPLAY_FRAME_BYTES; i += 2U) {
+        uint8_t c = replay_frame[i];
+
+        replay_frame[i] = replay_frame[i + 1U];
+        replay_frame[i + 1U] = c;
+      }
+#endif
+    } else {
+      Replay_Synthesize(t, visible, &x0, &y0);
+    }
+
+    /* The sensor outputs the window last programmed over I2C */
+    Roi_GetWindow(n, &window);
+    row_bytes = Replay_Crop(&window);
+    CaptureReplay_Frame(replay_window, (uint16_t)row_bytes, window.Height / window.Scale);
+
+    if (!Label_GetFrame(replay_blobs)) {
+      fprintf(stderr, "frame %u: no labeling result\n", n);
+      return 1;
+    }
+    if (Roi_GetWindow(replay_blobs->Frame, &window)) {
+      Track_PredictionTypeDef prediction;
+      uint32_t vsync_time;
+
+      if (window.Scale != 1U) {
+        Label_ScaleFrame(replay_blobs, window.Scale);
+      }
+#if REFINE_ENABLED
+      else if (replay_blobs->Count != 0U) {
+        const int32_t moment_x = replay_blobs->Blobs[0].X;
+        const int32_t moment_y = replay_blobs->Blobs[0].Y;
+
+        if (Refine_Frame(replay_blobs) && input == NULL && visible) {
+          refine_moment_sum += hypot(window.X + moment_x / 65536.0 - x0,
+                                     window.Y + moment_y / 65536.0 - y0);
+          refine_fit_sum += hypot(window.X + replay_blobs->Blobs[0].X / 65536.0 - x0,
+                                  window.Y + replay_blobs->Blobs[0].Y / 65536.0 - y0);
+          refine_count++;
+        }
+        refine_tried += input == NULL && visible;
+      }
+#endif
+      if (Capture_GetFrameTime(replay_blobs->Frame, &vsync_time)) {
+        if (input == NULL && visible && window.Scale == 1U
+            && Track_Predict(vsync_time, &prediction) && prediction.Hits > 1U) {
+          predict_sum += hypot(prediction.X - x0, prediction.Y - y0);
+          predict_count++;
+        }
+        {
+          PROFILE_SCOPE(PROFILE_STAGE_FILTER);
+
+          Track_Update(replay_blobs, window.X, window.Y, vsync_time);
+        }
+      }
+
+      blob_sum += replay_blobs->Count;
+      blob_frames++;
+      replay_sent = replay_blobs;
+      replay_sent_window = window;
+      {
+        PROFILE_SCOPE(PROFILE_STAGE_TELEMETRY);
+
+        Telemetry_SendBlobs(replay_blobs, &window, n);
+        decoded++;
+#if RUN_DUMP_ENABLED
+        /* Taken for the frame and given back once sent, as in main.c */
+        replay_runs = Pool_Alloc(POOL_RUNS);
+        if (replay_runs != NULL) {
+          if (Detect_GetRuns(replay_runs) && replay_runs->Frame == replay_blobs->Frame) {
+            Telemetry_SendRuns(replay_runs, &window, n);
+            decoded++;
+          }
+          (void)Pool_Free(POOL_RUNS, replay_runs);
+        }
+#endif
+        if (n % TELEMETRY_STATS_PERIOD == 0U) {
+          Telemetry_SendStats(n, n);
+          decoded++;
+        }
+      }
+
+#if MASK_ENABLED
+      if (input == NULL && visible && window.Scale == 1U && Mask_GetResult(&mask) && mask.XMin <= mask.XMax) {
+        mask_width_sum += mask.XMax - mask.XMin + 1U;
+        mask_height_sum += mask.YMax - mask.YMin + 1U;
+        mask_count++;
+        mask_inside += x0 >= window.X + mask.XMin && x0 <= window.X + mask.XMax
+                       && y0 >= window.Y + mask.YMin && y0 <= window.Y + mask.YMax;
+      }
+#endif
+      if (input == NULL && visible && window.Scale == 1U && replay_blobs->Count != 0U) {
+        double dx = window.X + replay_blobs->Blobs[0].X / 65536.0 - x0;
+        double dy = window.Y + replay_blobs->Blobs[0].Y / 65536.0 - y0;
+        double error = sqrt(dx * dx + dy * dy);
+
+        error_sum += error;
+        error_count++;
+        if (!locked && Roi_GetState() == ROI_STATE_TRACK && error < REPLAY_LOCK_ERROR) {
+          locked = 1U;
+          lock_count++;
+          lock_frames += n - appear_frame;
+          lock_cycles += vsync_cycles - appear_cycles;
+        }
+      }
+    }
+    if (verbose) {
+      printf("frame %4u  %-6s window %3u,%3u %3ux%3u /%u  blobs %2u",
+             replay_blobs->Frame, Roi_GetState() == ROI_STATE_TRACK ? "track" : "search",
+             window.X, window.Y, window.Width, window.Height, window.Scale, replay_blobs->Count);
+      if (replay_blobs->Count != 0U) {
+        printf("  dot %7.2f,%7.2f", window.X + replay_blobs->Blobs[0].X / 65536.0,
+               window.Y + replay_blobs->Blobs[0].Y / 65536.0);
+      }
+      printf("\n");
+    }
+    if (glitch && n % REPLAY_GLITCH_PERIOD == REPLAY_GLITCH_PERIOD - 1U) {
+      HostHal_I2C_InjectNack(REPLAY_GLITCH_TRANSFER);
+      glitch_count++;
+    }
+    /* As in main.c, a window the bus did not take is retried next frame */
+    (void)Roi_Update(replay_blobs);
+#if REFINE_ENABLED
+    Refine_Aim(replay_blobs->Frame);
+#endif
+#if PROFILE_ENABLED
+    Telemetry_SendProfile(replay_blobs->Frame, n);
+    decoded++;
+#endif
+    if (store) {
+      const uint8_t value = (uint8_t)n;
+
+      if (Param_Set(PARAM_KEY_THRESHOLD, &value, sizeof(value)) == HAL_OK) {
+        param_written++;
+        param_last = value;
+      } else {
+        param_busy++;
+      }
+    }
+    for (uint32_t k = 0U; k < REPLAY_PARAM_STEPS; k++) {
+      Param_Process();
+    }
+  }
+
+  Telemetry_SendStats(frames, frames);
+  decoded++;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  elapsed = ts.tv_sec + ts.tv_nsec * 1e-9 - start;
+
+  printf("%u frames in %.3f s (%.1f frames/s)\n", frames, elapsed, frames / elapsed);
+  printf("telemetry: %u sent, %u decoded, %u rejected, %u mismatched\n", decoded,
+         replay_decoder.Packets, replay_decoder.Errors, replay_mismatches);
+  if (error_count != 0U) {
+    printf("centroid error: %.3f px mean over %u frames\n", error_sum / error_count, error_count);
+  }
+  if (predict_count != 0U) {
+    printf("prediction error: %.3f px mean over %u frames\n", predict_sum / predict_count,
+           predict_count);
+  }
+  if (lock_count != 0U) {
+    printf("acquisition: %u locks, %.1f frames / %.1f ms mean from dot appearance to lock\n",
+           lock_count, (double)lock_frames / lock_count,
+           1e3 * lock_cycles / lock_count / SystemCoreClock);
+  }
+  if (blob_frames != 0U) {
+    printf("blobs: %.2f per frame mean\n", (double)blob_sum / blob_frames);
+  }
+  if (glitch) {
+    printf("sensor bus: %u NACKs injected, %u frames discarded on window changes\n",
+           glitch_count, frames - blob_frames);
+  }
+  if (calibrate) {
+    const Hotpix_PixelTypeDef *hot;
+    const uint16_t hot_count = Hotpix_GetPixels(&hot);
+    uint32_t found = 0U;
+
+    for (uint32_t i = 0U; i < REPLAY_HOT_PIXELS; i++) {
+      for (uint32_t k = 0U; k < hot_count; k++) {
+        if (hot[k].X == replay_hot[i].X && hot[k].Y == replay_hot[i].Y) {
+          found++;
+          break;
+        }
+      }
+    }
+    printf("hot pixels: %u mapped, %u of %u planted\n", hot_count, found, REPLAY_HOT_PIXELS);
+    if (found != REPLAY_HOT_PIXELS || hot_count != REPLAY_HOT_PIXELS) {
+      return 1;
+    }
+  }
+  if (store) {
+    const Hotpix_PixelTypeDef *hot;
+    const uint16_t hot_count = Hotpix_GetPixels(&hot);
+    uint8_t value = 0U;
+
+    /* Read everything back as a reset would */
+    store = Param_Flush() == HAL_OK && Param_Init() == HAL_OK
+            && Param_Get(PARAM_KEY_THRESHOLD, &value, sizeof(value)) == sizeof(value)
+            && value == param_last;
+    Hotpix_Init();
+    store = store && Hotpix_GetPixels(&hot) == hot_count;
+    printf("parameters: %u written, %u deferred while busy, %u pages erased, reload %s\n",
+           param_written, param_busy, HostHal_GetFlashErases(), store ? "ok" : "FAILED");
+    if (!store) {
+      return 1;
+    }
+  }
+#if RUN_DUMP_ENABLED
+  if (replay_run_packets != 0U) {
+    printf("runs: %u packets, %.1f runs per frame\n", replay_run_packets,
+           (double)replay_run_count / replay_run_packets);
+  }
+#endif
+#if REFINE_ENABLED
+  if (refine_count != 0U) {
+    printf("refine: %u of %u frames fitted, moments %.3f px, fit %.3f px mean error\n",
+           refine_count, refine_tried, refine_moment_sum / refine_count,
+           refine_fit_sum / refine_count);
+  }
+#endif
+#if MASK_ENABLED
+  if (mask_count != 0U) {
+    printf("mask: dot inside the cleaned box in %u of %u frames, box %.1f x %.1f px mean\n",
+           mask_inside, mask_count, (double)mask_width_sum / mask_count,
+           (double)mask_height_sum / mask_count);
+  }
+#endif
+#if PROFILE_ENABLED
+  printf("profile: %u packets, %u filter and %u telemetry samples last reported\n",
+         replay_profile_packets, replay_profile_count[PROFILE_STAGE_FILTER],
+         replay_profile_count[PROFILE_STAGE_TELEMETRY]);
+#endif
+  printf("stats: %u packets, %u serial bytes dropped\n", replay_stats_packets,
+         replay_stats.SerialDropped);
+  for (uint32_t i = 0U; i < replay_stats.Pools; i++) {
+    const Telemetry_PoolTypeDef *pool = &replay_stats.Pool[i];
+
+    printf("pool %u: %u of %u blocks of %u bytes in use, %u at most, %u failed\n", i,
+           pool->InUse, pool->Blocks, pool->BlockSize, pool->HighWater, pool->Failures);
+  }
+  if (input != NULL) {
+    fclose(input);
+  }
+  return replay_mismatches != 0U || replay_decoder.Packets != decoded;
+}
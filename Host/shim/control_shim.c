@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : control_shim.c
+  * @brief          : Host stand-in for control.c
+  *
+  *                   The replay has no mount to point: the loop never ticks
+  *                   and only its gains are kept.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "control.h"
+
+/* Private variables ---------------------------------------------------------*/
+TIM_HandleTypeDef htim6;
+
+static Control_GainsTypeDef control_gains = {
+  CONTROL_KP, CONTROL_KI, CONTROL_KD, CONTROL_KFF
+};
+
+/* Private user code ---------------------------------------------------------*/
+
+HAL_StatusTypeDef Control_Init(void)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef Control_Start(void)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef Control_Stop(void)
+{
+  return HAL_OK;
+}
+
+void Control_SetGains(const Control_GainsTypeDef *gains)
+{
+  control_gains = *gains;
+}
+
+void Control_GetGains(Control_GainsTypeDef *gains)
+{
+  *gains = control_gains;
+}
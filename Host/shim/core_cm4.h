@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : core_cm4.h
+  * @brief          : Host build wrapper of the CMSIS Cortex-M4 core header.
+  *
+  *                   Found ahead of Drivers/CMSIS/Include on the host include
+  *                   path: it provides the compiler macros and core
+  *                   intrinsics in portable C, then pulls in the real header
+  *                   for the register maps with cmsis_gcc.h (Arm inline
+  *                   assembly) kept out. The DSP intrinsics stay in simd.h.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_CORE_CM4_H
+#define __HOST_CORE_CM4_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Keep the Arm intrinsics out of the real header */
+#define __CMSIS_GCC_H
+
+/* Exported macro ------------------------------------------------------------*/
+#define __ASM                   __asm
+#define __INLINE                inline
+#define __STATIC_INLINE         static inline
+#define __STATIC_FORCEINLINE    __attribute__((always_inline)) static inline
+#define __NO_RETURN             __attribute__((__noreturn__))
+#define __USED                  __attribute__((used))
+#define __WEAK                  __attribute__((weak))
+#define __PACKED                __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT         struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION          union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#define __RESTRICT              __restrict
+#define __COMPILER_BARRIER()    __asm volatile("" ::: "memory")
+
+#define __NOP()                 __COMPILER_BARRIER()
+#define __WFI()                 __COMPILER_BARRIER()
+#define __WFE()                 __COMPILER_BARRIER()
+#define __SEV()                 __COMPILER_BARRIER()
+#define __ISB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DMB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __BKPT(value)           __builtin_trap()
+#define __CLZ(value)            ((uint8_t)((value) == 0U ? 32U : (uint32_t)__builtin_clz(value)))
+
+/* Exported variables --------------------------------------------------------*/
+/* Emulated PRIMASK; interrupts are run synchronously by the host test doubles */
+extern uint32_t host_primask;
+
+/* Exported functions --------------------------------------------------------*/
+__STATIC_FORCEINLINE void __enable_irq(void)
+{
+  host_primask = 0U;
+}
+
+__STATIC_FORCEINLINE void __disable_irq(void)
+{
+  host_primask = 1U;
+}
+
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)
+{
+  return host_primask;
+}
+
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t priMask)
+{
+  host_primask = priMask & 1U;
+}
+
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)
+{
+  return 0U;
+}
+
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value)
+{
+  return __builtin_bswap32(value);
+}
+
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value)
+{
+  return (value & 0xFF00FF00U) >> 8 | (value & 0x00FF00FFU) << 8;
+}
+
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value)
+{
+  value = (value & 0x55555555U) << 1 | (value >> 1 & 0x55555555U);
+  value = (value & 0x33333333U) << 2 | (value >> 2 & 0x33333333U);
+  value = (value & 0x0F0F0F0FU) << 4 | (value >> 4 & 0x0F0F0F0FU);
+  return __builtin_bswap32(value);
+}
+
+#include_next <core_cm4.h>
+
+#endif /* __HOST_CORE_CM4_H */
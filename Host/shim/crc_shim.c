@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+  * @file           : crc_shim.c
+  * @brief          : Host stand-in for crc.c: table-driven CRC-32/zlib
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "crc.h"
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t crc_table[256];
+
+/* Private user code ---------------------------------------------------------*/
+
+void Crc_Init(void)
+{
+  for (uint32_t i = 0U; i < 256U; i++) {
+    uint32_t c = i;
+
+    for (uint32_t bit = 0U; bit < 8U; bit++) {
+      c = (c >> 1) ^ (0xEDB88320U & (0U - (c & 1U)));
+    }
+    crc_table[i] = c;
+  }
+}
+
+uint32_t Crc_Compute(const uint8_t *data, uint32_t len)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+
+  for (uint32_t i = 0U; i < len; i++) {
+    crc = crc_table[(crc ^ data[i]) & 0xFFU] ^ (crc >> 8);
+  }
+  return ~crc;
+}
@@ -0,0 +1,169 @@
+/**
+  ******************************************************************************
+  * @file           : flash_shim.c
+  * @brief          : Host stand-in for the HAL flash program and erase APIs.
+  *
+  *                   The flash bank is mapped as plain memory at its device
+  *                   address before main() and starts erased, so firmware
+  *                   reads of flash data work unchanged. Programming obeys
+  *                   the device rules: the controller must be unlocked, the
+  *                   address halfword aligned, and a halfword can only be
+  *                   written once after an erase, or cleared to 0; any
+  *                   other write fails the way PGERR does. The interrupt
+  *                   driven calls complete on the spot and run the end of
+  *                   operation or error callback before returning.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "host_hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* Private define ------------------------------------------------------------*/
+#define HOST_FLASH_SIZE         0x00080000U
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t host_flash_locked = 1U;
+static uint32_t host_flash_erases;
+
+/* Private function prototypes -----------------------------------------------*/
+static HAL_StatusTypeDef HostFlash_ProgramHalfWord(uint32_t address, uint16_t data);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Back the flash bank with erased memory
+  * @retval None
+  */
+__attribute__((constructor)) static void HostFlash_Map(void)
+{
+  void *p = mmap((void *)FLASH_BASE, HOST_FLASH_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (p != (void *)FLASH_BASE) {
+    fprintf(stderr, "flash_shim: cannot map flash at 0x%08lx\n", (unsigned long)FLASH_BASE);
+    abort();
+  }
+  memset(p, 0xFF, HOST_FLASH_SIZE);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  host_flash_locked = 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  host_flash_locked = 1U;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Program a halfword, word or double word, halfword by halfword
+  *         as the controller does
+  */
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  const uint32_t halfwords = TypeProgram == FLASH_TYPEPROGRAM_HALFWORD ? 1U
+                             : TypeProgram == FLASH_TYPEPROGRAM_WORD ? 2U : 4U;
+  HAL_StatusTypeDef err = HAL_OK;
+
+  for (uint32_t i = 0U; i < halfwords && err == HAL_OK; i++) {
+    err = HostFlash_ProgramHalfWord(Address + 2U * i, (uint16_t)(Data >> (16U * i)));
+  }
+  return err;
+}
+
+/**
+  * @brief  Erase pages, or the whole bank
+  */
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+  uint32_t address = FLASH_BASE;
+  uint32_t size = HOST_FLASH_SIZE;
+
+  *PageError = 0xFFFFFFFFU;
+  if (host_flash_locked) {
+    return HAL_ERROR;
+  }
+  if (pEraseInit->TypeErase == FLASH_TYPEERASE_PAGES) {
+    address = pEraseInit->PageAddress & ~(FLASH_PAGE_SIZE - 1U);
+    size = pEraseInit->NbPages * FLASH_PAGE_SIZE;
+    if (address < FLASH_BASE || address + size > FLASH_BASE + HOST_FLASH_SIZE) {
+      *PageError = address;
+      return HAL_ERROR;
+    }
+  }
+  memset((void *)(uintptr_t)address, 0xFF, size);
+  host_flash_erases += size / FLASH_PAGE_SIZE;
+  return HAL_OK;
+}
+
+/**
+  * @brief  Program as HAL_FLASH_Program, then call back as the flash
+  *         interrupt would
+  */
+HAL_StatusTypeDef HAL_FLASH_Program_IT(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  if (HAL_FLASH_Program(TypeProgram, Address, Data) != HAL_OK) {
+    HAL_FLASH_OperationErrorCallback(Address);
+  } else {
+    HAL_FLASH_EndOfOperationCallback(Address);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Erase as HAL_FLASHEx_Erase, then call back as the flash
+  *         interrupt would
+  */
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef *pEraseInit)
+{
+  uint32_t page_error;
+
+  if (HAL_FLASHEx_Erase(pEraseInit, &page_error) != HAL_OK) {
+    HAL_FLASH_OperationErrorCallback(page_error);
+  } else {
+    HAL_FLASH_EndOfOperationCallback(0xFFFFFFFFU);
+  }
+  return HAL_OK;
+}
+
+void HAL_FLASH_IRQHandler(void)
+{
+}
+
+/**
+  * @brief  Pages erased since start-up, to follow flash wear
+  * @retval Page count
+  */
+uint32_t HostHal_GetFlashErases(void)
+{
+  return host_flash_erases;
+}
+
+/**
+  * @brief  Program one halfword
+  * @param  address: halfword address in the bank
+  * @param  data: value
+  * @retval HAL_ERROR when locked, unaligned, out of the bank or already
+  *         programmed
+  */
+static HAL_StatusTypeDef HostFlash_ProgramHalfWord(uint32_t address, uint16_t data)
+{
+  uint16_t *p = (uint16_t *)(uintptr_t)address;
+
+  if (host_flash_locked || (address & 1U) != 0U || address < FLASH_BASE
+      || address + 2U > FLASH_BASE + HOST_FLASH_SIZE) {
+    return HAL_ERROR;
+  }
+  if (*p != 0xFFFFU && data != 0U) {
+    return HAL_ERROR;
+  }
+  *p = data;
+  return HAL_OK;
+}
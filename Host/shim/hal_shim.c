@@ -0,0 +1,609 @@
+/**
+  ******************************************************************************
+  * @file           : hal_shim.c
+  * @brief          : Host stand-in for the HAL GPIO, DMA, I2C, tick, NVIC,
+  *                   TIM input capture and MCO APIs used by the firmware.
+  *
+  *                   The Cortex-M peripheral and system regions are mapped as
+  *                   plain memory at their device addresses before main(), so
+  *                   firmware register accesses and the CMSIS peripheral
+  *                   pointers work unchanged; register side effects are left
+  *                   to the test doubles (see capture_replay.c). The APIs
+  *                   below only keep handle state consistent and, for DMA,
+  *                   program the channel registers the way the HAL does.
+  *
+  *                   Time is virtual: HAL_Delay advances the tick instead of
+  *                   sleeping. I2C targets are register files answering at
+  *                   the addresses attached by the host program, which can
+  *                   also make a later transfer fail as a NACK would.
+  *                   A failed assert_param aborts the host program.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "host_hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint16_t Address;     /*!< 8-bit bus address, 0 when unused */
+  uint8_t Pointer;      /*!< Register address for the next access */
+  uint8_t Regs[256];
+} HostHal_I2CDeviceTypeDef;
+
+/* Private define ------------------------------------------------------------*/
+/* APB1 up to the end of the AHB2 GPIO ports */
+#define HOST_PERIPH_SIZE        0x08002000U
+/* Private peripheral bus: NVIC, SCB, SysTick, DWT, CoreDebug */
+#define HOST_PPB_BASE           0xE0000000U
+#define HOST_PPB_SIZE           0x00100000U
+
+/* Private variables ---------------------------------------------------------*/
+__IO uint32_t uwTick;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+uint32_t SystemCoreClock = 72000000U;
+uint32_t host_primask;
+
+static HostHal_I2CDeviceTypeDef host_i2c_devices[HOST_HAL_I2C_DEVICES];
+/* Transfers left before the injected NACK, 0 for none */
+static uint32_t host_i2c_nack_in;
+
+/* Private function prototypes -----------------------------------------------*/
+static void HostHal_Map(uintptr_t base, size_t size);
+static HostHal_I2CDeviceTypeDef *HostHal_I2C_Find(uint16_t address);
+static uint8_t HostHal_I2C_Nack(void);
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Back the device register regions with zeroed memory
+  * @retval None
+  */
+__attribute__((constructor)) static void HostHal_MapRegisters(void)
+{
+  HostHal_Map(PERIPH_BASE, HOST_PERIPH_SIZE);
+  HostHal_Map(HOST_PPB_BASE, HOST_PPB_SIZE);
+}
+
+/**
+  * @brief  Map anonymous memory at a fixed address, or abort
+  * @param  base: region start
+  * @param  size: region size
+  * @retval None
+  */
+static void HostHal_Map(uintptr_t base, size_t size)
+{
+  void *p = mmap((void *)base, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE,
+                 -1, 0);
+
+  if (p != (void *)base) {
+    fprintf(stderr, "hal_shim: cannot map registers at 0x%08lx\n", (unsigned long)base);
+    abort();
+  }
+}
+
+/**
+  * @brief  Report a failed assert_param and abort
+  * @param  file: source file name
+  * @param  line: source line number
+  * @retval None
+  */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+  fprintf(stderr, "assert failed: %s:%u\n", (const char *)file, line);
+  abort();
+}
+
+/* Tick ----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+  uwTick = 0U;
+  return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+  uwTick += uwTickFreq;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  uwTick += Delay;
+}
+
+/**
+  * @brief  Move virtual time forward
+  * @param  ms: milliseconds
+  * @retval None
+  */
+void HostHal_AdvanceTick(uint32_t ms)
+{
+  uwTick += ms;
+}
+
+/* NVIC, RCC, TIM ------------------------------------------------------------*/
+
+void HAL_NVIC_SetPriorityGrouping(uint32_t PriorityGroup)
+{
+  UNUSED(PriorityGroup);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  UNUSED(IRQn);
+  UNUSED(PreemptPriority);
+  UNUSED(SubPriority);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  UNUSED(IRQn);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  UNUSED(IRQn);
+}
+
+void HAL_RCC_MCOConfig(uint32_t RCC_MCOx, uint32_t RCC_MCOSource, uint32_t RCC_MCODiv)
+{
+  UNUSED(RCC_MCOx);
+  UNUSED(RCC_MCOSource);
+  UNUSED(RCC_MCODiv);
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Init(TIM_HandleTypeDef *htim)
+{
+  htim->Instance->PSC = htim->Init.Prescaler;
+  htim->Instance->ARR = htim->Init.Period;
+  htim->State = HAL_TIM_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim, const TIM_IC_InitTypeDef *sConfig,
+                                           uint32_t Channel)
+{
+  volatile uint32_t *ccmr = Channel < TIM_CHANNEL_3 ? &htim->Instance->CCMR1 : &htim->Instance->CCMR2;
+  const uint32_t shift = (Channel & TIM_CHANNEL_2) != 0U ? 8U : 0U;
+  const uint32_t mask = TIM_CCMR1_CC1S | TIM_CCMR1_IC1PSC | TIM_CCMR1_IC1F;
+
+  *ccmr = (*ccmr & ~(mask << shift))
+          | ((sConfig->ICSelection | sConfig->ICPrescaler | (sConfig->ICFilter << 4U)) << shift);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  htim->Instance->CCER |= TIM_CCER_CC1E << (Channel & 0x1FU);
+  htim->Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Stop(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  htim->Instance->CCER &= ~(TIM_CCER_CC1E << (Channel & 0x1FU));
+  htim->Instance->CR1 &= ~TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+  if ((htim->Instance->SR & TIM_SR_UIF) != 0U && (htim->Instance->DIER & TIM_DIER_UIE) != 0U) {
+    htim->Instance->SR = (uint32_t)~TIM_SR_UIF;
+    HAL_TIM_PeriodElapsedCallback(htim);
+  }
+}
+
+__weak void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+  UNUSED(htim);
+}
+
+/* GPIO ----------------------------------------------------------------------*/
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+  UNUSED(GPIOx);
+  UNUSED(GPIO_Init);
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+  UNUSED(GPIOx);
+  UNUSED(GPIO_Pin);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  return (GPIOx->IDR & GPIO_Pin) != 0U ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (PinState != GPIO_PIN_RESET) {
+    GPIOx->ODR |= GPIO_Pin;
+  } else {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+}
+
+/**
+  * @brief  EXTI handler: the test double only raises lines that fired, so
+  *         there is no pending register to check
+  * @param  GPIO_Pin: EXTI line
+  * @retval None
+  */
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+  HAL_GPIO_EXTI_Callback(GPIO_Pin);
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  UNUSED(GPIO_Pin);
+}
+
+/* DMA -----------------------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+  if (hdma == NULL) {
+    return HAL_ERROR;
+  }
+  hdma->ChannelIndex = (((uint32_t)(uintptr_t)hdma->Instance - (uint32_t)(uintptr_t)DMA1_Channel1)
+                        / ((uint32_t)(uintptr_t)DMA1_Channel2 - (uint32_t)(uintptr_t)DMA1_Channel1)) << 2;
+  hdma->DmaBaseAddress = DMA1;
+
+  hdma->Instance->CCR = hdma->Init.Direction | hdma->Init.PeriphInc | hdma->Init.MemInc
+                        | hdma->Init.PeriphDataAlignment | hdma->Init.MemDataAlignment
+                        | hdma->Init.Mode | hdma->Init.Priority;
+  hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+  hdma->State = HAL_DMA_STATE_READY;
+  hdma->Lock = HAL_UNLOCKED;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+  hdma->Instance->CCR = 0U;
+  hdma->State = HAL_DMA_STATE_RESET;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                uint32_t DataLength)
+{
+  if (hdma->State != HAL_DMA_STATE_READY) {
+    return HAL_BUSY;
+  }
+  hdma->State = HAL_DMA_STATE_BUSY;
+  hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+
+  hdma->Instance->CCR &= ~DMA_CCR_EN;
+  hdma->Instance->CNDTR = DataLength;
+  if ((hdma->Init.Direction) == DMA_MEMORY_TO_PERIPH) {
+    hdma->Instance->CPAR = DstAddress;
+    hdma->Instance->CMAR = SrcAddress;
+  } else {
+    hdma->Instance->CPAR = SrcAddress;
+    hdma->Instance->CMAR = DstAddress;
+  }
+  hdma->Instance->CCR |= DMA_CCR_EN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress,
+                                   uint32_t DataLength)
+{
+  HAL_StatusTypeDef err = HAL_DMA_Start(hdma, SrcAddress, DstAddress, DataLength);
+
+  if (err != HAL_OK) {
+    return err;
+  }
+  hdma->Instance->CCR |= DMA_IT_TC | DMA_IT_TE;
+  if (hdma->XferHalfCpltCallback != NULL) {
+    hdma->Instance->CCR |= DMA_IT_HT;
+  } else {
+    hdma->Instance->CCR &= ~DMA_IT_HT;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+  hdma->Instance->CCR &= ~(DMA_IT_TC | DMA_IT_HT | DMA_IT_TE | DMA_CCR_EN);
+  hdma->DmaBaseAddress->ISR &= ~(DMA_ISR_GIF1 << hdma->ChannelIndex);
+  hdma->State = HAL_DMA_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort_IT(DMA_HandleTypeDef *hdma)
+{
+  HAL_DMA_Abort(hdma);
+  if (hdma->XferAbortCallback != NULL) {
+    hdma->XferAbortCallback(hdma);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Dispatch the pending channel flags the way the HAL does; the
+  *         flags are cleared in ISR since the emulated IFCR has no effect
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+  uint32_t flags = hdma->DmaBaseAddress->ISR;
+  uint32_t sources = hdma->Instance->CCR;
+
+  if ((flags & (DMA_FLAG_HT1 << hdma->ChannelIndex)) != 0U && (sources & DMA_IT_HT) != 0U) {
+    if ((sources & DMA_CCR_CIRC) == 0U) {
+      hdma->Instance->CCR &= ~DMA_IT_HT;
+    }
+    hdma->DmaBaseAddress->ISR &= ~(DMA_FLAG_HT1 << hdma->ChannelIndex);
+    if (hdma->XferHalfCpltCallback != NULL) {
+      hdma->XferHalfCpltCallback(hdma);
+    }
+  } else if ((flags & (DMA_FLAG_TC1 << hdma->ChannelIndex)) != 0U && (sources & DMA_IT_TC) != 0U) {
+    if ((sources & DMA_CCR_CIRC) == 0U) {
+      hdma->Instance->CCR &= ~(DMA_IT_TC | DMA_IT_TE | DMA_CCR_EN);
+      hdma->State = HAL_DMA_STATE_READY;
+    }
+    hdma->DmaBaseAddress->ISR &= ~(DMA_FLAG_TC1 << hdma->ChannelIndex);
+    if (hdma->XferCpltCallback != NULL) {
+      hdma->XferCpltCallback(hdma);
+    }
+  } else if ((flags & (DMA_FLAG_TE1 << hdma->ChannelIndex)) != 0U && (sources & DMA_IT_TE) != 0U) {
+    hdma->Instance->CCR &= ~(DMA_IT_TC | DMA_IT_HT | DMA_IT_TE | DMA_CCR_EN);
+    hdma->DmaBaseAddress->ISR &= ~(DMA_ISR_GIF1 << hdma->ChannelIndex);
+    hdma->ErrorCode = HAL_DMA_ERROR_TE;
+    hdma->State = HAL_DMA_STATE_READY;
+    if (hdma->XferErrorCallback != NULL) {
+      hdma->XferErrorCallback(hdma);
+    }
+  }
+}
+
+/* I2C -----------------------------------------------------------------------*/
+
+/**
+  * @brief  Add an emulated target, or return the one already at an address
+  * @param  address: 8-bit bus address
+  * @retval Its register file, NULL if all slots are used
+  */
+uint8_t *HostHal_I2C_AttachDevice(uint16_t address)
+{
+  HostHal_I2CDeviceTypeDef *dev = HostHal_I2C_Find(address);
+
+  if (dev == NULL) {
+    dev = HostHal_I2C_Find(0U);
+    if (dev == NULL) {
+      return NULL;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->Address = address;
+  }
+  return dev->Regs;
+}
+
+/**
+  * @brief  Remove every emulated target
+  * @retval None
+  */
+void HostHal_I2C_DetachAll(void)
+{
+  memset(host_i2c_devices, 0, sizeof(host_i2c_devices));
+}
+
+/**
+  * @brief  Make a later transfer fail with a NACK
+  * @param  transfers: 1 for the next transfer, 2 for the one after, ...
+  * @retval None
+  */
+void HostHal_I2C_InjectNack(uint32_t transfers)
+{
+  host_i2c_nack_in = transfers;
+}
+
+/**
+  * @brief  Count a transfer down to the injected NACK
+  * @retval 1 if this transfer is NACKed
+  */
+static uint8_t HostHal_I2C_Nack(void)
+{
+  return host_i2c_nack_in != 0U && --host_i2c_nack_in == 0U;
+}
+
+/**
+  * @brief  Look up an emulated target
+  * @param  address: 8-bit bus address, 0 for a free slot
+  * @retval Target, NULL if none answers
+  */
+static HostHal_I2CDeviceTypeDef *HostHal_I2C_Find(uint16_t address)
+{
+  for (uint32_t i = 0U; i < HOST_HAL_I2C_DEVICES; i++) {
+    if (host_i2c_devices[i].Address == address) {
+      return &host_i2c_devices[i];
+    }
+  }
+  return NULL;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+  hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+  hi2c->State = HAL_I2C_STATE_READY;
+  hi2c->Mode = HAL_I2C_MODE_NONE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+  hi2c->State = HAL_I2C_STATE_RESET;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2CEx_ConfigAnalogFilter(I2C_HandleTypeDef *hi2c, uint32_t AnalogFilter)
+{
+  UNUSED(hi2c);
+  UNUSED(AnalogFilter);
+  return HAL_OK;
+}
+
+/**
+  * @brief  Write: the first byte sets the register pointer, the next ones
+  *         are stored from there with auto-increment
+  */
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                          uint16_t Size, uint32_t Timeout)
+{
+  HostHal_I2CDeviceTypeDef *dev = HostHal_I2C_Find(DevAddress);
+
+  UNUSED(Timeout);
+  if (hi2c->State != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (dev == NULL || DevAddress == 0U || HostHal_I2C_Nack()) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return HAL_ERROR;
+  }
+  for (uint16_t i = 0U; i < Size; i++) {
+    if (i == 0U) {
+      dev->Pointer = pData[0];
+    } else {
+      dev->Regs[dev->Pointer++] = pData[i];
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Read from the register pointer with auto-increment
+  */
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                         uint16_t Size, uint32_t Timeout)
+{
+  HostHal_I2CDeviceTypeDef *dev = HostHal_I2C_Find(DevAddress);
+
+  UNUSED(Timeout);
+  if (hi2c->State != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (dev == NULL || DevAddress == 0U || HostHal_I2C_Nack()) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return HAL_ERROR;
+  }
+  for (uint16_t i = 0U; i < Size; i++) {
+    pData[i] = dev->Regs[dev->Pointer++];
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                    uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  HostHal_I2CDeviceTypeDef *dev = HostHal_I2C_Find(DevAddress);
+
+  UNUSED(MemAddSize);
+  UNUSED(Timeout);
+  if (hi2c->State != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (dev == NULL || DevAddress == 0U) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return HAL_ERROR;
+  }
+  dev->Pointer = (uint8_t)MemAddress;
+  for (uint16_t i = 0U; i < Size; i++) {
+    dev->Regs[dev->Pointer++] = pData[i];
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+                                   uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+  HostHal_I2CDeviceTypeDef *dev = HostHal_I2C_Find(DevAddress);
+
+  UNUSED(MemAddSize);
+  UNUSED(Timeout);
+  if (hi2c->State != HAL_I2C_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (dev == NULL || DevAddress == 0U) {
+    hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+    return HAL_ERROR;
+  }
+  dev->Pointer = (uint8_t)MemAddress;
+  for (uint16_t i = 0U; i < Size; i++) {
+    pData[i] = dev->Regs[dev->Pointer++];
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Interrupt-driven write, completed on the spot: the transfer
+  *         callback runs before the call returns
+  */
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                             uint16_t Size)
+{
+  HAL_StatusTypeDef err = HAL_I2C_Master_Transmit(hi2c, DevAddress, pData, Size, 0U);
+
+  if (err == HAL_BUSY) {
+    return err;
+  }
+  if (err != HAL_OK) {
+    HAL_I2C_ErrorCallback(hi2c);
+  } else {
+    HAL_I2C_MasterTxCpltCallback(hi2c);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief  Interrupt-driven read, completed on the spot
+  */
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData,
+                                            uint16_t Size)
+{
+  HAL_StatusTypeDef err = HAL_I2C_Master_Receive(hi2c, DevAddress, pData, Size, 0U);
+
+  if (err == HAL_BUSY) {
+    return err;
+  }
+  if (err != HAL_OK) {
+    HAL_I2C_ErrorCallback(hi2c);
+  } else {
+    HAL_I2C_MasterRxCpltCallback(hi2c);
+  }
+  return HAL_OK;
+}
+
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+  UNUSED(hi2c);
+}
+
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+  UNUSED(hi2c);
+}
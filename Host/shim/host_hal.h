@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file           : host_hal.h
+  * @brief          : Header for hal_shim.c, serial_shim.c, crc_shim.c and
+  *                   flash_shim.c.
+  *                   Host-side controls of the HAL stand-in.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HOST_HAL_H
+#define __HOST_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief Receives every byte written to the serial port
+  */
+typedef void (*HostHal_SerialSink)(const uint8_t *data, uint32_t len, void *user);
+
+/* Exported constants --------------------------------------------------------*/
+/* Emulated I2C targets, each a 256-byte auto-incrementing register file */
+#define HOST_HAL_I2C_DEVICES    4U
+
+/* Exported functions prototypes ---------------------------------------------*/
+void HostHal_AdvanceTick(uint32_t ms);
+uint8_t *HostHal_I2C_AttachDevice(uint16_t address);
+void HostHal_I2C_DetachAll(void);
+void HostHal_I2C_InjectNack(uint32_t transfers);
+void HostHal_SetSerialSink(HostHal_SerialSink sink, void *user);
+uint32_t HostHal_GetFlashErases(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_HAL_H */
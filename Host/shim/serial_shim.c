@@ -0,0 +1,56 @@
+/**
+  ******************************************************************************
+  * @file           : serial_shim.c
+  * @brief          : Host stand-in for serial.c
+  *
+  *                   Bytes written to the serial port go straight to the sink
+  *                   installed by the host program, or are discarded.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "host_hal.h"
+#include "serial.h"
+
+/* Private variables ---------------------------------------------------------*/
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+static HostHal_SerialSink serial_sink;
+static void *serial_sink_user;
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Install the receiver of serial output
+  * @param  sink: byte handler, NULL to discard
+  * @param  user: opaque pointer passed to the handler
+  * @retval None
+  */
+void HostHal_SetSerialSink(HostHal_SerialSink sink, void *user)
+{
+  serial_sink = sink;
+  serial_sink_user = user;
+}
+
+HAL_StatusTypeDef Serial_Init(void)
+{
+  return HAL_OK;
+}
+
+uint32_t Serial_Write(const void *data, uint32_t len)
+{
+  if (serial_sink != NULL) {
+    serial_sink((const uint8_t *)data, len, serial_sink_user);
+  }
+  return len;
+}
+
+void Serial_Flush(void)
+{
+}
+
+uint32_t Serial_GetDropped(void)
+{
+  return 0U;
+}
@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry_decoder.c
+  * @brief          : Host-side binary telemetry decoder
+  *
+  *                   Splits the serial byte stream on 0x00 delimiters, COBS
+  *                   decodes each frame and checks its CRC-32, version,
+  *                   type and length before handing it to the application.
+  *                   Bad frames are counted and skipped: the next delimiter
+  *                   resynchronizes the stream.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "telemetry_decoder.h"
+#include <string.h>
+
+/* Private user code ---------------------------------------------------------*/
+
+/**
+  * @brief  Reset a decoder
+  * @param  decoder: decoder state
+  * @param  callback: packet handler
+  * @param  user: opaque pointer passed to the handler
+  * @retval None
+  */
+void TelemetryDecoder_Init(TelemetryDecoder_HandleTypeDef *decoder,
+                           TelemetryDecoder_Callback callback, void *user)
+{
+  memset(decoder, 0, sizeof(*decoder));
+  decoder->Callback = callback;
+  decoder->User = user;
+}
+
+/**
+  * @brief  Consume received bytes, delivering every complete packet
+  * @param  decoder: decoder state
+  * @param  data: received bytes
+  * @param  len: number of bytes
+  * @retval None
+  */
+void TelemetryDecoder_Feed(TelemetryDecoder_HandleTypeDef *decoder,
+                           const uint8_t *data, uint32_t len)
+{
+  uint8_t packet[TELEMETRY_PACKET_MAX + 1U];
+  TelemetryDecoder_PacketTypeDef decoded;
+
+  for (uint32_t i = 0U; i < len; i++) {
+    uint32_t n;
+
+    if (data[i] != 0U) {
+      if (decoder->Length < sizeof(decoder->Frame)) {
+        decoder->Frame[decoder->Length++] = data[i];
+      } else {
+        decoder->Overflow = 1U;
+      }
+      continue;
+    }
+
+    /* Delimiter: an empty frame is only line noise between packets */
+    if (decoder->Length != 0U || decoder->Overflow) {
+      n = decoder->Overflow ? 0U : Cobs_Decode(decoder->Frame, decoder->Length, packet);
+      if (n != 0U && n <= TELEMETRY_PACKET_MAX
+          && TelemetryDecoder_Parse(packet, n, &decoded) == 0) {
+        decoder->Packets++;
+        if (decoder->Callback != NULL) {
+          decoder->Callback(&decoded, decoder->User);
+        }
+      } else {
+        decoder->Errors++;
+      }
+    }
+    decoder->Length = 0U;
+    decoder->Overflow = 0U;
+  }
+}
+
+/**
+  * @brief  Check and unpack one decoded packet
+  * @param  packet: COBS-decoded bytes, CRC included
+  * @param  len: number of bytes
+  * @param  out: unpacked packet
+  * @retval 0 on success, -1 if the packet is malformed or corrupted
+  */
+int TelemetryDecoder_Parse(const uint8_t *packet, uint32_t len,
+                           TelemetryDecoder_PacketTypeDef *out)
+{
+  uint32_t crc;
+  uint32_t body;
+  uint32_t max_count;
+  uint32_t record;
+
+  if (len < sizeof(out->Header) + sizeof(crc)) {
+    return -1;
+  }
+  body = len - sizeof(crc);
+  memcpy(&crc, &packet[body], sizeof(crc));
+  if (crc != TelemetryDecoder_Crc32(packet, body)) {
+    return -1;
+  }
+
+  memcpy(&out->Header, packet, sizeof(out->Header));
+  if (out->Header.Version != TELEMETRY_VERSION) {
+    return -1;
+  }
+  switch (out->Header.Type) {
+    case TELEMETRY_TYPE_BLOBS:
+      max_count = TELEMETRY_MAX_BLOBS;
+      record = sizeof(out->Blobs[0]);
+      break;
+    case TELEMETRY_TYPE_PROFILE:
+      max_count = 1U;
+      record = sizeof(out->Profile);
+      break;
+    case TELEMETRY_TYPE_RUNS:
+      max_count = TELEMETRY_MAX_RUNS;
+      record = sizeof(out->Runs[0]);
+      break;
+    case TELEMETRY_TYPE_STATS:
+      max_count = 1U;
+      record = sizeof(out->Stats);
+      break;
+    default:
+      return -1;
+  }
+  if (out->Header.Count > max_count
+      || body != sizeof(out->Header) + out->Header.Count * record) {
+    return -1;
+  }
+  memcpy(out->Blobs, &packet[sizeof(out->Header)], out->Header.Count * record);
+  return 0;
+}
+
+/**
+  * @brief  CRC-32/zlib, bitwise: the reference for the target CRC unit
+  * @param  data: bytes
+  * @param  len: number of bytes
+  * @retval CRC
+  */
+uint32_t TelemetryDecoder_Crc32(const uint8_t *data, uint32_t len)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+
+  for (uint32_t i = 0U; i < len; i++) {
+    crc ^= data[i];
+    for (uint32_t bit = 0U; bit < 8U; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+  }
+  return ~crc;
+}
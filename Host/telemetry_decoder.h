@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry_decoder.h
+  * @brief          : Header for telemetry_decoder.c file.
+  *                   Host-side decoder of the binary telemetry stream.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TELEMETRY_DECODER_H
+#define __TELEMETRY_DECODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "cobs.h"
+#include "telemetry_protocol.h"
+
+/* Exported types ------------------------------------------------------------*/
+/**
+  * @brief One decoded packet
+  */
+typedef struct
+{
+  Telemetry_HeaderTypeDef Header;
+  union
+  {
+    Telemetry_BlobTypeDef Blobs[TELEMETRY_MAX_BLOBS]; /*!< TELEMETRY_TYPE_BLOBS   */
+    Telemetry_ProfileTypeDef Profile;                 /*!< TELEMETRY_TYPE_PROFILE */
+    Telemetry_RunTypeDef Runs[TELEMETRY_MAX_RUNS];    /*!< TELEMETRY_TYPE_RUNS    */
+    Telemetry_StatsTypeDef Stats;                     /*!< TELEMETRY_TYPE_STATS   */
+  };
+} TelemetryDecoder_PacketTypeDef;
+
+/**
+  * @brief Called for every packet that passes the CRC and format checks
+  */
+typedef void (*TelemetryDecoder_Callback)(const TelemetryDecoder_PacketTypeDef *packet,
+                                          void *user);
+
+/**
+  * @brief Stream decoder state
+  */
+typedef struct
+{
+  uint8_t Frame[COBS_ENCODED_MAX(TELEMETRY_PACKET_MAX)];
+  uint32_t Length;      /*!< Bytes accumulated since the last delimiter   */
+  uint8_t Overflow;     /*!< Current frame exceeded the largest packet    */
+  uint32_t Packets;     /*!< Packets delivered                            */
+  uint32_t Errors;      /*!< Frames rejected: framing, length, CRC        */
+  TelemetryDecoder_Callback Callback;
+  void *User;
+} TelemetryDecoder_HandleTypeDef;
+
+/* Exported functions prototypes ---------------------------------------------*/
+void TelemetryDecoder_Init(TelemetryDecoder_HandleTypeDef *decoder,
+                           TelemetryDecoder_Callback callback, void *user);
+void TelemetryDecoder_Feed(TelemetryDecoder_HandleTypeDef *decoder,
+                           const uint8_t *data, uint32_t len);
+int TelemetryDecoder_Parse(const uint8_t *packet, uint32_t len,
+                           TelemetryDecoder_PacketTypeDef *out);
+uint32_t TelemetryDecoder_Crc32(const uint8_t *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_DECODER_H */